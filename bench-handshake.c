@@ -0,0 +1,415 @@
+/* bench-handshake.c
+ *
+ * Copyright (C) 2025 3mdeb Sp. z o.o.
+ *
+ * Runs full mutually authenticated handshakes between a client and a server
+ * in one process and one thread, connected by a nonblocking in-memory link,
+ * so nothing but the crypto and the protocol logic is measured. It sweeps
+ * the protocol version, the AEAD, session resumption and the server's key
+ * backend, and reports handshakes per second, process CPU time and bytes on
+ * the wire per handshake, and the time spent in the key backend.
+ *
+ * The server key always runs in software as a baseline. Pass a PKCS#11 key
+ * backend (-k optee or -k pkcs11) to add rows for the token as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#include "include/key_backend.h"
+#include "include/mem_link.h"
+
+#define DEFAULT_ITERATIONS 100
+
+#define CA_FILE     "certs/ca-cert.pem"
+#define CERT_FILE   "certs/ca-cert.pem"
+#define KEY_FILE    "certs/ca-key.pem"
+
+/* Turns of both ends after which a handshake counts as stuck */
+#define MAX_SPINS 64
+
+typedef struct {
+    const char* name;
+    int tls13;
+} version_t;
+
+typedef struct {
+    const char* name;
+    const char* tls12;
+    const char* tls13;
+} aead_t;
+
+static const version_t versions[] = {
+#ifndef WOLFSSL_NO_TLS12
+    {"1.2", 0},
+#endif
+#ifdef WOLFSSL_TLS13
+    {"1.3", 1},
+#endif
+};
+
+static const aead_t aeads[] = {
+    {"aes256gcm", "ECDHE-ECDSA-AES256-GCM-SHA384", "TLS13-AES256-GCM-SHA384"},
+    {"chacha20",  "ECDHE-ECDSA-CHACHA20-POLY1305", "TLS13-CHACHA20-POLY1305-SHA256"},
+};
+
+#define VERSIONS ((int)(sizeof(versions) / sizeof(versions[0])))
+#define AEADS    ((int)(sizeof(aeads) / sizeof(aeads[0])))
+
+typedef struct {
+    double wall, cpu;               /* seconds */
+    uint64_t bytes[2];              /* client to server, server to client */
+    uint64_t turns;
+    uint64_t resumed;
+    key_backend_stats_t token;
+} result_t;
+
+static double now(clockid_t clock)
+{
+    struct timespec ts;
+
+    clock_gettime(clock, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char* prog, const key_backend_config_t* keyCfg)
+{
+    printf("Usage: %s [options]\n", prog);
+    printf("  -n count     Handshakes per configuration (default %d)\n", DEFAULT_ITERATIONS);
+    printf("  -V version   Only TLS 1.2 or 1.3\n");
+    printf("  -e aead      Only aes256gcm or chacha20\n");
+    printf("  -R on|off    Only with or without resumption\n");
+    printf("  -c file      Certificate of both ends (default %s)\n", CERT_FILE);
+    printf("  -s file      Server certificate for the token key (default: -c)\n");
+    printf("  -A file      CA certificate (default %s)\n", CA_FILE);
+    printf("Server key backend, in addition to software (-F is also the client key):\n");
+    key_backend_usage(keyCfg);
+    printf("  -h           Show this help\n");
+}
+
+/* Drives both ends until both are done, they only ever wait for each other */
+static int handshake(WOLFSSL* client, WOLFSSL* server)
+{
+    int clientDone = 0, serverDone = 0;
+    int ret, err;
+
+    for (int spins = 0; !clientDone || !serverDone; spins++) {
+        if (spins == MAX_SPINS)
+            return -1;
+
+        if (!clientDone) {
+            ret = wolfSSL_connect(client);
+            err = wolfSSL_get_error(client, ret);
+            if (ret == WOLFSSL_SUCCESS)
+                clientDone = 1;
+            else if (err != WOLFSSL_ERROR_WANT_READ && err != WOLFSSL_ERROR_WANT_WRITE)
+                return -1;
+        }
+
+        if (!serverDone) {
+            ret = wolfSSL_accept(server);
+            err = wolfSSL_get_error(server, ret);
+            if (ret == WOLFSSL_SUCCESS)
+                serverDone = 1;
+            else if (err != WOLFSSL_ERROR_WANT_READ && err != WOLFSSL_ERROR_WANT_WRITE)
+                return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* One connection over a fresh link. With session set the client offers it,
+ * with save set it keeps the session the server gave it. */
+static int connection(WOLFSSL_CTX* clientCtx, WOLFSSL_CTX* serverCtx,
+                      WOLFSSL_SESSION** session, int save, result_t* res)
+{
+    mem_link_config_t cfg = {0};
+    mem_link_stats_t st;
+    mem_link* link;
+    WOLFSSL* client = NULL;
+    WOLFSSL* server = NULL;
+    char byte;
+    int ret = -1;
+
+    cfg.nonblocking = 1;
+    link = mem_link_new(&cfg);
+    client = wolfSSL_new(clientCtx);
+    server = wolfSSL_new(serverCtx);
+    if (!link || !client || !server)
+        goto exit;
+    mem_link_attach(link, client, 0);
+    mem_link_attach(link, server, 1);
+
+    if (*session && wolfSSL_set_session(client, *session) != WOLFSSL_SUCCESS)
+        goto exit;
+
+    if (handshake(client, server) != 0)
+        goto exit;
+
+    if (wolfSSL_session_reused(client))
+        res->resumed++;
+
+    if (save) {
+        /* A TLS 1.3 ticket follows the handshake, reading picks it up */
+        wolfSSL_read(client, &byte, 1);
+        wolfSSL_SESSION_free(*session);
+        *session = wolfSSL_get1_session(client);
+        if (*session == NULL)
+            goto exit;
+    }
+
+    mem_link_stats(link, &st);
+    res->bytes[0] += st.bytes[0];
+    res->bytes[1] += st.bytes[1];
+    res->turns += st.turns;
+    ret = 0;
+
+exit:
+    if (client)
+        wolfSSL_free(client);
+    if (server)
+        wolfSSL_free(server);
+    mem_link_free(link);
+    return ret;
+}
+
+/* Sets *unsupported if wolfSSL lacks the cipher suite */
+static WOLFSSL_CTX* new_ctx(int server, const version_t* ver, const aead_t* aead,
+                            const char* certFile, const char* caFile, int* unsupported)
+{
+    WOLFSSL_CTX* ctx = NULL;
+
+#ifdef WOLFSSL_TLS13
+    if (ver->tls13)
+        ctx = wolfSSL_CTX_new(server ? wolfTLSv1_3_server_method() : wolfTLSv1_3_client_method());
+#endif
+#ifndef WOLFSSL_NO_TLS12
+    if (!ver->tls13)
+        ctx = wolfSSL_CTX_new(server ? wolfTLSv1_2_server_method() : wolfTLSv1_2_client_method());
+#endif
+    if (ctx == NULL)
+        return NULL;
+
+    if (wolfSSL_CTX_set_cipher_list(ctx, ver->tls13 ? aead->tls13 : aead->tls12)
+            != WOLFSSL_SUCCESS) {
+        *unsupported = 1;
+        wolfSSL_CTX_free(ctx);
+        return NULL;
+    }
+    if (wolfSSL_CTX_use_certificate_file(ctx, certFile, WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_load_verify_locations(ctx, caFile, NULL) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "ERROR: failed to load %s or %s\n", certFile, caFile);
+        wolfSSL_CTX_free(ctx);
+        return NULL;
+    }
+    wolfSSL_CTX_set_verify(ctx, WOLFSSL_VERIFY_PEER | WOLFSSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+    return ctx;
+}
+
+/* Runs one configuration. Returns 0 on success, 1 if it is not built into
+ * wolfSSL, -1 if a handshake failed. */
+static int run(const version_t* ver, const aead_t* aead, int resume, key_backend* keys,
+               const char* backend, const char* clientCert, const char* serverCert,
+               const char* clientKey, const char* caFile, int iterations)
+{
+    WOLFSSL_CTX* clientCtx;
+    WOLFSSL_CTX* serverCtx;
+    WOLFSSL_SESSION* session = NULL;
+    key_backend_stats_t before;
+    result_t res;
+    double wall, cpu;
+    int unsupported = 0;
+    int ret = -1;
+
+    memset(&res, 0, sizeof(res));
+    clientCtx = new_ctx(0, ver, aead, clientCert, caFile, &unsupported);
+    serverCtx = new_ctx(1, ver, aead, serverCert, caFile, &unsupported);
+    if (!clientCtx || !serverCtx) {
+        ret = unsupported ? 1 : -1;
+        goto exit;
+    }
+    if (wolfSSL_CTX_use_PrivateKey_file(clientCtx, clientKey, WOLFSSL_FILETYPE_PEM)
+            != WOLFSSL_SUCCESS ||
+        key_backend_use(keys, serverCtx) != 0) {
+        fprintf(stderr, "ERROR: failed to load the keys\n");
+        goto exit;
+    }
+
+    /* The session to resume comes from a full handshake outside the timing */
+    if (resume) {
+        result_t warmup;
+
+        memset(&warmup, 0, sizeof(warmup));
+        if (connection(clientCtx, serverCtx, &session, 1, &warmup) != 0) {
+            fprintf(stderr, "ERROR: TLS %s %s handshake failed\n", ver->name, aead->name);
+            goto exit;
+        }
+    }
+
+    key_backend_stats(keys, &before);
+    wall = now(CLOCK_MONOTONIC);
+    cpu = now(CLOCK_PROCESS_CPUTIME_ID);
+    for (int i = 0; i < iterations; i++) {
+        if (connection(clientCtx, serverCtx, &session, 0, &res) != 0) {
+            fprintf(stderr, "ERROR: TLS %s %s handshake %d failed\n", ver->name,
+                    aead->name, i + 1);
+            goto exit;
+        }
+    }
+    res.cpu = now(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+    res.wall = now(CLOCK_MONOTONIC) - wall;
+    key_backend_stats(keys, &res.token);
+
+    printf("%-4s %-10s %-4s %-9s %9.1f %9.0f %7.0f %7.0f %6.1f %9.2f %8.0f%%\n",
+           ver->name, aead->name, resume ? "on" : "off", backend,
+           iterations / res.wall,
+           res.cpu * 1e6 / iterations,
+           (double)res.bytes[0] / iterations,
+           (double)res.bytes[1] / iterations,
+           (double)res.turns / iterations,
+           (res.token.ns - before.ns) / 1e6 / iterations,
+           100.0 * res.resumed / iterations);
+    ret = 0;
+
+exit:
+    wolfSSL_SESSION_free(session);
+    if (clientCtx)
+        wolfSSL_CTX_free(clientCtx);
+    if (serverCtx)
+        wolfSSL_CTX_free(serverCtx);
+    return ret;
+}
+
+int main(int argc, char** argv)
+{
+    key_backend_config_t keyCfg = {
+        .type = KEY_BACKEND_SOFTWARE,
+        .optee_module = "/usr/lib/libckteec.so",
+        .token_name = "ServerToken",
+        .user_pin = "1234",
+        .slot_id = 0,
+        .key_id = {0x01},
+        .key_id_len = 1,
+        .key_file = KEY_FILE,
+    };
+    key_backend_config_t softCfg;
+    key_backend* backends[2] = {NULL, NULL};
+    const char* onlyVersion = NULL;
+    const char* onlyAead = NULL;
+    const char* caFile = CA_FILE;
+    const char* certFile = CERT_FILE;
+    const char* tokenCert = NULL;
+    int onlyResume = -1;
+    int iterations = DEFAULT_ITERATIONS;
+    int failed = 0, ran = 0;
+    int ret = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, KEY_BACKEND_OPTS "n:V:e:R:c:s:A:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = atoi(optarg);
+            continue;
+        case 'V':
+            onlyVersion = optarg;
+            continue;
+        case 'e':
+            onlyAead = optarg;
+            continue;
+        case 'R':
+            onlyResume = strcmp(optarg, "on") == 0;
+            continue;
+        case 'c':
+            certFile = optarg;
+            continue;
+        case 's':
+            tokenCert = optarg;
+            continue;
+        case 'A':
+            caFile = optarg;
+            continue;
+        }
+        if (opt != 'h' && key_backend_parse_opt(&keyCfg, opt, optarg) == 0)
+            continue;
+        usage(argv[0], &keyCfg);
+        return opt == 'h' ? 0 : 1;
+    }
+    if (optind != argc || iterations < 1) {
+        usage(argv[0], &keyCfg);
+        return 1;
+    }
+
+    wolfCrypt_Init();
+    wolfSSL_Init();
+
+    softCfg = keyCfg;
+    softCfg.type = KEY_BACKEND_SOFTWARE;
+    backends[0] = key_backend_new(&softCfg, INVALID_DEVID);
+    if (backends[0] == NULL)
+        goto exit;
+
+    /* The token session stays open, like in a long running server */
+    if (keyCfg.type != KEY_BACKEND_SOFTWARE) {
+        backends[1] = key_backend_new(&keyCfg, 1);
+        if (backends[1] == NULL || key_backend_hold_session(backends[1]) != 0) {
+            fprintf(stderr, "ERROR: failed to open the %s token\n",
+                    key_backend_name(keyCfg.type));
+            goto exit;
+        }
+    }
+
+    printf("%d handshakes per configuration, mutual authentication, P-256\n", iterations);
+    printf("Per handshake: CPU time of the process, bytes each way, turns of\n"
+           "direction, time in the key backend, share of resumed sessions\n\n");
+    printf("%-4s %-10s %-4s %-9s %9s %9s %7s %7s %6s %9s %9s\n", "tls", "aead", "res",
+           "backend", "hs/s", "cpu us", "c->s", "s->c", "turns", "token ms", "resumed");
+
+    for (int b = 0; b < 2; b++) {
+        if (!backends[b])
+            continue;
+        for (int v = 0; v < VERSIONS; v++) {
+            if (onlyVersion && strcmp(onlyVersion, versions[v].name) != 0)
+                continue;
+            for (int a = 0; a < AEADS; a++) {
+                if (onlyAead && strcmp(onlyAead, aeads[a].name) != 0)
+                    continue;
+                for (int r = 0; r < 2; r++) {
+                    if (onlyResume >= 0 && onlyResume != r)
+                        continue;
+                    ret = run(&versions[v], &aeads[a], r, backends[b],
+                              key_backend_name(b ? keyCfg.type : KEY_BACKEND_SOFTWARE),
+                              certFile, b && tokenCert ? tokenCert : certFile,
+                              keyCfg.key_file, caFile, iterations);
+                    if (ret == 1)
+                        printf("%-4s %-10s %-4s %-9s not built into wolfSSL\n",
+                               versions[v].name, aeads[a].name, r ? "on" : "off",
+                               key_backend_name(b ? keyCfg.type : KEY_BACKEND_SOFTWARE));
+                    else if (ret == 0)
+                        ran++;
+                    else
+                        failed++;
+                }
+            }
+        }
+    }
+
+    if (failed)
+        fprintf(stderr, "%d configuration(s) failed\n", failed);
+    ret = failed || !ran ? 1 : 0;
+
+exit:
+    if (backends[1])
+        key_backend_release_session(backends[1]);
+    key_backend_free(backends[1]);
+    key_backend_free(backends[0]);
+    wolfSSL_Cleanup();
+    wolfCrypt_Cleanup();
+    return ret;
+}
@@ -0,0 +1,407 @@
+/* challenge-bench.c
+ *
+ * Copyright (C) 2025 3mdeb Sp. z o.o.
+ *
+ * Runs the challenge protocol (sendChallenge/recChallenge, the framing and
+ * the ACKs) between two wolfSSL endpoints in one process, connected by an
+ * in-memory link that models the LPC's serial line. It checks every byte
+ * that arrives and reports, per challenge type, the bytes on the wire, the
+ * write/read turns and the time the exchange takes on the simulated link.
+ *
+ * The link runs on a virtual clock (see include/mem_link.h), so everything
+ * but the host CPU time is deterministic and the output can be compared
+ * between runs. The pause the LPC needs before every frame is left out, it
+ * is a fixed cost per frame that the frame counts already show.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#include "include/common/challenge.h"
+#include "include/common/transmission.h"
+#include "include/mem_link.h"
+
+#define DEFAULT_ROUNDS      20
+#define DEFAULT_LATENCY_US  2000
+#define DEFAULT_BANDWIDTH   11520   /* 115200 baud, 8N1 */
+#define DEFAULT_CHUNK       16
+
+#define CA_FILE     "certs/ca-cert.pem"
+#define CERT_FILE   "certs/ca-cert.pem"
+#define KEY_FILE    "certs/ca-key.pem"
+
+typedef struct {
+    const char* name;
+    func_t id;
+    const uint8_t* request;
+    const uint8_t* response;
+} scenario_t;
+
+#ifdef RPI_CBA
+static const uint8_t patternCbaNonce[DATA_PORTIONS] = {CBA_NONCE_SIZE};
+static const uint8_t patternCbaMessage[DATA_PORTIONS] = {CBA_MESSAGE_SIZE};
+#endif
+
+static const scenario_t scenarios[] = {
+#ifdef RPI_CBA
+    {"cba",                   CBA_PROVE_IDENTITY, patternCbaNonce, patternCbaMessage},
+#else
+    {"init",                  PUF_TA_INIT_FUNC_ID, pattern_init_commit, pattern_init_commit},
+    {"commitment",            PUF_TA_GET_COMMITMENT_FUNC_ID, pattern_init_commit, pattern_init_commit},
+    {"proofs",                PUF_TA_GET_ZK_PROOFS_FUNC_ID, pattern_proofs, pattern_proofs},
+    {"init compressed",       PUF_TA_INIT_FUNC_ID | PUF_TA_COMPRESSED_POINTS,
+                              pattern_none, pattern_init_compressed},
+    {"commitment compressed", PUF_TA_GET_COMMITMENT_FUNC_ID | PUF_TA_COMPRESSED_POINTS,
+                              pattern_commit_request, pattern_commit_compressed},
+    {"proofs compressed",     PUF_TA_GET_ZK_PROOFS_FUNC_ID | PUF_TA_COMPRESSED_POINTS,
+                              pattern_proofs_request, pattern_proofs_compressed},
+#endif
+};
+
+#define SCENARIOS ((int)(sizeof(scenarios) / sizeof(scenarios[0])))
+
+/* The device end, run on its own thread */
+typedef struct {
+    WOLFSSL* ssl;
+    mem_link* link;
+    const scenario_t* sc;
+    int rounds;
+    int errors;
+} device_t;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void usage(const char* prog)
+{
+    printf("Usage: %s [options]\n", prog);
+    printf("  -n rounds    Exchanges per challenge type (default %d)\n", DEFAULT_ROUNDS);
+    printf("  -l us        One way link latency (default %d)\n", DEFAULT_LATENCY_US);
+    printf("  -b bytes/s   Link bandwidth, 0 for unlimited (default %d)\n", DEFAULT_BANDWIDTH);
+    printf("  -C bytes     Largest chunk handed to a read, 0 for unlimited\n");
+    printf("               (default %d)\n", DEFAULT_CHUNK);
+    printf("  -c file      Certificate of both ends (default %s)\n", CERT_FILE);
+    printf("  -k file      Key of both ends (default %s)\n", KEY_FILE);
+    printf("  -A file      CA certificate (default %s)\n", CA_FILE);
+    printf("  -h           Show this help\n");
+}
+
+/* Deterministic payload, different for every round, portion and side */
+static void fill(func_call_t* f, int round, int side)
+{
+    uint32_t x = 0x9E3779B9u * (uint32_t)(round * 2 + side + 1);
+
+    for (int i = 0; i < DATA_PORTIONS; i++) {
+        for (int j = 0; j < f->data_p[i].len; j++) {
+            x = x * 1664525u + 1013904223u;
+            f->data_p[i].data[j] = (uint8_t)(x >> 24);
+        }
+    }
+}
+
+static int same(const func_call_t* a, const func_call_t* b)
+{
+    if (a->func != b->func)
+        return 0;
+    for (int i = 0; i < DATA_PORTIONS; i++) {
+        if (a->data_p[i].len != b->data_p[i].len)
+            return 0;
+        if (a->data_p[i].len &&
+            memcmp(a->data_p[i].data, b->data_p[i].data, a->data_p[i].len) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+static int payload_len(const uint8_t* pattern)
+{
+    int len = ID_LEN;
+
+    for (int i = 0; i < DATA_PORTIONS; i++)
+        len += pattern[i];
+    return len;
+}
+
+static int frames(const uint8_t* pattern)
+{
+    int n = 1;
+
+    for (int i = 0; i < DATA_PORTIONS; i++)
+        n += pattern[i] > 0;
+    return n;
+}
+
+static void* device_main(void* arg)
+{
+    device_t* dev = arg;
+    func_call_t req, expected, rsp;
+
+    if (wolfSSL_connect(dev->ssl) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "device: TLS handshake failed\n");
+        dev->errors++;
+        mem_link_close(dev->link);
+        return NULL;
+    }
+
+    for (int r = 0; r < dev->rounds; r++) {
+        memset(&req, 0, sizeof(req));
+        memset(&expected, 0, sizeof(expected));
+        memset(&rsp, 0, sizeof(rsp));
+
+        if (initFunc(&req, 0, dev->sc->request) ||
+            initFunc(&expected, dev->sc->id, dev->sc->request) ||
+            initFunc(&rsp, dev->sc->id, dev->sc->response)) {
+            dev->errors++;
+        } else {
+            fill(&expected, r, 0);
+            fill(&rsp, r, 1);
+
+            if (recChallenge(dev->ssl, &req) || !same(&req, &expected) ||
+                sendResponse(dev->ssl, &rsp))
+                dev->errors++;
+        }
+
+        freeFunc(&req);
+        freeFunc(&expected);
+        freeFunc(&rsp);
+        if (dev->errors) {
+            // Do not leave the server waiting for the response
+            mem_link_close(dev->link);
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* Runs one challenge type over a fresh link and connection. Returns the
+ * number of failed exchanges. */
+static int run_scenario(WOLFSSL_CTX* serverCtx, WOLFSSL_CTX* deviceCtx,
+                        const mem_link_config_t* cfg, const scenario_t* sc, int rounds)
+{
+    mem_link* link = NULL;
+    WOLFSSL* server = NULL;
+    device_t dev;
+    pthread_t thread;
+    func_call_t req, rsp, expected;
+    mem_link_stats_t st;
+    double start, host;
+    int payload;
+    int errors = 0;
+    int started = 0;
+
+    memset(&dev, 0, sizeof(dev));
+    link = mem_link_new(cfg);
+    server = wolfSSL_new(serverCtx);
+    dev.ssl = wolfSSL_new(deviceCtx);
+    if (!link || !server || !dev.ssl) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        errors = rounds;
+        goto exit;
+    }
+    mem_link_attach(link, server, 0);
+    mem_link_attach(link, dev.ssl, 1);
+    dev.link = link;
+    dev.sc = sc;
+    dev.rounds = rounds;
+
+    if (pthread_create(&thread, NULL, device_main, &dev) != 0) {
+        errors = rounds;
+        goto exit;
+    }
+    started = 1;
+
+    if (wolfSSL_accept(server) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "ERROR: TLS handshake failed\n");
+        errors = rounds;
+        goto exit;
+    }
+
+    /* Only the challenge traffic is measured */
+    mem_link_reset(link);
+    start = now();
+
+    for (int r = 0; r < rounds; r++) {
+        memset(&req, 0, sizeof(req));
+        memset(&rsp, 0, sizeof(rsp));
+        memset(&expected, 0, sizeof(expected));
+
+        if (initFunc(&req, sc->id, sc->request) ||
+            initFunc(&rsp, 0, sc->response) ||
+            initFunc(&expected, sc->id, sc->response)) {
+            errors++;
+        } else {
+            fill(&req, r, 0);
+            fill(&expected, r, 1);
+
+            if (sendChallenge(server, &req) || recResponse(server, &rsp) ||
+                !same(&rsp, &expected))
+                errors++;
+        }
+
+        freeFunc(&req);
+        freeFunc(&rsp);
+        freeFunc(&expected);
+        if (errors)
+            break;
+    }
+    host = now() - start;
+
+    /* The device reads the last ACK after the server is done */
+    if (errors)
+        mem_link_close(link);
+    pthread_join(thread, NULL);
+    started = 0;
+    errors += dev.errors;
+    mem_link_stats(link, &st);
+
+    payload = payload_len(sc->request) + payload_len(sc->response);
+    printf("%-22s %5d %5d %6.1f %6.1f %7.1f %9.2f %9.0f %8.1f%s\n", sc->name,
+           payload, frames(sc->request) + frames(sc->response),
+           (double)(st.bytes[0] + st.bytes[1]) / rounds,
+           (double)st.turns / rounds,
+           (double)(st.reads[0] + st.reads[1]) / rounds,
+           st.now_ns / 1e6 / rounds,
+           st.now_ns ? payload * rounds / (st.now_ns / 1e9) : 0.0,
+           host * 1e6 / rounds,
+           errors ? "  FAILED" : "");
+
+exit:
+    if (link)
+        mem_link_close(link);
+    if (started) {
+        pthread_join(thread, NULL);
+        errors += dev.errors;
+    }
+    if (server)
+        wolfSSL_free(server);
+    if (dev.ssl)
+        wolfSSL_free(dev.ssl);
+    mem_link_free(link);
+    return errors;
+}
+
+static WOLFSSL_CTX* new_ctx(int server, const char* certFile, const char* keyFile,
+                            const char* caFile)
+{
+    WOLFSSL_CTX* ctx;
+
+#ifdef USE_TLSV13
+    ctx = wolfSSL_CTX_new(server ? wolfTLSv1_3_server_method() : wolfTLSv1_3_client_method());
+#else
+    ctx = wolfSSL_CTX_new(server ? wolfTLSv1_2_server_method() : wolfTLSv1_2_client_method());
+#endif
+    if (ctx == NULL)
+        return NULL;
+
+    if (wolfSSL_CTX_set_cipher_list(ctx, "ECDHE-ECDSA-AES256-GCM-SHA384") != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_use_certificate_file(ctx, certFile, WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_use_PrivateKey_file(ctx, keyFile, WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_load_verify_locations(ctx, caFile, NULL) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "ERROR: failed to load %s, %s or %s\n", certFile, keyFile, caFile);
+        wolfSSL_CTX_free(ctx);
+        return NULL;
+    }
+    wolfSSL_CTX_set_verify(ctx, WOLFSSL_VERIFY_PEER | WOLFSSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+    return ctx;
+}
+
+int main(int argc, char** argv)
+{
+    mem_link_config_t cfg = {0};
+    WOLFSSL_CTX*      serverCtx = NULL;
+    WOLFSSL_CTX*      deviceCtx = NULL;
+    const char*       caFile = CA_FILE;
+    const char*       certFile = CERT_FILE;
+    const char*       keyFile = KEY_FILE;
+    int               rounds = DEFAULT_ROUNDS;
+    int               failed = 0;
+    int               ret = 1;
+    int               opt;
+
+    cfg.latency_us = DEFAULT_LATENCY_US;
+    cfg.bytes_per_sec = DEFAULT_BANDWIDTH;
+    cfg.chunk = DEFAULT_CHUNK;
+
+    while ((opt = getopt(argc, argv, "n:l:b:C:c:k:A:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            rounds = atoi(optarg);
+            break;
+        case 'l':
+            cfg.latency_us = strtoul(optarg, NULL, 10);
+            break;
+        case 'b':
+            cfg.bytes_per_sec = strtoul(optarg, NULL, 10);
+            break;
+        case 'C':
+            cfg.chunk = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            certFile = optarg;
+            break;
+        case 'k':
+            keyFile = optarg;
+            break;
+        case 'A':
+            caFile = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc || rounds < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* The frame pause is real time, the link has its own clock */
+    setFrameDelay(0);
+    wolfSSL_Init();
+
+    serverCtx = new_ctx(1, certFile, keyFile, caFile);
+    deviceCtx = new_ctx(0, certFile, keyFile, caFile);
+    if (!serverCtx || !deviceCtx)
+        goto exit;
+
+    printf("Link: %u us latency, ", cfg.latency_us);
+    if (cfg.bytes_per_sec)
+        printf("%u bytes/s, ", cfg.bytes_per_sec);
+    else
+        printf("unlimited bandwidth, ");
+    if (cfg.chunk)
+        printf("reads of up to %u bytes, %d rounds\n", cfg.chunk, rounds);
+    else
+        printf("unchunked reads, %d rounds\n", rounds);
+    printf("Per exchange: payload and frames both ways, TLS bytes on the wire, turns of\n"
+           "direction, read calls, link time, payload goodput, host CPU time\n\n");
+    printf("%-22s %5s %5s %6s %6s %7s %9s %9s %8s\n", "challenge", "bytes", "frms",
+           "wire", "turns", "reads", "link ms", "B/s", "host us");
+
+    for (int i = 0; i < SCENARIOS; i++)
+        failed += run_scenario(serverCtx, deviceCtx, &cfg, &scenarios[i], rounds);
+
+    if (failed)
+        fprintf(stderr, "%d exchange(s) failed\n", failed);
+    ret = failed ? 1 : 0;
+
+exit:
+    if (serverCtx)
+        wolfSSL_CTX_free(serverCtx);
+    if (deviceCtx)
+        wolfSSL_CTX_free(deviceCtx);
+    wolfSSL_Cleanup();
+    return ret;
+}
@@ -24,6 +24,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 
 /* socket includes */
 #include <sys/socket.h>
@@ -37,11 +38,18 @@
 #include <wolfssl/wolfcrypt/wc_pkcs11.h>
 
 #include "include/common/log.h"
+#include "include/key_backend.h"
+#include "include/util.h"
+#include "include/keyshare_pool.h"
+#include "include/cipher_tune.h"
+#include "include/pinned_keys.h"
 
 #ifdef RPI_CBA
+  #include <fcntl.h>
   #include <tee_client_api.h>
   #include "include/context_based_authentication.h"
   #include "include/common/challenge.h"
+  #include "include/auth_ticket.h"
 #endif
 
 #define DEFAULT_PORT 12345
@@ -53,6 +61,15 @@
 #define SLOT_ID 1
 #define PRIV_KEY_ID  {0x01}
 
+/* Ephemeral ECDHE keys made ahead of the handshakes */
+#define KEYSHARE_POOL_KEYS 8
+
+#ifdef RPI_CBA
+#define CBA_OPTS "t:"
+#else
+#define CBA_OPTS ""
+#endif
+
 #ifdef RPI_CBA
 TEEC_Result CBAEnroll() {
     TEEC_Result res;
@@ -155,8 +172,146 @@ TEEC_Result CBAProve(char* nonce, size_t nonce_size, char* signature, size_t sig
 
     return TEEC_SUCCESS;
 }
+
+/* Offers the ticket saved in path, or tells the server there is none if
+ * the file is missing or path is NULL */
+int offerTicket(WOLFSSL* ssl, const char* path)
+{
+    uint8_t grant[AUTH_TICKET_GRANT_LEN], offer[AUTH_TICKET_OFFER_LEN];
+    int haveTicket = 0;
+    FILE* file;
+
+    file = path != NULL ? fopen(path, "rb") : NULL;
+    if (file != NULL) {
+        if (fread(grant, 1, sizeof(grant), file) == sizeof(grant))
+            haveTicket = auth_ticket_offer(ssl, grant, offer) == 0;
+        fclose(file);
+        memset(grant, 0, sizeof(grant));
+    }
+
+    return CBAOfferTicket(ssl, haveTicket ? offer : NULL, sizeof(offer));
+}
+
+/* Receives the ticket granted after CBA and saves it in path, or drops it
+ * if path is NULL. The file holds the ticket's secret, so only its owner
+ * may read it. */
+int saveTicket(WOLFSSL* ssl, const char* path)
+{
+    uint8_t grant[AUTH_TICKET_GRANT_LEN];
+    int fd, ret = -1;
+
+    if (CBARecTicketGrant(ssl, grant, sizeof(grant)))
+        return -1;
+    if (path == NULL)
+        return 0;
+
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd >= 0) {
+        if (write(fd, grant, sizeof(grant)) == sizeof(grant))
+            ret = 0;
+        close(fd);
+    }
+    memset(grant, 0, sizeof(grant));
+    return ret;
+}
 #endif /* RPI_CBA */
 
+int cmpDouble(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+void usage(const char* prog, const key_backend_config_t* keyCfg)
+{
+    printf("usage: %s [options] <IPv4 address>\n", prog);
+    key_backend_usage(keyCfg);
+    printf("  -C aead      Bulk cipher: auto (time both at startup), aes or chacha\n"
+           "               (default auto)\n");
+    printf("  -K file      Accept only a server whose public key is listed in file,\n"
+           "               as SHA-256 of the SubjectPublicKeyInfo, instead of\n"
+           "               validating its chain against %s\n", CA_FILE);
+#ifdef RPI_CBA
+    printf("  -t file      Offer the ticket in file to skip CBA, and save the\n"
+           "               ticket granted after a full CBA there\n");
+#endif
+    printf("  -B count     Benchmark: run count handshakes, one connection each,\n"
+           "               then print latency and exit\n");
+    printf("  -h           Show this help\n");
+}
+
+/* Connects count times and closes every connection right after the
+ * handshake. Reports the latency from connect() to the end of the
+ * handshake, and the share of it spent in the key backend. */
+int benchHandshakes(WOLFSSL_CTX* ctx, key_backend* keys, const char* backend,
+                    const struct sockaddr_in* servAddr, int count)
+{
+    key_backend_stats_t before, after;
+    double* latency;
+    double start, total = 0, tokenMs;
+    int fd, done = 0, ret = 0;
+    WOLFSSL* ssl;
+
+    latency = calloc(count, sizeof(*latency));
+    if (latency == NULL)
+        return -1;
+
+    key_backend_stats(keys, &before);
+    for (int i = 0; i < count; i++) {
+        if ((fd = socket(AF_INET, SOCK_STREAM, 0)) == -1) {
+            fprintf(stderr, "ERROR: failed to create the socket\n");
+            ret = -1;
+            break;
+        }
+
+        start = now_ns() / 1e6;
+        if (connect(fd, (const struct sockaddr*)servAddr, sizeof(*servAddr)) == -1) {
+            fprintf(stderr, "ERROR: failed to connect\n");
+            close(fd);
+            ret = -1;
+            break;
+        }
+
+        if (key_backend_open_session(keys) != 0) {
+            fprintf(stderr, "ERROR: failed to open session on token\n");
+            close(fd);
+            ret = -1;
+            break;
+        }
+
+        ssl = wolfSSL_new(ctx);
+        if (ssl == NULL || wolfSSL_set_fd(ssl, fd) != WOLFSSL_SUCCESS ||
+            wolfSSL_connect(ssl) != WOLFSSL_SUCCESS) {
+            fprintf(stderr, "ERROR: handshake %d failed\n", i + 1);
+            ret = -1;
+        } else {
+            latency[done] = now_ns() / 1e6 - start;
+            total += latency[done++];
+        }
+
+        wolfSSL_free(ssl);
+        key_backend_close_session(keys);
+        close(fd);
+        if (ret != 0)
+            break;
+    }
+    key_backend_stats(keys, &after);
+
+    if (done > 0) {
+        tokenMs = (after.ns - before.ns) / 1e6 / done;
+        qsort(latency, done, sizeof(*latency), cmpDouble);
+        printf("%s backend: %d handshakes, mean %.2f ms, p50 %.2f ms, p99 %.2f ms\n",
+               backend, done, total / done, latency[done / 2],
+               latency[(done * 99) / 100]);
+        printf("%s backend: %.2f ms and %.1f token operations per handshake\n",
+               backend, tokenMs, (double)(after.ops - before.ops) / done);
+    }
+
+    free(latency);
+    return ret;
+}
+
 int main(int argc, char** argv)
 {
     int                sockfd;
@@ -171,17 +326,33 @@ int main(int argc, char** argv)
     WOLFSSL*     ssl;
     WOLFSSL_CIPHER* cipher;
 
+    key_backend_config_t keyCfg = {
+        .type = KEY_BACKEND_OPTEE,
 #ifdef RPI_CBA
-    const char* library = "/usr/lib/libckteec2.so";
+        .optee_module = "/usr/lib/libckteec2.so",
 #else
-    const char* library = "/usr/lib/libckteec.so";
+        .optee_module = "/usr/lib/libckteec.so",
 #endif /* ifdef RPI_CBA */
-    const char* tokenName = "ClientToken";
-    const char* userPin = "1234";
-    Pkcs11Dev dev;
-    Pkcs11Token token;
-    int slotId = SLOT_ID;
+        .token_name = "ClientToken",
+        .user_pin = "1234",
+        .slot_id = SLOT_ID,
+        .key_file = KEY_FILE,
+    };
+    key_backend* keys = NULL;
+    keyshare_pool* keyShares = NULL;
+    keyshare_pool_stats_t keyShareStats;
     int devId = 1;
+    int benchCount = 0;
+    cipher_pref_t cipherPref = CIPHER_PREF_AUTO;
+    const char* pinFile = NULL;
+    pinned_keys* pins = NULL;
+    int opt;
+
+#ifdef RPI_CBA
+    const char* ticketFile = NULL;
+    uint32_t CBAFlags;
+    double authStart;
+#endif
 
 #ifdef DEBUG
     fprintf(stdout, "Debug enabled!\n");
@@ -198,31 +369,40 @@ int main(int argc, char** argv)
     const uint8_t CBANoncePatternSize[DATA_PORTIONS] = {(uint8_t)CBA_NONCE_SIZE};
 #endif
 
+    memcpy(keyCfg.key_id, privKeyId, sizeof(privKeyId));
+    keyCfg.key_id_len = sizeof(privKeyId);
+
     /* Check for proper calling convention */
-    if (argc != 2) {
-        printf("usage: %s <IPv4 address>\n", argv[0]);
+    while ((opt = getopt(argc, argv, KEY_BACKEND_OPTS "B:C:K:h" CBA_OPTS)) != -1) {
+        if (opt == 'B' && (benchCount = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'C' && cipher_tune_parse(optarg, &cipherPref) == 0)
+            continue;
+        if (opt == 'K') {
+            pinFile = optarg;
+            continue;
+        }
+#ifdef RPI_CBA
+        if (opt == 't') {
+            ticketFile = optarg;
+            continue;
+        }
+#endif
+        if (opt != 'B' && opt != 'C' && opt != 'h' &&
+            key_backend_parse_opt(&keyCfg, opt, optarg) == 0)
+            continue;
+        usage(argv[0], &keyCfg);
+        return opt == 'h' ? 0 : 1;
+    }
+    if (optind != argc - 1) {
+        usage(argv[0], &keyCfg);
         return 0;
     }
 
     wolfCrypt_Init();
-    ret = wc_Pkcs11_Initialize(&dev, library, NULL);
-    if (ret != 0) {
-      fprintf(stderr, "Failed to initialize PKCS#11 library\n");
-      return ret;
-    }
-
-    ret = wc_Pkcs11Token_Init(&token, &dev, slotId, tokenName, (byte *)userPin,
-                              strlen(userPin));
-    if (ret != 0) {
-      fprintf(stderr, "Failed to initialize PKCS#11 token\n");
-      return ret;
-    }
-
-    ret = wc_CryptoDev_RegisterDevice(devId, wc_Pkcs11_CryptoDevCb, &token);
-    if (ret != 0) {
-      fprintf(stderr, "Failed to register PKCS#11 token\n");
-      return ret;
-    }
+    keys = key_backend_new(&keyCfg, devId);
+    if (keys == NULL)
+      return -1;
 
 #ifdef RPI_CBA
      ret = CBAEnroll();
@@ -249,14 +429,14 @@ int main(int argc, char** argv)
     servAddr.sin_port   = htons(DEFAULT_PORT); /* on DEFAULT_PORT */
 
     /* Get the server IPv4 address from the command line call */
-    if (inet_pton(AF_INET, argv[1], &servAddr.sin_addr) != 1) {
+    if (inet_pton(AF_INET, argv[optind], &servAddr.sin_addr) != 1) {
         fprintf(stderr, "ERROR: invalid address\n");
         ret = -1;
         goto end;
     }
 
-    /* Connect to the server */
-    ret = connect(sockfd, (struct sockaddr*) &servAddr, sizeof(servAddr));
+    /* Connect to the server, the benchmark opens its own connections */
+    ret = benchCount ? 0 : connect(sockfd, (struct sockaddr*) &servAddr, sizeof(servAddr));
     if (ret == -1) {
         fprintf(stderr, "ERROR: failed to connect\n");
         goto end;
@@ -272,6 +452,9 @@ int main(int argc, char** argv)
         goto socket_cleanup;
     }
 
+    /* Starts making ECDHE keys while the rest is set up */
+    keyShares = keyshare_pool_new(KEYSHARE_POOL_KEYS);
+
     /* Create and initialize WOLFSSL_CTX */
 #ifdef USE_TLSV13
     ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method());
@@ -284,15 +467,7 @@ int main(int argc, char** argv)
         goto socket_cleanup;
     }
 
-    if (wolfSSL_CTX_set_cipher_list(ctx, "ECDHE-ECDSA-AES256-GCM-SHA384") != WOLFSSL_SUCCESS) {
-        fprintf(stderr, "Failed to set cipher list\n");
-        ret = -1;
-        goto ctx_cleanup;
-    }
-
-    /* Set devId associated with the PKCS11 device. */
-    if (wolfSSL_CTX_SetDevId(ctx, devId) != WOLFSSL_SUCCESS) {
-        fprintf(stderr, "ERROR: failed to create WOLFSSL_CTX\n");
+    if (cipher_tune_apply(ctx, cipherPref) != 0) {
         ret = -1;
         goto ctx_cleanup;
     }
@@ -307,27 +482,60 @@ int main(int argc, char** argv)
     }
 
     /* Load client key into WOLFSSL_CTX */
-    if (wolfSSL_CTX_use_PrivateKey_Id(ctx, privKeyId, sizeof(privKeyId), devId) != SSL_SUCCESS) {
-        fprintf(stderr, "ERROR: failed to set id.\n");
+    if (key_backend_use(keys, ctx) != 0) {
         ret = -1;
         goto ctx_cleanup;
     }
 
-    /* Load CA certificate into WOLFSSL_CTX for validating peer */
-    ret = wolfSSL_CTX_load_verify_locations(ctx, CA_FILE, NULL);
-    if (ret != WOLFSSL_SUCCESS) {
-        const char *errString = wc_GetErrorString(ret);
-        fprintf(stderr, "ERROR: failed to load %s, please check the file (%d).\n",
-                CA_FILE, ret);
-        fprintf(stderr, "wolfSSL error: %s (%d)\n", errString, ret);
+    /* Without PK callbacks wolfSSL makes its ECDHE keys inline */
+    if (keyShares && keyshare_pool_attach(keyShares, ctx) != 0) {
+        keyshare_pool_free(keyShares);
+        keyShares = NULL;
+    }
+
+    if (pinFile) {
+        /* Authenticate the server by its key alone, no CA is loaded */
+        pins = pinned_keys_load(pinFile);
+        if (pins == NULL) {
+            ret = -1;
+            goto ctx_cleanup;
+        }
+        if (pinned_keys_attach(pins, ctx, WOLFSSL_VERIFY_PEER) != 0) {
+            fprintf(stderr, "ERROR: failed to attach the pinned keys\n");
+            ret = -1;
+            goto ctx_cleanup;
+        }
+    }
+    else {
+        /* Load CA certificate into WOLFSSL_CTX for validating peer */
+        ret = wolfSSL_CTX_load_verify_locations(ctx, CA_FILE, NULL);
+        if (ret != WOLFSSL_SUCCESS) {
+            const char *errString = wc_GetErrorString(ret);
+            fprintf(stderr, "ERROR: failed to load %s, please check the file (%d).\n",
+                    CA_FILE, ret);
+            fprintf(stderr, "wolfSSL error: %s (%d)\n", errString, ret);
+            goto ctx_cleanup;
+        }
+
+        /* validate peer certificate */
+        wolfSSL_CTX_set_verify(ctx, WOLFSSL_VERIFY_PEER, NULL);
+    }
+
+    if (benchCount) {
+        ret = benchHandshakes(ctx, keys, key_backend_name(keyCfg.type),
+                              &servAddr, benchCount);
+        if (keyShares) {
+            keyshare_pool_stats(keyShares, &keyShareStats);
+            printf("Key shares: %llu from the pool, %llu underruns, lowest depth %u\n",
+                   (unsigned long long)keyShareStats.hits,
+                   (unsigned long long)keyShareStats.underruns,
+                   keyShareStats.min_depth);
+        }
         goto ctx_cleanup;
     }
 
-    /* validate peer certificate */
-    wolfSSL_CTX_set_verify(ctx, WOLFSSL_VERIFY_PEER, NULL);
-
     /* Open the PKCS11 token. */
-    ret = wc_Pkcs11Token_Open(&token, 1);
+    ret = key_backend_open_session(keys);
     if (ret != 0) {
         fprintf(stderr, "ERROR: failed to open session on token (%d)\n", ret);
         return -1;
@@ -374,42 +582,77 @@ int main(int argc, char** argv)
     }
     memcpy(CBAResponce.data_p[0].data, CBASignature, (size_t)CBAResponce.data_p[0].len);
 
+    /* The server expects an offer either way, so -t on one side only
+     * still works */
+    authStart = now_ns() / 1e6;
+    if (offerTicket(ssl, ticketFile)) {
+      fprintf(stderr, "ERROR: failed to offer the ticket!\n");
+      goto exit;
+    }
+
     LOCAL_LOG_DBG("Attempting to receive challenge!");
 
-    if (recChallenge(ssl, &CBARequest)) {
+    if (CBARecRequest(ssl, &CBARequest, &CBAFlags)) {
       fprintf(stderr, "ERROR: recChallenge() failed!\n");
       goto exit;
     }
 
-    memcpy(CBANonce, CBARequest.data_p[0].data, (size_t)CBANoncePatternSize[0]);
+    if (CBARequest.func == CBA_TICKET_ACCEPTED) {
+        printf("Ticket accepted, CBA skipped\n");
+    }
+    else if (CBARequest.func != CBA_PROVE_IDENTITY) {
+        fprintf(stderr, "ERROR: unexpected CBA request 0x%08X!\n", (unsigned)CBARequest.func);
+        goto exit;
+    }
+    else {
+        /* The server picks the nonce, a derived one is not sent */
+        if (CBAFlags & CBA_CHANNEL_NONCE) {
+          if (CBAChannelNonce(ssl, CBANonce, CBANonceSize)) {
+            fprintf(stderr, "ERROR: CBAChannelNonce() failed!\n");
+            goto exit;
+          }
+        }
+        else {
+          if (recPortions(ssl, &CBARequest)) {
+            fprintf(stderr, "ERROR: recChallenge() failed!\n");
+            goto exit;
+          }
 
-    LOCAL_LOG_DBG("Attempting CBAProve!");
+          memcpy(CBANonce, CBARequest.data_p[0].data, (size_t)CBANoncePatternSize[0]);
+        }
 
-    if (CBAProve(CBANonce, CBANonceSize, CBASignature, CBASignatureBufferSize, &CBASignatureSize)) {
-      fprintf(stderr, "CBAProve() failed!\n");
-      LOCAL_LOG_DBG("Mocking up the signature!");
-      memset(CBASignature, 1, CBA_SIGNATURE_BUFFER_SIZE / 8);
-      CBASignatureSize = CBA_SIGNATURE_BUFFER_SIZE / 8;
-    }
+        LOCAL_LOG_DBG("Attempting CBAProve!");
 
-    if (CBASignatureSize >= CBASignaturePatternSize[0]) {
-      fprintf(stderr, "EROOR: The CBA signature is bigger than allocated communication buffer!\n");
-      goto exit;
-    }
+        if (CBAProve(CBANonce, CBANonceSize, CBASignature, CBASignatureBufferSize, &CBASignatureSize)) {
+          fprintf(stderr, "CBAProve() failed!\n");
+          LOCAL_LOG_DBG("Mocking up the signature!");
+          memset(CBASignature, 1, CBA_SIGNATURE_BUFFER_SIZE / 8);
+          CBASignatureSize = CBA_SIGNATURE_BUFFER_SIZE / 8;
+        }
 
-    LOCAL_LOG_DBG("Signature size is: %d", CBASignatureSize);
-    LOCAL_LOG_DBG("Message buffer size is: %d", CBAResponce.data_p[0].len);
+        if (CBASignatureSize >= CBASignaturePatternSize[0]) {
+          fprintf(stderr, "EROOR: The CBA signature is bigger than allocated communication buffer!\n");
+          goto exit;
+        }
 
-    memcpy(CBAResponce.data_p[0].data, CBASignature, CBASignatureSize);
-    memset(CBAResponce.data_p[0].data + CBASignatureSize, '\0', sizeof(char));
+        LOCAL_LOG_DBG("Signature size is: %d", CBASignatureSize);
+        LOCAL_LOG_DBG("Message buffer size is: %d", CBAResponce.data_p[0].len);
 
-    LOCAL_LOG_HEXDUMP_DBG(CBAResponce.data_p[0].data, CBAResponce.data_p[0].len, "Signature:");
-    LOCAL_LOG_DBG("Attempting to send response!");
+        memcpy(CBAResponce.data_p[0].data, CBASignature, CBASignatureSize);
+        memset(CBAResponce.data_p[0].data + CBASignatureSize, '\0', sizeof(char));
 
-    if (sendResponse(ssl, &CBAResponce)) {
-      fprintf(stderr, "ERROR: sendResponce() failed!\n");
-      goto exit;
+        LOCAL_LOG_HEXDUMP_DBG(CBAResponce.data_p[0].data, CBAResponce.data_p[0].len, "Signature:");
+        LOCAL_LOG_DBG("Attempting to send response!");
+
+        if (sendResponse(ssl, &CBAResponce)) {
+          fprintf(stderr, "ERROR: sendResponce() failed!\n");
+          goto exit;
+        }
+
+        if ((CBAFlags & CBA_TICKET_GRANT_FOLLOWS) && saveTicket(ssl, ticketFile))
+          fprintf(stderr, "WARNING: failed to save the ticket, the next connection runs CBA\n");
     }
+    printf("Second factor took %.1f ms\n", now_ns() / 1e6 - authStart);
 #endif /* RPI_CBA */
 
     /* Get a message for the server from stdin */
@@ -452,9 +695,7 @@ int main(int argc, char** argv)
 
     /* Cleanup and return */
     // FIXME: Segmentation fault
-    wc_Pkcs11Token_Close(&token);
-    wc_Pkcs11Token_Final(&token);
-    wc_Pkcs11_Finalize(&dev);
+    key_backend_close_session(keys);
 
 exit:
 #ifdef RPI_CBA
@@ -466,9 +707,12 @@ cleanup:
   wolfSSL_free(ssl); /* Free the wolfSSL object                  */
 ctx_cleanup:
   wolfSSL_CTX_free(ctx);  /* Free the wolfSSL context object          */
+  keyshare_pool_free(keyShares);
+  pinned_keys_free(pins);
   wolfSSL_Cleanup();      /* Cleanup the wolfSSL environment          */
 socket_cleanup:
   close(sockfd); /* Close the connection to the server       */
 end:
+  key_backend_free(keys);
   return ret; /* Return reporting a success               */
 }
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/hmac.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+#include "auth_ticket.h"
+#include "util.h"
+
+#define EXPIRY_LEN 8
+#define ID_LEN     16
+#define MAC_LEN    WC_SHA256_DIGEST_SIZE
+#define KEY_LEN    32
+
+#define EXPORTER_LABEL "EXPORTER-uc12-auth-ticket"
+
+struct auth_ticket_issuer {
+    uint8_t key[KEY_LEN];
+    uint32_t ttl_s;
+    WC_RNG rng;
+    auth_ticket_stats_t stats;
+};
+
+// Compares in constant time
+static int differs(const uint8_t *a, const uint8_t *b, size_t len) {
+    uint8_t acc = 0;
+
+    while (len--)
+        acc |= *a++ ^ *b++;
+    return acc != 0;
+}
+
+static int hmac(const uint8_t *key, size_t key_len, const char *label,
+                const uint8_t *a, size_t a_len, const uint8_t *b, size_t b_len,
+                uint8_t *out) {
+    Hmac mac;
+    int ret;
+
+    if (wc_HmacInit(&mac, NULL, INVALID_DEVID) != 0)
+        return -1;
+    ret = wc_HmacSetKey(&mac, WC_SHA256, key, (word32)key_len);
+    if (ret == 0)
+        ret = wc_HmacUpdate(&mac, (const byte *)label, (word32)strlen(label) + 1);
+    if (ret == 0)
+        ret = wc_HmacUpdate(&mac, a, (word32)a_len);
+    if (ret == 0 && b_len)
+        ret = wc_HmacUpdate(&mac, b, (word32)b_len);
+    if (ret == 0)
+        ret = wc_HmacFinal(&mac, out);
+    wc_HmacFree(&mac);
+    return ret == 0 ? 0 : -1;
+}
+
+static int peer_fingerprint(WOLFSSL *ssl, uint8_t *fp) {
+    WOLFSSL_X509 *peer;
+    int ret;
+
+    peer = wolfSSL_get_peer_certificate(ssl);
+    if (!peer)
+        return -1;
+
+    ret = cert_fingerprint(peer, fp);
+    wolfSSL_X509_free(peer);
+    return ret;
+}
+
+// The ticket's MAC and the client's secret, both over the certificate and
+// the expiry and id at the start of the ticket
+static int derive(const auth_ticket_issuer *issuer, const uint8_t *fp,
+                  const uint8_t *ticket, uint8_t *tag, uint8_t *secret) {
+    if (hmac(issuer->key, KEY_LEN, "tag", fp, CERT_FINGERPRINT_LEN,
+             ticket, EXPIRY_LEN + ID_LEN, tag))
+        return -1;
+    if (secret &&
+        hmac(issuer->key, KEY_LEN, "secret", fp, CERT_FINGERPRINT_LEN,
+             ticket, EXPIRY_LEN + ID_LEN, secret))
+        return -1;
+    return 0;
+}
+
+static int binder(WOLFSSL *ssl, const uint8_t *secret, const uint8_t *ticket, uint8_t *out) {
+#ifdef HAVE_KEYING_MATERIAL
+    uint8_t ekm[MAC_LEN];
+    int ret;
+
+    if (wolfSSL_export_keying_material(ssl, ekm, sizeof(ekm), EXPORTER_LABEL,
+                                       strlen(EXPORTER_LABEL), NULL, 0, 0) != WOLFSSL_SUCCESS)
+        return -1;
+    ret = hmac(secret, AUTH_TICKET_SECRET_LEN, "binder", ekm, sizeof(ekm),
+               ticket, AUTH_TICKET_LEN, out);
+    wipe(ekm, sizeof(ekm));
+    return ret;
+#else
+    (void)ssl;
+    (void)secret;
+    (void)ticket;
+    (void)out;
+    return -1;
+#endif
+}
+
+auth_ticket_issuer *auth_ticket_issuer_new(uint32_t ttl_s) {
+#ifndef HAVE_KEYING_MATERIAL
+    (void)ttl_s;
+    fprintf(stderr, "Auth tickets: wolfSSL lacks HAVE_KEYING_MATERIAL\n");
+    return NULL;
+#else
+    auth_ticket_issuer *issuer = calloc(1, sizeof(*issuer));
+
+    if (!issuer)
+        return NULL;
+
+    if (wc_InitRng(&issuer->rng) != 0) {
+        free(issuer);
+        return NULL;
+    }
+    if (wc_RNG_GenerateBlock(&issuer->rng, issuer->key, KEY_LEN) != 0) {
+        wc_FreeRng(&issuer->rng);
+        free(issuer);
+        return NULL;
+    }
+    issuer->ttl_s = ttl_s;
+    return issuer;
+#endif
+}
+
+void auth_ticket_issuer_free(auth_ticket_issuer *issuer) {
+    if (!issuer)
+        return;
+
+    wc_FreeRng(&issuer->rng);
+    wipe(issuer->key, KEY_LEN);
+    free(issuer);
+}
+
+int auth_ticket_issue(auth_ticket_issuer *issuer, WOLFSSL *ssl,
+                      uint8_t grant[AUTH_TICKET_GRANT_LEN]) {
+    uint64_t expiry = (uint64_t)time(NULL) + issuer->ttl_s;
+    uint8_t fp[CERT_FINGERPRINT_LEN];
+
+    if (peer_fingerprint(ssl, fp) != 0)
+        return -1;
+
+    for (int i = 0; i < EXPIRY_LEN; i++)
+        grant[i] = (uint8_t)(expiry >> (8 * (EXPIRY_LEN - 1 - i)));
+    if (wc_RNG_GenerateBlock(&issuer->rng, grant + EXPIRY_LEN, ID_LEN) != 0 ||
+        derive(issuer, fp, grant, grant + EXPIRY_LEN + ID_LEN, grant + AUTH_TICKET_LEN) != 0) {
+        wipe(grant, AUTH_TICKET_GRANT_LEN);
+        return -1;
+    }
+
+    issuer->stats.issued++;
+    return 0;
+}
+
+int auth_ticket_check(auth_ticket_issuer *issuer, WOLFSSL *ssl,
+                      const uint8_t offer[AUTH_TICKET_OFFER_LEN]) {
+    uint8_t fp[CERT_FINGERPRINT_LEN], tag[MAC_LEN], secret[AUTH_TICKET_SECRET_LEN], expected[MAC_LEN];
+    uint8_t none = 0;
+    uint64_t expiry = 0;
+    int ok;
+
+    for (int i = 0; i < AUTH_TICKET_OFFER_LEN; i++)
+        none |= offer[i];
+    if (!none)
+        return -1;
+
+    issuer->stats.offers++;
+    for (int i = 0; i < EXPIRY_LEN; i++)
+        expiry = expiry << 8 | offer[i];
+    if (expiry <= (uint64_t)time(NULL)) {
+        issuer->stats.expired++;
+        return -1;
+    }
+
+    ok = peer_fingerprint(ssl, fp) == 0 &&
+         derive(issuer, fp, offer, tag, secret) == 0 &&
+         !differs(tag, offer + EXPIRY_LEN + ID_LEN, MAC_LEN) &&
+         binder(ssl, secret, offer, expected) == 0 &&
+         !differs(expected, offer + AUTH_TICKET_LEN, MAC_LEN);
+    wipe(secret, sizeof(secret));
+
+    if (!ok) {
+        issuer->stats.invalid++;
+        return -1;
+    }
+    issuer->stats.accepted++;
+    return 0;
+}
+
+void auth_ticket_stats(const auth_ticket_issuer *issuer, auth_ticket_stats_t *stats) {
+    *stats = issuer->stats;
+}
+
+int auth_ticket_offer(WOLFSSL *ssl, const uint8_t grant[AUTH_TICKET_GRANT_LEN],
+                      uint8_t offer[AUTH_TICKET_OFFER_LEN]) {
+    memcpy(offer, grant, AUTH_TICKET_LEN);
+    if (binder(ssl, grant + AUTH_TICKET_LEN, grant, offer + AUTH_TICKET_LEN) != 0) {
+        memset(offer, 0, AUTH_TICKET_OFFER_LEN);
+        return -1;
+    }
+    return 0;
+}
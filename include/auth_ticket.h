@@ -0,0 +1,54 @@
+#ifndef AUTH_TICKET_H
+#define AUTH_TICKET_H
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#define AUTH_TICKET_LEN        56   /* expiry, id and MAC, opaque to the client */
+#define AUTH_TICKET_SECRET_LEN 32
+#define AUTH_TICKET_GRANT_LEN  (AUTH_TICKET_LEN + AUTH_TICKET_SECRET_LEN)
+#define AUTH_TICKET_OFFER_LEN  (AUTH_TICKET_LEN + 32)
+
+/* Short-lived proof that a client passed the second factor, so that it can
+ * skip it when it reconnects within the TTL. The server grants a ticket
+ * over the TLS channel after a full second factor. The ticket is MAC'd
+ * with a key that only lives in the server's memory and is bound to the
+ * SHA-256 of the client certificate, and comes with a secret for the client.
+ * On a later connection the client offers the ticket together with a
+ * binder, a MAC with that secret over exporter keying material of the new
+ * TLS session. So an offer only counts for the certificate it was issued to
+ * and for the channel it is sent on. Restarting the server revokes all
+ * tickets.
+ *
+ * Needs wolfSSL built with HAVE_KEYING_MATERIAL. */
+typedef struct auth_ticket_issuer auth_ticket_issuer;
+
+typedef struct {
+    uint64_t offers;            /* tickets presented */
+    uint64_t accepted;
+    uint64_t expired;
+    uint64_t invalid;           /* bad MAC, binder or certificate */
+    uint64_t issued;
+} auth_ticket_stats_t;
+
+/* Returns NULL if wolfSSL lacks keying material exporters. */
+auth_ticket_issuer *auth_ticket_issuer_new(uint32_t ttl_s);
+void auth_ticket_issuer_free(auth_ticket_issuer *issuer);
+
+/* Grants the peer of ssl a ticket and its secret. */
+int auth_ticket_issue(auth_ticket_issuer *issuer, WOLFSSL *ssl,
+                      uint8_t grant[AUTH_TICKET_GRANT_LEN]);
+
+/* Returns 0 if offer is a live ticket issued to the peer of ssl and bound
+ * to this session. An all zero offer means the client has no ticket, it
+ * fails without being counted. */
+int auth_ticket_check(auth_ticket_issuer *issuer, WOLFSSL *ssl,
+                      const uint8_t offer[AUTH_TICKET_OFFER_LEN]);
+
+void auth_ticket_stats(const auth_ticket_issuer *issuer, auth_ticket_stats_t *stats);
+
+/* Client side: makes the offer for grant on the session of ssl. */
+int auth_ticket_offer(WOLFSSL *ssl, const uint8_t grant[AUTH_TICKET_GRANT_LEN],
+                      uint8_t offer[AUTH_TICKET_OFFER_LEN]);
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef CIPHER_TUNE_H
+#define CIPHER_TUNE_H
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+/* Picks the AEAD for bulk data. Cores without AES instructions, such as the
+ * Pi 4's Cortex-A72, are often faster with ChaCha20-Poly1305 than with
+ * AES-GCM, so by default both are timed on the running CPU at startup and
+ * the faster one goes first in the cipher list. The server's order decides,
+ * the client's only matters against servers honouring client preference. */
+typedef enum {
+    CIPHER_PREF_AUTO,
+    CIPHER_PREF_AESGCM,
+    CIPHER_PREF_CHACHA,
+} cipher_pref_t;
+
+/* Parses auto, aes or chacha. Returns 0 on success. */
+int cipher_tune_parse(const char *arg, cipher_pref_t *pref);
+
+/* Resolves CIPHER_PREF_AUTO by timing both AEADs over TLS record sized
+ * buffers, logs the result, and sets the ECDHE-ECDSA suites of both TLS
+ * versions on ctx in that order. */
+int cipher_tune_apply(WOLFSSL_CTX *ctx, cipher_pref_t pref);
+
+#endif
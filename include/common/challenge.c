@@ -1,9 +1,15 @@
+#ifndef IS_ZEPHYR
+  // The wolfSSL build options, HAVE_KEYING_MATERIAL among them
+  #include <wolfssl/options.h>
+#endif
 #include "challenge.h"
 #include <wolfssl/ssl.h>
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
+#include <errno.h>
+#include <time.h>
 #include "transmission.h"
 #include "log.h"
 
@@ -17,19 +23,46 @@
 const uint8_t pattern_init_commit[4] = {32, 32, 32, 32};
 const uint8_t pattern_proofs[4] = {32, 32, 64, 64};
 
+const uint8_t pattern_none[4] = {0, 0, 0, 0};
+const uint8_t pattern_commit_request[4] = {32, 32, 0, 0};
+const uint8_t pattern_proofs_request[4] = {32, 32, 64, 0};
+const uint8_t pattern_init_compressed[4] = {COMPRESSED_POINT_LEN, COMPRESSED_POINT_LEN, 0, 0};
+const uint8_t pattern_commit_compressed[4] = {COMPRESSED_POINT_LEN, 0, 0, 0};
+const uint8_t pattern_proofs_compressed[4] = {COMPRESSED_POINT_LEN, 64, 64, 0};
+
 /* Workarounds */
 
-// This function is a workaround for multiple buffering layers on LPC side
-void waitASec() {
-const uint8_t time = 1; // second
+#ifndef PUF_FRAME_DELAY_MS
+#define PUF_FRAME_DELAY_MS 1000
+#endif
+
+static uint32_t frameDelayMs = PUF_FRAME_DELAY_MS;
+
+void setFrameDelay(uint32_t ms) {
+    frameDelayMs = ms;
+}
 
+void sleepUs(uint64_t us) {
 #ifdef IS_ZEPHYR
-    k_msleep(time * 1000);
+    k_usleep(us);
 #else
-    sleep(time);
+    struct timespec ts = {
+        .tv_sec = us / 1000000,
+        .tv_nsec = (us % 1000000) * 1000L,
+    };
+
+    // Sleep the remainder when a signal cuts the pause short
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+        ;
 #endif
 }
 
+// This function is a workaround for multiple buffering layers on LPC side
+void waitASec() {
+    if (frameDelayMs)
+        sleepUs((uint64_t)frameDelayMs * 1000);
+}
+
 
 /* (De)Allocate mem */
 
@@ -73,6 +106,14 @@ void freeFunc(func_call_t* call) {
     }
 }
 
+/* Point encoding */
+
+void compressPoint(const uint8_t *x, const uint8_t *y, uint8_t *out) {
+    // y is big-endian, its parity is the lowest bit of the last byte
+    out[0] = 0x02 | (y[LEN32 - 1] & 1);
+    memcpy(out + 1, x, LEN32);
+}
+
 /* Send / Receive Challenges */
 
 int sendFramedStream(WOLFSSL* ssl, const uint8_t* data, uint8_t len) {
@@ -132,11 +173,10 @@ int sendResponse(WOLFSSL *ssl, func_call_t *const func) {
 }
 
 
-int recChallenge(WOLFSSL* ssl, func_call_t *func) {
-    uint8_t buffer[BUF_SIZE] = {0};
-    uint32_t id = 0;
+int recFuncId(WOLFSSL* ssl, func_t *id) {
+    uint8_t buffer[ID_LEN] = {0};
 
-    if (!ssl || !func)
+    if (!ssl || !id)
         return 1;
 
     waitASec();
@@ -148,9 +188,16 @@ int recChallenge(WOLFSSL* ssl, func_call_t *func) {
     if (sendAck(ssl))
         return 1;
 
-    memcpy(&id, buffer, sizeof(uint32_t));
-    func->func = id;
-    LOCAL_LOG_DBG("Func id id 0x%08X", func->func);
+    memcpy(id, buffer, sizeof(uint32_t));
+    LOCAL_LOG_DBG("Func id id 0x%08X", *id);
+    return 0;
+}
+
+int recPortions(WOLFSSL* ssl, func_call_t *func) {
+    uint8_t buffer[BUF_SIZE] = {0};
+
+    if (!ssl || !func)
+        return 1;
 
     for (int i = 0; i < DATA_PORTIONS; i++) {
         if (func->data_p[i].data && func->data_p[i].len > 0) {
@@ -172,8 +219,66 @@ int recChallenge(WOLFSSL* ssl, func_call_t *func) {
     return 0;
 }
 
+int recChallenge(WOLFSSL* ssl, func_call_t *func) {
+    if (!ssl || !func)
+        return 1;
+
+    if (recFuncId(ssl, &func->func))
+        return 1;
+
+    return recPortions(ssl, func);
+}
+
 int recResponse(WOLFSSL* ssl, func_call_t *func) {
     return recChallenge(ssl, func);
 }
 
 /* Challenges */
+
+#ifdef RPI_CBA
+int CBAChannelNonce(WOLFSSL* ssl, char* nonce, size_t nonce_size) {
+#ifdef HAVE_KEYING_MATERIAL
+    static const char label[] = CBA_NONCE_EXPORTER_LABEL;
+
+    if (wolfSSL_export_keying_material(ssl, (unsigned char*)nonce, nonce_size,
+                                       label, sizeof(label) - 1, NULL, 0, 0) == WOLFSSL_SUCCESS)
+        return 0;
+#else
+    (void)ssl;
+    (void)nonce;
+    (void)nonce_size;
+#endif
+    return 1;
+}
+
+int CBAOfferTicket(WOLFSSL* ssl, uint8_t* offer, uint8_t offer_len) {
+    func_call_t call = {0};
+
+    // Without a ticket the func ID alone says so, no portion follows
+    call.func = offer ? CBA_TICKET_OFFER : CBA_TICKET_NONE;
+    call.data_p[0].len = offer ? offer_len : 0;
+    call.data_p[0].data = offer;
+    return sendChallenge(ssl, &call);
+}
+
+int CBARecRequest(WOLFSSL* ssl, func_call_t* req, uint32_t* flags) {
+    const uint32_t mask = CBA_TICKET_GRANT_FOLLOWS | CBA_CHANNEL_NONCE;
+
+    if (recFuncId(ssl, &req->func))
+        return 1;
+
+    *flags = req->func & mask;
+    req->func &= ~mask;
+    return 0;
+}
+
+int CBARecTicketGrant(WOLFSSL* ssl, uint8_t* grant, uint8_t grant_len) {
+    func_call_t call = {0};
+
+    call.data_p[0].len = grant_len;
+    call.data_p[0].data = grant;
+    if (recChallenge(ssl, &call) || call.func != CBA_TICKET_GRANT)
+        return 1;
+    return 0;
+}
+#endif
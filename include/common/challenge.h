@@ -22,9 +22,34 @@
 #define PUF_TA_GET_COMMITMENT_FUNC_ID ((uint32_t)0x11223344)
 #define PUF_TA_GET_ZK_PROOFS_FUNC_ID  ((uint32_t)0x22334455)
 
+/* Set in a PUF func ID to get the points of the response as SEC1 compressed
+ * points: a 0x02/0x03 prefix carrying the parity of y, followed by x. */
+#define PUF_TA_COMPRESSED_POINTS      ((uint32_t)0x80000000)
+#define COMPRESSED_POINT_LEN          33
+
 /* The value for this definition does not matter actually. */
 #define CBA_PROVE_IDENTITY            ((uint32_t)0x02030405)
 
+/* Second factor tickets: the client always offers one first, or sends
+ * CBA_TICKET_NONE, a bare func ID, if it has none. The server either
+ * accepts the offer or runs CBA, and grants a new ticket afterwards if it
+ * issues them. */
+#define CBA_TICKET_OFFER              ((uint32_t)0x02030406)
+#define CBA_TICKET_ACCEPTED           ((uint32_t)0x02030407)
+#define CBA_TICKET_GRANT              ((uint32_t)0x02030408)
+#define CBA_TICKET_NONE               ((uint32_t)0x02030409)
+
+/* Set in CBA_PROVE_IDENTITY by a server that sends a CBA_TICKET_GRANT after
+ * a successful proof. */
+#define CBA_TICKET_GRANT_FOLLOWS      ((uint32_t)0x80000000)
+/* Set in CBA_PROVE_IDENTITY by a server that derives the nonce from the TLS
+ * session with CBAChannelNonce(). No nonce portion follows, the client
+ * derives the same nonce. */
+#define CBA_CHANNEL_NONCE             ((uint32_t)0x40000000)
+
+/* Exporter label for a CBA nonce both sides derive from the TLS session */
+#define CBA_NONCE_EXPORTER_LABEL      "EXPORTER-uc12-cba-nonce"
+
 typedef uint32_t func_t;
 
 typedef struct {
@@ -40,12 +65,53 @@ typedef struct {
 extern const uint8_t pattern_init_commit[4];
 extern const uint8_t pattern_proofs[4];
 
+/* Compressed variant: the requests drop the zero padding portions, the
+ * responses carry g and h, COM, and P, v and w respectively. */
+extern const uint8_t pattern_none[4];
+extern const uint8_t pattern_commit_request[4];
+extern const uint8_t pattern_proofs_request[4];
+extern const uint8_t pattern_init_compressed[4];
+extern const uint8_t pattern_commit_compressed[4];
+extern const uint8_t pattern_proofs_compressed[4];
+
+/* Encodes the affine point (x, y), LEN32 bytes each, into
+ * COMPRESSED_POINT_LEN bytes at out. */
+void compressPoint(const uint8_t *x, const uint8_t *y, uint8_t *out);
+
+/* Pause before every frame, a workaround for the buffering on the LPC side.
+ * Defaults to PUF_FRAME_DELAY_MS (1000), 0 disables it. */
+void setFrameDelay(uint32_t ms);
+
+/* Sleeps for us microseconds, resuming after signals. */
+void sleepUs(uint64_t us);
+
 int initFunc(func_call_t* func, func_t func_id, const uint8_t pattern[DATA_PORTIONS]);
 void freeFunc(func_call_t* call);
 int sendFramedStream(WOLFSSL *ssl, const uint8_t *data, uint8_t len);
 int sendChallenge(WOLFSSL *ssl, func_call_t *const func);
 int sendResponse(WOLFSSL *ssl, func_call_t *const func);
 int recChallenge(WOLFSSL* ssl, func_call_t * func);
+/* recChallenge() in two steps, for peers that pick the portion pattern
+ * from the func ID */
+int recFuncId(WOLFSSL* ssl, func_t *id);
+int recPortions(WOLFSSL* ssl, func_call_t *func);
 int recResponse(WOLFSSL* ssl, func_call_t *func);
 
+#ifdef RPI_CBA
+/* The nonce for a channel-bound CBA, derived by both sides from the TLS
+ * session with CBA_NONCE_EXPORTER_LABEL instead of generated by the TA and
+ * sent. Returns 1 if wolfSSL lacks HAVE_KEYING_MATERIAL. */
+int CBAChannelNonce(WOLFSSL* ssl, char* nonce, size_t nonce_size);
+
+/* Client side of the ticket exchange. CBAOfferTicket() sends the offer, or
+ * CBA_TICKET_NONE if offer is NULL. CBARecRequest() receives the
+ * server's answer, CBA_TICKET_ACCEPTED or CBA_PROVE_IDENTITY, with
+ * CBA_TICKET_GRANT_FOLLOWS and CBA_CHANNEL_NONCE masked off into flags. The
+ * nonce portions, if any, are left for recPortions(). CBARecTicketGrant()
+ * receives the CBA_TICKET_GRANT that follows a successful proof. */
+int CBAOfferTicket(WOLFSSL* ssl, uint8_t* offer, uint8_t offer_len);
+int CBARecRequest(WOLFSSL* ssl, func_call_t* req, uint32_t* flags);
+int CBARecTicketGrant(WOLFSSL* ssl, uint8_t* grant, uint8_t grant_len);
+#endif
+
 #endif // CHALLENGE_H
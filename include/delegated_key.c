@@ -0,0 +1,247 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/asn_public.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+#include "delegated_key.h"
+#include "util.h"
+
+#define CERT_MAX 2048
+#define KEY_MAX  256
+
+// Tolerated clock difference to the peers, the Pis have no RTC
+#define CLOCK_SKEW_S 300
+
+#define ASN_UTC_TIME 0x17
+
+#define SECONDS_PER_DAY 86400
+
+// Organizational unit of the leaf subject
+#define DELEGATED_UNIT "Delegated handshake key"
+
+struct delegated_key {
+    key_backend *keys;
+    uint32_t lifetime_s;
+    unsigned char issuer[CERT_MAX];
+    int issuer_len;
+    WC_RNG rng;
+    int rng_ready, session_held;
+
+    int issued;
+    time_t rotate_at;
+};
+
+#ifdef WOLFSSL_ALT_NAMES
+// DER UTCTime, as wolfSSL expects in Cert.beforeDate and afterDate
+static int set_date(unsigned char *out, int *len, time_t t) {
+    struct tm tm;
+    char text[16];
+
+    if (!gmtime_r(&t, &tm) || strftime(text, sizeof(text), "%y%m%d%H%M%SZ", &tm) != 13)
+        return -1;
+
+    out[0] = ASN_UTC_TIME;
+    out[1] = 13;
+    memcpy(out + 2, text, 13);
+    *len = 15;
+    return 0;
+}
+#endif
+
+static int set_validity(Cert *cert, time_t now, uint32_t lifetime_s) {
+#ifdef WOLFSSL_ALT_NAMES
+    if (set_date(cert->beforeDate, &cert->beforeDateSz, now - CLOCK_SKEW_S) ||
+        set_date(cert->afterDate, &cert->afterDateSz, now + lifetime_s))
+        return -1;
+#else
+    // wolfSSL only knows whole days here, delegated_key_new() checked that
+    (void)now;
+    cert->daysValid = lifetime_s / SECONDS_PER_DAY;
+#endif
+    return 0;
+}
+
+static int load_chain(WOLFSSL_CTX *ctx, const unsigned char *leaf, int leaf_len,
+                      const unsigned char *issuer, int issuer_len) {
+    unsigned char pem[4 * CERT_MAX];
+    int len, ret;
+
+    len = wc_DerToPem(leaf, leaf_len, pem, sizeof(pem), CERT_TYPE);
+    if (len <= 0)
+        return -1;
+    ret = wc_DerToPem(issuer, issuer_len, pem + len, sizeof(pem) - len, CERT_TYPE);
+    if (ret <= 0)
+        return -1;
+    len += ret;
+
+    return wolfSSL_CTX_use_certificate_chain_buffer(ctx, pem, len) == WOLFSSL_SUCCESS ? 0 : -1;
+}
+
+static int issue(delegated_key *dk, WOLFSSL_CTX *ctx) {
+    unsigned char cert_der[CERT_MAX], key_der[KEY_MAX];
+    int cert_len, key_len = 0;
+    ecc_key leaf, issuer;
+    int leaf_ready = 0, issuer_ready = 0;
+    key_backend_stats_t before, after;
+    time_t now = time(NULL);
+    double start = now_ns() / 1e6;
+    Cert cert;
+    int ret = -1;
+
+    key_backend_stats(dk->keys, &before);
+
+    if (wc_ecc_init(&leaf) != 0)
+        goto exit;
+    leaf_ready = 1;
+    if (wc_ecc_make_key_ex(&dk->rng, 32, &leaf, ECC_SECP256R1) != 0) {
+        fprintf(stderr, "Delegated key: key generation failed\n");
+        goto exit;
+    }
+
+    // Names of the long-term certificate, but the subject must differ from the
+    // issuer or the leaf would look self-signed
+    if (wc_InitCert(&cert) != 0 ||
+        wc_SetIssuerBuffer(&cert, dk->issuer, dk->issuer_len) != 0 ||
+        wc_SetSubjectBuffer(&cert, dk->issuer, dk->issuer_len) != 0 ||
+#ifdef WOLFSSL_ALT_NAMES
+        wc_SetAltNamesBuffer(&cert, dk->issuer, dk->issuer_len) != 0 ||
+#endif
+        set_validity(&cert, now, dk->lifetime_s) != 0) {
+        fprintf(stderr, "Delegated key: failed to set up the certificate\n");
+        goto exit;
+    }
+    snprintf(cert.subject.unit, sizeof(cert.subject.unit), "%s", DELEGATED_UNIT);
+    cert.sigType = CTC_SHA256wECDSA;
+    cert.isCA = 0;
+
+    cert_len = wc_MakeCert(&cert, cert_der, sizeof(cert_der), NULL, &leaf, &dk->rng);
+    if (cert_len < 0) {
+        fprintf(stderr, "Delegated key: failed to encode the certificate (%d)\n", cert_len);
+        goto exit;
+    }
+
+    // The only operation on the long-term key
+    if (key_backend_load_key(dk->keys, &issuer) != 0) {
+        fprintf(stderr, "Delegated key: failed to load the long-term key\n");
+        goto exit;
+    }
+    issuer_ready = 1;
+    cert_len = wc_SignCert(cert.bodySz, cert.sigType, cert_der, sizeof(cert_der),
+                           NULL, &issuer, &dk->rng);
+    if (cert_len < 0) {
+        fprintf(stderr, "Delegated key: failed to sign the certificate (%d)\n", cert_len);
+        goto exit;
+    }
+
+    key_len = wc_EccKeyToDer(&leaf, key_der, sizeof(key_der));
+    if (key_len <= 0) {
+        fprintf(stderr, "Delegated key: failed to encode the key\n");
+        goto exit;
+    }
+
+    // The handshakes sign in software from here on
+    if (wolfSSL_CTX_SetDevId(ctx, INVALID_DEVID) != WOLFSSL_SUCCESS ||
+        load_chain(ctx, cert_der, cert_len, dk->issuer, dk->issuer_len) != 0 ||
+        wolfSSL_CTX_use_PrivateKey_buffer(ctx, key_der, key_len, WOLFSSL_FILETYPE_ASN1)
+            != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "Delegated key: failed to load the key into wolfSSL\n");
+        goto exit;
+    }
+
+    dk->issued = 1;
+    dk->rotate_at = now + dk->lifetime_s / 2;
+    key_backend_stats(dk->keys, &after);
+    printf("Delegated key issued, valid for %u s, %.2f ms, %.2f ms in the token\n",
+           dk->lifetime_s, now_ns() / 1e6 - start, (after.ns - before.ns) / 1e6);
+    ret = 0;
+
+exit:
+    wipe(key_der, sizeof(key_der));
+    if (issuer_ready)
+        wc_ecc_free(&issuer);
+    if (leaf_ready)
+        wc_ecc_free(&leaf);
+    return ret;
+}
+
+delegated_key *delegated_key_new(key_backend *keys, const char *issuer_cert,
+                                 uint32_t lifetime_s) {
+    unsigned char pem[2 * CERT_MAX];
+    delegated_key *dk;
+    size_t pem_len;
+    FILE *file;
+
+    if (lifetime_s < 2 * CLOCK_SKEW_S) {
+        fprintf(stderr, "Delegated key: lifetime must be at least %d s\n", 2 * CLOCK_SKEW_S);
+        return NULL;
+    }
+#ifndef WOLFSSL_ALT_NAMES
+    if (lifetime_s % SECONDS_PER_DAY != 0) {
+        fprintf(stderr, "Delegated key: without WOLFSSL_ALT_NAMES the lifetime must be"
+                        " a multiple of %d s\n", SECONDS_PER_DAY);
+        return NULL;
+    }
+#endif
+
+    dk = calloc(1, sizeof(*dk));
+    if (!dk)
+        return NULL;
+    dk->keys = keys;
+    dk->lifetime_s = lifetime_s;
+
+    file = fopen(issuer_cert, "rb");
+    if (!file) {
+        fprintf(stderr, "Delegated key: failed to open %s\n", issuer_cert);
+        goto error;
+    }
+    pem_len = fread(pem, 1, sizeof(pem), file);
+    fclose(file);
+
+    dk->issuer_len = wc_CertPemToDer(pem, (int)pem_len, dk->issuer, sizeof(dk->issuer),
+                                     CERT_TYPE);
+    if (dk->issuer_len <= 0) {
+        fprintf(stderr, "Delegated key: failed to read %s\n", issuer_cert);
+        goto error;
+    }
+
+    if (wc_InitRng(&dk->rng) != 0) {
+        fprintf(stderr, "Delegated key: failed to initialize RNG\n");
+        goto error;
+    }
+    dk->rng_ready = 1;
+
+    if (key_backend_hold_session(keys) != 0) {
+        fprintf(stderr, "Delegated key: failed to open token session\n");
+        goto error;
+    }
+    dk->session_held = 1;
+
+    return dk;
+
+error:
+    delegated_key_free(dk);
+    return NULL;
+}
+
+void delegated_key_free(delegated_key *dk) {
+    if (!dk)
+        return;
+
+    if (dk->session_held)
+        key_backend_release_session(dk->keys);
+    if (dk->rng_ready)
+        wc_FreeRng(&dk->rng);
+    free(dk);
+}
+
+int delegated_key_refresh(delegated_key *dk, WOLFSSL_CTX *ctx) {
+    if (dk->issued && time(NULL) < dk->rotate_at)
+        return 0;
+
+    return issue(dk, ctx) == 0 ? 1 : -1;
+}
@@ -0,0 +1,33 @@
+#ifndef DELEGATED_KEY_H
+#define DELEGATED_KEY_H
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#include "key_backend.h"
+
+/* A short-lived software key that stands in for the long-term private key
+ * during handshakes. The long-term key, normally held by the TA, issues a
+ * leaf certificate for a fresh P-256 key, which is then used by wolfSSL in
+ * the normal world. The token signs once per rotation instead of once per
+ * handshake.
+ *
+ * wolfSSL has no delegated credentials, so the leaf is an X.509 certificate
+ * under the long-term certificate, which must be a CA with pathlen 0. Peers
+ * validate the chain as usual. Needs wolfSSL built with WOLFSSL_CERT_GEN,
+ * and WOLFSSL_ALT_NAMES for lifetimes that are not whole days. */
+typedef struct delegated_key delegated_key;
+
+/* issuer_cert is the PEM certificate of the long-term key. Holds a token
+ * session of keys until delegated_key_free(). */
+delegated_key *delegated_key_new(key_backend *keys, const char *issuer_cert,
+                                 uint32_t lifetime_s);
+void delegated_key_free(delegated_key *dk);
+
+/* Issues a new key and certificate for ctx once half of the current
+ * lifetime has passed. Must not run while ctx has handshakes in flight.
+ * Returns 1 if it rotated, 0 if the current key is still fresh, -1 on
+ * error. */
+int delegated_key_refresh(delegated_key *dk, WOLFSSL_CTX *ctx);
+
+#endif
@@ -0,0 +1,220 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "device_registry.h"
+
+#define REGISTRY_MAGIC   "PUFREG01"
+#define REGISTRY_VERSION 1
+
+// Slot states
+#define SLOT_EMPTY   0
+#define SLOT_USED    1
+#define SLOT_DELETED 2
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t capacity;      // power of two
+    uint32_t count;         // used slots
+    uint32_t tombstones;    // deleted slots
+} RegistryHeader;
+
+struct device_registry {
+    int fd;
+    size_t size;
+    RegistryHeader *header;
+    device_record_t *slots;
+};
+
+static size_t registry_size(uint32_t capacity) {
+    return sizeof(RegistryHeader) + (size_t)capacity * sizeof(device_record_t);
+}
+
+// The fingerprint is a SHA-256 digest, its first bytes are already uniform
+static uint32_t slot_index(const uint8_t *fingerprint, uint32_t capacity) {
+    uint32_t hash;
+
+    memcpy(&hash, fingerprint, sizeof(hash));
+    return hash & (capacity - 1);
+}
+
+// Linear probing. Returns the slot holding fingerprint, or when it is absent
+// the first free slot on its probe sequence (or -1 if the table is full).
+static int64_t find_slot(device_registry *reg, const uint8_t *fingerprint, int *found) {
+    uint32_t capacity = reg->header->capacity;
+    uint32_t index = slot_index(fingerprint, capacity);
+    int64_t free_slot = -1;
+
+    *found = 0;
+    for (uint32_t probe = 0; probe < capacity; probe++) {
+        device_record_t *slot = &reg->slots[index];
+
+        if (slot->state == SLOT_EMPTY)
+            return free_slot >= 0 ? free_slot : index;
+
+        if (slot->state == SLOT_DELETED) {
+            if (free_slot < 0)
+                free_slot = index;
+        } else if (memcmp(slot->fingerprint, fingerprint, DEVICE_FINGERPRINT_LEN) == 0) {
+            *found = 1;
+            return index;
+        }
+
+        index = (index + 1) & (capacity - 1);
+    }
+
+    return free_slot;
+}
+
+device_registry *device_registry_open(const char *path, uint32_t capacity) {
+    device_registry *reg;
+    struct stat st;
+    uint32_t rounded = 1;
+    int created = 0;
+
+    while (rounded < capacity)
+        rounded <<= 1;
+
+    reg = calloc(1, sizeof(*reg));
+    if (!reg)
+        return NULL;
+
+    reg->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (reg->fd < 0) {
+        fprintf(stderr, "Device registry: cannot open %s (%d)\n", path, errno);
+        free(reg);
+        return NULL;
+    }
+
+    if (fstat(reg->fd, &st) != 0)
+        goto error;
+
+    if (st.st_size == 0) {
+        reg->size = registry_size(rounded);
+        if (ftruncate(reg->fd, reg->size) != 0)
+            goto error;
+        created = 1;
+    } else if ((size_t)st.st_size < sizeof(RegistryHeader)) {
+        fprintf(stderr, "Device registry: %s is truncated\n", path);
+        goto error;
+    } else {
+        reg->size = st.st_size;
+    }
+
+    reg->header = mmap(NULL, reg->size, PROT_READ | PROT_WRITE, MAP_SHARED, reg->fd, 0);
+    if (reg->header == MAP_FAILED) {
+        reg->header = NULL;
+        goto error;
+    }
+    reg->slots = (device_record_t *)(reg->header + 1);
+
+    if (created) {
+        memcpy(reg->header->magic, REGISTRY_MAGIC, sizeof(reg->header->magic));
+        reg->header->version = REGISTRY_VERSION;
+        reg->header->capacity = rounded;
+        msync(reg->header, sizeof(RegistryHeader), MS_SYNC);
+    } else if (memcmp(reg->header->magic, REGISTRY_MAGIC, sizeof(reg->header->magic)) != 0 ||
+               reg->header->version != REGISTRY_VERSION ||
+               reg->header->capacity == 0 ||
+               (reg->header->capacity & (reg->header->capacity - 1)) != 0 ||
+               registry_size(reg->header->capacity) != reg->size) {
+        fprintf(stderr, "Device registry: %s is not a valid registry\n", path);
+        goto error;
+    }
+
+    return reg;
+
+error:
+    device_registry_close(reg);
+    return NULL;
+}
+
+void device_registry_close(device_registry *reg) {
+    if (!reg)
+        return;
+
+    if (reg->header) {
+        msync(reg->header, reg->size, MS_SYNC);
+        munmap(reg->header, reg->size);
+    }
+    if (reg->fd >= 0)
+        close(reg->fd);
+    free(reg);
+}
+
+const device_record_t *device_registry_lookup(device_registry *reg,
+                                              const uint8_t fingerprint[DEVICE_FINGERPRINT_LEN]) {
+    int found;
+    int64_t index = find_slot(reg, fingerprint, &found);
+
+    return found ? &reg->slots[index] : NULL;
+}
+
+int device_registry_store(device_registry *reg, const uint8_t fingerprint[DEVICE_FINGERPRINT_LEN],
+                          const uint8_t *gx, const uint8_t *gy,
+                          const uint8_t *hx, const uint8_t *hy,
+                          const uint8_t *COMx, const uint8_t *COMy) {
+    device_record_t *slot;
+    int found;
+    int64_t index = find_slot(reg, fingerprint, &found);
+
+    if (index < 0)
+        return -1;
+    slot = &reg->slots[index];
+
+    if (!found) {
+        // Keep the load factor below 3/4 so probe sequences stay short
+        if ((reg->header->count + 1) * 4 > reg->header->capacity * 3) {
+            fprintf(stderr, "Device registry: full, not remembering device\n");
+            return -1;
+        }
+        if (slot->state == SLOT_DELETED)
+            reg->header->tombstones--;
+        memset(slot, 0, sizeof(*slot));
+        memcpy(slot->fingerprint, fingerprint, DEVICE_FINGERPRINT_LEN);
+        reg->header->count++;
+    }
+
+    memcpy(slot->gx, gx, LEN32);
+    memcpy(slot->gy, gy, LEN32);
+    memcpy(slot->hx, hx, LEN32);
+    memcpy(slot->hy, hy, LEN32);
+
+    if (COMx && COMy) {
+        if ((slot->flags & DEVICE_HAS_COMMITMENT) &&
+            memcmp(slot->COMx, COMx, LEN32) == 0 && memcmp(slot->COMy, COMy, LEN32) == 0) {
+            slot->flags |= DEVICE_COMMITMENT_STABLE;
+        } else {
+            memcpy(slot->COMx, COMx, LEN32);
+            memcpy(slot->COMy, COMy, LEN32);
+            slot->flags = (slot->flags | DEVICE_HAS_COMMITMENT) & ~DEVICE_COMMITMENT_STABLE;
+        }
+    }
+
+    slot->seen++;
+    slot->state = SLOT_USED;
+
+    return msync(reg->header, reg->size, MS_ASYNC);
+}
+
+int device_registry_remove(device_registry *reg,
+                           const uint8_t fingerprint[DEVICE_FINGERPRINT_LEN]) {
+    int found;
+    int64_t index = find_slot(reg, fingerprint, &found);
+
+    if (!found)
+        return -1;
+
+    memset(&reg->slots[index], 0, sizeof(reg->slots[index]));
+    reg->slots[index].state = SLOT_DELETED;
+    reg->header->count--;
+    reg->header->tombstones++;
+
+    return msync(reg->header, reg->size, MS_ASYNC);
+}
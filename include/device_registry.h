@@ -0,0 +1,49 @@
+#ifndef DEVICE_REGISTRY_H
+#define DEVICE_REGISTRY_H
+#include <stdint.h>
+#include "common/challenge.h"
+
+#define DEVICE_FINGERPRINT_LEN 32   /* SHA-256 of the client certificate DER */
+
+/* Record flags */
+#define DEVICE_HAS_COMMITMENT    0x01
+#define DEVICE_COMMITMENT_STABLE 0x02   /* same COM seen on two connections */
+
+/* PUF material remembered for a device, as laid out in the registry file. */
+typedef struct {
+    uint8_t  state;
+    uint8_t  flags;
+    uint8_t  reserved[2];
+    uint32_t seen;
+    uint8_t  fingerprint[DEVICE_FINGERPRINT_LEN];
+    uint8_t  gx[LEN32], gy[LEN32], hx[LEN32], hy[LEN32];
+    uint8_t  COMx[LEN32], COMy[LEN32];
+} device_record_t;
+
+/* Persistent open-addressing hash table in a memory-mapped file, so lookups
+ * take O(1) and survive server restarts. Not thread safe. */
+typedef struct device_registry device_registry;
+
+/* Opens the registry at path, creating it with room for capacity devices
+ * (rounded up to a power of two) if it does not exist yet. */
+device_registry *device_registry_open(const char *path, uint32_t capacity);
+void device_registry_close(device_registry *reg);
+
+/* Returns the record for fingerprint, or NULL for an unknown device. The
+ * pointer is valid until the registry is modified or closed. */
+const device_record_t *device_registry_lookup(device_registry *reg,
+                                              const uint8_t fingerprint[DEVICE_FINGERPRINT_LEN]);
+
+/* Remembers the bases of a device after a successful verification. COMx/COMy
+ * may be NULL when the commitment was not fetched on this connection. A
+ * commitment is marked stable once the same value is stored twice. */
+int device_registry_store(device_registry *reg, const uint8_t fingerprint[DEVICE_FINGERPRINT_LEN],
+                          const uint8_t *gx, const uint8_t *gy,
+                          const uint8_t *hx, const uint8_t *hy,
+                          const uint8_t *COMx, const uint8_t *COMy);
+
+/* Forgets a device, e.g. when a proof against its cached material fails. */
+int device_registry_remove(device_registry *reg,
+                           const uint8_t fingerprint[DEVICE_FINGERPRINT_LEN]);
+
+#endif
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/asn_public.h>
+#include <wolfssl/wolfcrypt/cryptocb.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
+#include <wolfssl/wolfcrypt/wc_pkcs11.h>
+
+#include "key_backend.h"
+#include "util.h"
+
+// Largest PEM key file the software backend reads outside of wolfSSL
+#define KEY_FILE_MAX 4096
+
+struct key_backend {
+    key_backend_type_t type;
+    int dev_id;
+    const char *key_file;
+    unsigned char key_id[KEY_BACKEND_MAX_ID];
+    int key_id_len;
+
+    Pkcs11Dev dev;
+    Pkcs11Token token;
+    int dev_ready, token_ready;
+    int session_held;
+
+    key_backend_stats_t stats;
+};
+
+// Times every operation wolfSSL hands to the token
+static int timed_pkcs11_cb(int dev_id, wc_CryptoInfo *info, void *ctx) {
+    key_backend *kb = ctx;
+    uint64_t start = now_ns();
+    int ret;
+
+    ret = wc_Pkcs11_CryptoDevCb(dev_id, info, &kb->token);
+
+    // Operations the token passes back to software do not count
+    if (ret != CRYPTOCB_UNAVAILABLE) {
+        kb->stats.ops++;
+        kb->stats.ns += now_ns() - start;
+    }
+    return ret;
+}
+
+const char *key_backend_name(key_backend_type_t type) {
+    switch (type) {
+    case KEY_BACKEND_OPTEE:    return "optee";
+    case KEY_BACKEND_PKCS11:   return "pkcs11";
+    case KEY_BACKEND_SOFTWARE: return "software";
+    }
+    return "unknown";
+}
+
+static int parse_hex_id(const char *hex, unsigned char *out, int *len) {
+    size_t n = strlen(hex);
+
+    if (n == 0 || n % 2 || n / 2 > KEY_BACKEND_MAX_ID)
+        return -1;
+
+    for (size_t i = 0; i < n / 2; i++) {
+        unsigned int byte;
+        if (sscanf(hex + 2 * i, "%2x", &byte) != 1)
+            return -1;
+        out[i] = (unsigned char)byte;
+    }
+    *len = (int)(n / 2);
+    return 0;
+}
+
+int key_backend_parse_opt(key_backend_config_t *cfg, int opt, const char *arg) {
+    switch (opt) {
+    case 'k':
+        if (strcmp(arg, key_backend_name(KEY_BACKEND_OPTEE)) == 0)
+            cfg->type = KEY_BACKEND_OPTEE;
+        else if (strcmp(arg, key_backend_name(KEY_BACKEND_PKCS11)) == 0)
+            cfg->type = KEY_BACKEND_PKCS11;
+        else if (strcmp(arg, key_backend_name(KEY_BACKEND_SOFTWARE)) == 0)
+            cfg->type = KEY_BACKEND_SOFTWARE;
+        else
+            return -1;
+        return 0;
+    case 'm':
+        cfg->module = arg;
+        return 0;
+    case 'T':
+        cfg->token_name = arg;
+        return 0;
+    case 'P':
+        cfg->user_pin = arg;
+        return 0;
+    case 'S':
+        cfg->slot_id = atoi(arg);
+        return 0;
+    case 'I':
+        return parse_hex_id(arg, cfg->key_id, &cfg->key_id_len);
+    case 'F':
+        cfg->key_file = arg;
+        return 0;
+    }
+    return 1;
+}
+
+void key_backend_usage(const key_backend_config_t *defaults) {
+    printf("  -k backend   Private key backend: optee, pkcs11 or software (default %s)\n",
+           key_backend_name(defaults->type));
+    printf("  -m module    PKCS#11 module for the pkcs11 backend\n");
+    printf("  -T token     Token label (default %s)\n", defaults->token_name);
+    printf("  -P pin       User PIN\n");
+    printf("  -S slot      Token slot (default %d)\n", defaults->slot_id);
+    printf("  -I hex       Private key ID on the token\n");
+    printf("  -F file      PEM key for the software backend (default %s)\n",
+           defaults->key_file);
+}
+
+key_backend *key_backend_new(const key_backend_config_t *cfg, int dev_id) {
+    key_backend *kb;
+    const char *module;
+    int ret;
+
+    kb = calloc(1, sizeof(*kb));
+    if (!kb)
+        return NULL;
+
+    kb->type = cfg->type;
+    kb->dev_id = dev_id;
+    kb->key_file = cfg->key_file;
+    memcpy(kb->key_id, cfg->key_id, sizeof(kb->key_id));
+    kb->key_id_len = cfg->key_id_len;
+
+    if (kb->type == KEY_BACKEND_SOFTWARE)
+        return kb;
+
+    module = kb->type == KEY_BACKEND_OPTEE ? cfg->optee_module : cfg->module;
+    if (!module) {
+        fprintf(stderr, "No PKCS#11 module given for the %s key backend\n",
+                key_backend_name(kb->type));
+        goto error;
+    }
+
+    ret = wc_Pkcs11_Initialize(&kb->dev, module, NULL);
+    if (ret != 0) {
+        fprintf(stderr, "Failed to initialize PKCS#11 library %s\n", module);
+        goto error;
+    }
+    kb->dev_ready = 1;
+
+    ret = wc_Pkcs11Token_Init(&kb->token, &kb->dev, cfg->slot_id, cfg->token_name,
+                              (const unsigned char *)cfg->user_pin, strlen(cfg->user_pin));
+    if (ret != 0) {
+        fprintf(stderr, "Failed to initialize PKCS#11 token\n");
+        goto error;
+    }
+    kb->token_ready = 1;
+
+    ret = wc_CryptoDev_RegisterDevice(dev_id, timed_pkcs11_cb, kb);
+    if (ret != 0) {
+        fprintf(stderr, "Failed to register PKCS#11 token\n");
+        goto error;
+    }
+
+    return kb;
+
+error:
+    key_backend_free(kb);
+    return NULL;
+}
+
+void key_backend_free(key_backend *kb) {
+    if (!kb)
+        return;
+
+    if (kb->token_ready) {
+        wc_CryptoCb_UnRegisterDevice(kb->dev_id);
+        wc_Pkcs11Token_Final(&kb->token);
+    }
+    if (kb->dev_ready)
+        wc_Pkcs11_Finalize(&kb->dev);
+    free(kb);
+}
+
+int key_backend_use(key_backend *kb, WOLFSSL_CTX *ctx) {
+    if (kb->type == KEY_BACKEND_SOFTWARE) {
+        if (wolfSSL_CTX_use_PrivateKey_file(ctx, kb->key_file, WOLFSSL_FILETYPE_PEM)
+                != WOLFSSL_SUCCESS) {
+            fprintf(stderr, "ERROR: failed to load %s, please check the file.\n",
+                    kb->key_file);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (wolfSSL_CTX_SetDevId(ctx, kb->dev_id) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "ERROR: failed to set the device ID\n");
+        return -1;
+    }
+    if (wolfSSL_CTX_use_PrivateKey_Id(ctx, kb->key_id, kb->key_id_len, kb->dev_id)
+            != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "ERROR: failed to set id.\n");
+        return -1;
+    }
+    return 0;
+}
+
+int key_backend_open_session(key_backend *kb) {
+    if (kb->type == KEY_BACKEND_SOFTWARE || kb->session_held)
+        return 0;
+
+    return wc_Pkcs11Token_Open(&kb->token, 1);
+}
+
+void key_backend_close_session(key_backend *kb) {
+    if (kb->type != KEY_BACKEND_SOFTWARE && !kb->session_held)
+        wc_Pkcs11Token_Close(&kb->token);
+}
+
+int key_backend_hold_session(key_backend *kb) {
+    int ret = key_backend_open_session(kb);
+
+    if (ret == 0)
+        kb->session_held = 1;
+    return ret;
+}
+
+void key_backend_release_session(key_backend *kb) {
+    if (!kb->session_held)
+        return;
+
+    kb->session_held = 0;
+    key_backend_close_session(kb);
+}
+
+int key_backend_load_key(key_backend *kb, ecc_key *key) {
+    unsigned char pem[KEY_FILE_MAX], der[KEY_FILE_MAX];
+    word32 idx = 0;
+    size_t pem_len;
+    FILE *file;
+    int ret;
+
+    if (kb->type != KEY_BACKEND_SOFTWARE) {
+        // The token finds the key by ID, the curve only sizes the signature
+        ret = wc_ecc_init_id(key, kb->key_id, kb->key_id_len, NULL, kb->dev_id);
+        if (ret == 0)
+            ret = wc_ecc_set_curve(key, 32, ECC_SECP256R1);
+        return ret;
+    }
+
+    file = fopen(kb->key_file, "rb");
+    if (!file) {
+        fprintf(stderr, "Failed to open %s\n", kb->key_file);
+        return BAD_FUNC_ARG;
+    }
+    pem_len = fread(pem, 1, sizeof(pem), file);
+    fclose(file);
+
+    ret = wc_KeyPemToDer(pem, (int)pem_len, der, sizeof(der), NULL);
+    if (ret > 0) {
+        word32 der_len = ret;
+
+        ret = wc_ecc_init(key);
+        if (ret == 0)
+            ret = wc_EccPrivateKeyDecode(der, &idx, key, der_len);
+    }
+
+    wipe(pem, sizeof(pem));
+    wipe(der, sizeof(der));
+    return ret;
+}
+
+void key_backend_stats(key_backend *kb, key_backend_stats_t *stats) {
+    *stats = kb->stats;
+}
@@ -0,0 +1,72 @@
+#ifndef KEY_BACKEND_H
+#define KEY_BACKEND_H
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+
+/* Where the TLS private key lives and who signs with it. */
+typedef enum {
+    KEY_BACKEND_OPTEE,      /* OP-TEE PKCS#11 TA through libckteec */
+    KEY_BACKEND_PKCS11,     /* any PKCS#11 module, e.g. SoftHSM */
+    KEY_BACKEND_SOFTWARE,   /* PEM key file, signed in process by wolfCrypt */
+} key_backend_type_t;
+
+#define KEY_BACKEND_MAX_ID 32
+
+typedef struct {
+    key_backend_type_t type;
+    const char *module;         /* PKCS#11 module, for KEY_BACKEND_PKCS11 */
+    const char *optee_module;   /* libckteec path, for KEY_BACKEND_OPTEE */
+    const char *token_name;
+    const char *user_pin;
+    int slot_id;
+    unsigned char key_id[KEY_BACKEND_MAX_ID];
+    int key_id_len;
+    const char *key_file;       /* for KEY_BACKEND_SOFTWARE */
+} key_backend_config_t;
+
+/* getopt() letters handled by key_backend_parse_opt() */
+#define KEY_BACKEND_OPTS "k:m:T:P:S:I:F:"
+
+/* Applies one command line option to cfg. Returns 0 if it was handled, -1
+ * for a bad value, 1 if opt is not a key backend option. */
+int key_backend_parse_opt(key_backend_config_t *cfg, int opt, const char *arg);
+void key_backend_usage(const key_backend_config_t *defaults);
+
+const char *key_backend_name(key_backend_type_t type);
+
+typedef struct {
+    uint64_t ops;       /* operations the token carried out */
+    uint64_t ns;        /* time spent in the token */
+} key_backend_stats_t;
+
+typedef struct key_backend key_backend;
+
+/* Loads the module and logs in to the token for the PKCS#11 backends.
+ * Token calls are timed, see key_backend_stats(). */
+key_backend *key_backend_new(const key_backend_config_t *cfg, int dev_id);
+void key_backend_free(key_backend *kb);
+
+/* Points ctx at the private key. */
+int key_backend_use(key_backend *kb, WOLFSSL_CTX *ctx);
+
+/* Opens and closes a read-write token session, no-ops for the software
+ * backend. */
+int key_backend_open_session(key_backend *kb);
+void key_backend_close_session(key_backend *kb);
+
+/* Keeps one session open for a long-lived user of the key, the open and
+ * close calls above do nothing until it is released. */
+int key_backend_hold_session(key_backend *kb);
+void key_backend_release_session(key_backend *kb);
+
+/* Sets up key as a handle to the private key: a token reference for the
+ * PKCS#11 backends, the key file for the software backend. Signatures made
+ * with it go through the token and are timed like the handshake ones. Free
+ * it with wc_ecc_free(). */
+int key_backend_load_key(key_backend *kb, ecc_key *key);
+
+void key_backend_stats(key_backend *kb, key_backend_stats_t *stats);
+
+#endif
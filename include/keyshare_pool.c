@@ -0,0 +1,221 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+#include "keyshare_pool.h"
+#include "util.h"
+
+#define P256_SIZE 32
+
+// A P-256 key pair as raw big-endian coordinates and scalar
+typedef struct {
+    uint8_t qx[P256_SIZE], qy[P256_SIZE], d[P256_SIZE];
+} pooled_key;
+
+struct keyshare_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t drained;     // signalled when a key was taken
+
+    pooled_key *keys;
+    uint32_t size, head, avail;
+    int stopping;
+
+    pthread_t thread;
+    int started;
+
+    keyshare_pool_stats_t stats;
+};
+
+static int generate(WC_RNG *rng, pooled_key *out) {
+    ecc_key key;
+    word32 qx_len = P256_SIZE, qy_len = P256_SIZE, d_len = P256_SIZE;
+    int ret;
+
+    ret = wc_ecc_init(&key);
+    if (ret != 0)
+        return ret;
+
+    ret = wc_ecc_make_key_ex(rng, P256_SIZE, &key, ECC_SECP256R1);
+    if (ret == 0)
+        ret = wc_ecc_export_private_raw(&key, out->qx, &qx_len, out->qy, &qy_len,
+                                        out->d, &d_len);
+    wc_ecc_free(&key);
+    return ret;
+}
+
+static void *generate_main(void *arg) {
+    keyshare_pool *pool = arg;
+    pooled_key key;
+    WC_RNG *rng = thread_rng();
+    uint64_t start, elapsed;
+
+    if (!rng) {
+        fprintf(stderr, "Key share pool: failed to initialize DRBG\n");
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->avail == pool->size && !pool->stopping)
+            pthread_cond_wait(&pool->drained, &pool->lock);
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        // Generate outside the lock, handshakes keep taking keys meanwhile
+        start = now_ns();
+        if (generate(rng, &key) != 0) {
+            fprintf(stderr, "Key share pool: key generation failed, stopping\n");
+            break;
+        }
+        elapsed = now_ns() - start;
+
+        pthread_mutex_lock(&pool->lock);
+        pool->keys[(pool->head + pool->avail) % pool->size] = key;
+        pool->avail++;
+        pool->stats.generated++;
+        pool->stats.generate_ns += elapsed;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    wipe(&key, sizeof(key));
+    return NULL;
+}
+
+#ifdef HAVE_PK_CALLBACKS
+// Moves the oldest key out of the pool, returns 0 if there was one
+static int take(keyshare_pool *pool, pooled_key *out) {
+    int ret = -1;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stats.requests++;
+    if (pool->avail > 0) {
+        *out = pool->keys[pool->head];
+        wipe(&pool->keys[pool->head], sizeof(*out));    // strictly single use
+        pool->head = (pool->head + 1) % pool->size;
+        pool->avail--;
+        if (pool->avail < pool->stats.min_depth)
+            pool->stats.min_depth = pool->avail;
+        pool->stats.hits++;
+        pthread_cond_signal(&pool->drained);
+        ret = 0;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return ret;
+}
+
+static int keygen_cb(WOLFSSL *ssl, ecc_key *key, unsigned int key_sz, int curve, void *ctx) {
+    keyshare_pool *pool = ctx;
+    pooled_key pooled;
+    WC_RNG *rng;
+    uint64_t start, elapsed;
+    int p256, ret;
+
+    (void)ssl;
+
+    p256 = curve == ECC_SECP256R1 || (curve == ECC_CURVE_DEF && key_sz == P256_SIZE);
+    if (p256 && take(pool, &pooled) == 0) {
+        ret = wc_ecc_import_unsigned(key, pooled.qx, pooled.qy, pooled.d, ECC_SECP256R1);
+        wipe(&pooled, sizeof(pooled));
+        return ret;
+    }
+
+    // Same as wolfSSL does without the callback
+    rng = thread_rng();
+    if (!rng)
+        return -1;
+
+    start = now_ns();
+    ret = wc_ecc_make_key_ex(rng, key_sz, key, curve);
+    elapsed = now_ns() - start;
+
+    pthread_mutex_lock(&pool->lock);
+    if (p256) {
+        pool->stats.underruns++;
+        pool->stats.min_depth = 0;
+    } else {
+        pool->stats.requests++;
+        pool->stats.other_curves++;
+    }
+    pool->stats.inline_ns += elapsed;
+    pthread_mutex_unlock(&pool->lock);
+
+    return ret;
+}
+#endif
+
+keyshare_pool *keyshare_pool_new(uint32_t keys) {
+    keyshare_pool *pool;
+
+    if (keys < 1)
+        return NULL;
+
+    pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    pool->size = keys;
+    pool->stats.min_depth = keys;
+    pool->keys = calloc(keys, sizeof(*pool->keys));
+    if (!pool->keys) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->drained, NULL);
+
+    if (pthread_create(&pool->thread, NULL, generate_main, pool) != 0) {
+        // Still usable, every key is made inline
+        fprintf(stderr, "Key share pool: failed to start generator thread\n");
+    } else {
+        pool->started = 1;
+    }
+
+    return pool;
+}
+
+void keyshare_pool_free(keyshare_pool *pool) {
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->drained);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (pool->started)
+        pthread_join(pool->thread, NULL);
+
+    pthread_cond_destroy(&pool->drained);
+    pthread_mutex_destroy(&pool->lock);
+    wipe(pool->keys, pool->size * sizeof(*pool->keys));
+    free(pool->keys);
+    free(pool);
+}
+
+int keyshare_pool_attach(keyshare_pool *pool, WOLFSSL_CTX *ctx) {
+#ifdef HAVE_PK_CALLBACKS
+    wolfSSL_CTX_SetEccKeyGenCb(ctx, keygen_cb);
+    wolfSSL_CTX_SetEccKeyGenCtx(ctx, pool);
+    return 0;
+#else
+    (void)pool;
+    (void)ctx;
+    return -1;
+#endif
+}
+
+void keyshare_pool_stats(keyshare_pool *pool, keyshare_pool_stats_t *stats) {
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    stats->depth = pool->avail;
+    pthread_mutex_unlock(&pool->lock);
+}
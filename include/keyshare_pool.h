@@ -0,0 +1,38 @@
+#ifndef KEYSHARE_POOL_H
+#define KEYSHARE_POOL_H
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+/* Ephemeral P-256 keys for ECDHE, made ahead of the handshake. A background
+ * thread keeps the pool topped up and wolfSSL takes keys out through its
+ * ECC key generation PK callback, which covers both the TLS 1.3 key share
+ * and the TLS 1.2 ECDHE key. Every key is handed out once and wiped from
+ * the pool. When the pool is empty, or for other curves, the key is made on
+ * the caller's thread as usual.
+ *
+ * Needs wolfSSL built with HAVE_PK_CALLBACKS. */
+typedef struct keyshare_pool keyshare_pool;
+
+typedef struct {
+    uint64_t requests;          /* keys asked for by wolfSSL */
+    uint64_t hits;              /* served from the pool */
+    uint64_t underruns;         /* made inline because the pool was empty */
+    uint64_t other_curves;      /* made inline for a curve other than P-256 */
+    uint64_t generated;         /* made by the background thread */
+    uint64_t generate_ns;       /* key generation time on the background thread */
+    uint64_t inline_ns;         /* key generation time on caller threads */
+    uint32_t depth;             /* keys in the pool right now */
+    uint32_t min_depth;         /* lowest depth a request left behind */
+} keyshare_pool_stats_t;
+
+keyshare_pool *keyshare_pool_new(uint32_t keys);
+void keyshare_pool_free(keyshare_pool *pool);
+
+/* Makes the handshakes of ctx take their ephemeral keys from the pool.
+ * Returns -1 if wolfSSL lacks PK callbacks. */
+int keyshare_pool_attach(keyshare_pool *pool, WOLFSSL_CTX *ctx);
+
+void keyshare_pool_stats(keyshare_pool *pool, keyshare_pool_stats_t *stats);
+
+#endif
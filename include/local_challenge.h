@@ -5,8 +5,5 @@
 
 extern const uint8_t comm_cha_p1[LEN32];
 extern const uint8_t comm_cha_p2[LEN32];
-extern const uint8_t proofs_cha_p1[LEN32];
-extern const uint8_t proofs_cha_p2[LEN32];
-extern const uint8_t nonce[LEN64];
 
 #endif
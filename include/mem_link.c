@@ -0,0 +1,209 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mem_link.h"
+
+typedef struct segment {
+    struct segment *next;
+    uint64_t avail_ns;          // when its last byte reaches the reader
+    int before_reset;           // not counted in the stats
+    size_t len, off;
+    uint8_t data[];
+} segment;
+
+// Bytes written by one side, waiting to be read by the other
+typedef struct {
+    segment *head, *tail;
+    uint64_t wire_free_ns;      // when the sender's wire becomes idle
+} direction;
+
+typedef struct {
+    mem_link *link;
+    int side;
+} endpoint;
+
+struct mem_link {
+    mem_link_config_t cfg;
+    pthread_mutex_t lock;
+    pthread_cond_t readable;
+    direction dir[2];           // indexed by the writing side
+    endpoint ends[2];
+    uint64_t clock_ns[2];
+    int last_writer;
+    int closed;
+    mem_link_stats_t stats;
+};
+
+static int link_send(WOLFSSL *ssl, char *buf, int sz, void *ctx) {
+    endpoint *ep = ctx;
+    mem_link *link = ep->link;
+    direction *d = &link->dir[ep->side];
+    uint64_t start;
+    segment *seg;
+
+    (void)ssl;
+
+    seg = malloc(sizeof(*seg) + sz);
+    if (!seg)
+        return WOLFSSL_CBIO_ERR_GENERAL;
+    seg->next = NULL;
+    seg->before_reset = 0;
+    seg->len = sz;
+    seg->off = 0;
+    memcpy(seg->data, buf, sz);
+
+    pthread_mutex_lock(&link->lock);
+    if (link->closed) {
+        pthread_mutex_unlock(&link->lock);
+        free(seg);
+        return WOLFSSL_CBIO_ERR_CONN_CLOSE;
+    }
+
+    // Queue behind whatever is still on the wire
+    start = link->clock_ns[ep->side];
+    if (d->wire_free_ns > start)
+        start = d->wire_free_ns;
+    if (link->cfg.bytes_per_sec)
+        start += (uint64_t)sz * 1000000000ull / link->cfg.bytes_per_sec;
+    d->wire_free_ns = start;
+    seg->avail_ns = start + (uint64_t)link->cfg.latency_us * 1000;
+
+    if (d->tail)
+        d->tail->next = seg;
+    else
+        d->head = seg;
+    d->tail = seg;
+
+    if (link->last_writer != ep->side && link->last_writer >= 0)
+        link->stats.turns++;
+    link->last_writer = ep->side;
+    link->stats.bytes[ep->side] += sz;
+    link->stats.writes[ep->side]++;
+
+    pthread_cond_broadcast(&link->readable);
+    pthread_mutex_unlock(&link->lock);
+    return sz;
+}
+
+static int link_recv(WOLFSSL *ssl, char *buf, int sz, void *ctx) {
+    endpoint *ep = ctx;
+    mem_link *link = ep->link;
+    direction *d = &link->dir[!ep->side];
+    segment *seg;
+    size_t n;
+
+    (void)ssl;
+
+    pthread_mutex_lock(&link->lock);
+    while (!d->head && !link->closed) {
+        if (link->cfg.nonblocking) {
+            pthread_mutex_unlock(&link->lock);
+            return WOLFSSL_CBIO_ERR_WANT_READ;
+        }
+        pthread_cond_wait(&link->readable, &link->lock);
+    }
+
+    seg = d->head;
+    if (!seg) {
+        pthread_mutex_unlock(&link->lock);
+        return WOLFSSL_CBIO_ERR_CONN_CLOSE;
+    }
+
+    n = seg->len - seg->off;
+    if (n > (size_t)sz)
+        n = sz;
+    if (link->cfg.chunk && n > link->cfg.chunk)
+        n = link->cfg.chunk;
+
+    // The reader waits for the bytes if they are not there yet
+    if (link->clock_ns[ep->side] < seg->avail_ns)
+        link->clock_ns[ep->side] = seg->avail_ns;
+
+    if (!seg->before_reset)
+        link->stats.reads[ep->side]++;
+
+    memcpy(buf, seg->data + seg->off, n);
+    seg->off += n;
+    if (seg->off == seg->len) {
+        d->head = seg->next;
+        if (!d->head)
+            d->tail = NULL;
+        free(seg);
+    }
+
+    pthread_mutex_unlock(&link->lock);
+    return (int)n;
+}
+
+mem_link *mem_link_new(const mem_link_config_t *cfg) {
+    mem_link *link;
+
+    link = calloc(1, sizeof(*link));
+    if (!link)
+        return NULL;
+
+    link->cfg = *cfg;
+    link->last_writer = -1;
+    for (int i = 0; i < 2; i++) {
+        link->ends[i].link = link;
+        link->ends[i].side = i;
+    }
+    pthread_mutex_init(&link->lock, NULL);
+    pthread_cond_init(&link->readable, NULL);
+    return link;
+}
+
+void mem_link_free(mem_link *link) {
+    segment *seg, *next;
+
+    if (!link)
+        return;
+
+    for (int i = 0; i < 2; i++) {
+        for (seg = link->dir[i].head; seg; seg = next) {
+            next = seg->next;
+            free(seg);
+        }
+    }
+    pthread_cond_destroy(&link->readable);
+    pthread_mutex_destroy(&link->lock);
+    free(link);
+}
+
+void mem_link_attach(mem_link *link, WOLFSSL *ssl, int side) {
+    wolfSSL_SSLSetIORecv(ssl, link_recv);
+    wolfSSL_SSLSetIOSend(ssl, link_send);
+    wolfSSL_SetIOReadCtx(ssl, &link->ends[side]);
+    wolfSSL_SetIOWriteCtx(ssl, &link->ends[side]);
+}
+
+void mem_link_close(mem_link *link) {
+    pthread_mutex_lock(&link->lock);
+    link->closed = 1;
+    pthread_cond_broadcast(&link->readable);
+    pthread_mutex_unlock(&link->lock);
+}
+
+void mem_link_reset(mem_link *link) {
+    pthread_mutex_lock(&link->lock);
+    for (int i = 0; i < 2; i++) {
+        link->clock_ns[i] = 0;
+        link->dir[i].wire_free_ns = 0;
+        for (segment *seg = link->dir[i].head; seg; seg = seg->next) {
+            seg->avail_ns = 0;
+            seg->before_reset = 1;
+        }
+    }
+    link->last_writer = -1;
+    memset(&link->stats, 0, sizeof(link->stats));
+    pthread_mutex_unlock(&link->lock);
+}
+
+void mem_link_stats(mem_link *link, mem_link_stats_t *stats) {
+    pthread_mutex_lock(&link->lock);
+    *stats = link->stats;
+    stats->now_ns = link->clock_ns[0] > link->clock_ns[1] ? link->clock_ns[0]
+                                                          : link->clock_ns[1];
+    pthread_mutex_unlock(&link->lock);
+}
@@ -0,0 +1,53 @@
+#ifndef MEM_LINK_H
+#define MEM_LINK_H
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+/* An in-memory duplex link between two WOLFSSL endpoints in one process,
+ * wired in through the custom IO callbacks. It models a slow serial link
+ * such as the LPC's UART: bytes queue behind each other at the configured
+ * bandwidth, arrive after a fixed latency and are handed to the reader in
+ * chunks of at most chunk bytes.
+ *
+ * Time is virtual. Every side has its own clock, which only moves forward
+ * when it reads bytes that arrive later than its current time, so the
+ * timings depend on the traffic alone, not on scheduling or host speed. The
+ * two sides must run on different threads, reads block until the peer
+ * writes. A nonblocking link instead lets one thread drive both sides,
+ * calling each in turn until neither wants to read. */
+typedef struct {
+    uint32_t latency_us;        /* one way */
+    uint32_t bytes_per_sec;     /* 0 for unlimited */
+    uint32_t chunk;             /* largest read handed out, 0 for unlimited */
+    int nonblocking;            /* reads of an empty link fail with WANT_READ */
+} mem_link_config_t;
+
+typedef struct {
+    uint64_t bytes[2];          /* written by each side */
+    uint64_t writes[2];
+    uint64_t reads[2];
+    uint64_t turns;             /* changes of the writing side */
+    uint64_t now_ns;            /* the later of the two clocks */
+} mem_link_stats_t;
+
+typedef struct mem_link mem_link;
+
+mem_link *mem_link_new(const mem_link_config_t *cfg);
+void mem_link_free(mem_link *link);
+
+/* Makes ssl send and receive through side 0 or 1 of the link. */
+void mem_link_attach(mem_link *link, WOLFSSL *ssl, int side);
+
+/* Makes pending and future reads on both sides fail once the queued bytes
+ * are drained, as if the peer closed the socket. */
+void mem_link_close(mem_link *link);
+
+/* Sets both clocks and all counters back to zero, e.g. after the handshake.
+ * Bytes still queued count as already arrived and their reads are not
+ * counted, so it does not matter whether the peer got to them yet. */
+void mem_link_reset(mem_link *link);
+
+void mem_link_stats(mem_link *link, mem_link_stats_t *stats);
+
+#endif
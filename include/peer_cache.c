@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#include "peer_cache.h"
+#include "util.h"
+
+#define NONE UINT32_MAX
+
+typedef struct {
+    uint8_t fingerprint[CERT_FINGERPRINT_LEN];
+    time_t not_after;
+    uint32_t chain;             // next entry in the same bucket
+    uint32_t newer, older;      // LRU list
+} entry;
+
+struct peer_cache {
+    WOLFSSL_CERT_MANAGER *cm;
+    entry *entries;
+    uint32_t *buckets;
+    uint32_t mask;              // buckets - 1
+    uint32_t capacity, used;
+    uint32_t newest, oldest;
+    peer_cache_stats_t stats;
+};
+
+static int ex_index = -1;
+
+static uint32_t *bucket(peer_cache *cache, const uint8_t *fp) {
+    uint32_t h = (uint32_t)fp[0] | fp[1] << 8 | fp[2] << 16 | (uint32_t)fp[3] << 24;
+    return &cache->buckets[h & cache->mask];
+}
+
+static void lru_unlink(peer_cache *cache, uint32_t i) {
+    entry *e = &cache->entries[i];
+
+    if (e->newer != NONE)
+        cache->entries[e->newer].older = e->older;
+    else
+        cache->newest = e->older;
+    if (e->older != NONE)
+        cache->entries[e->older].newer = e->newer;
+    else
+        cache->oldest = e->newer;
+}
+
+static void lru_push(peer_cache *cache, uint32_t i) {
+    entry *e = &cache->entries[i];
+
+    e->newer = NONE;
+    e->older = cache->newest;
+    if (cache->newest != NONE)
+        cache->entries[cache->newest].newer = i;
+    cache->newest = i;
+    if (cache->oldest == NONE)
+        cache->oldest = i;
+}
+
+static void chain_unlink(peer_cache *cache, uint32_t i) {
+    uint32_t *link = bucket(cache, cache->entries[i].fingerprint);
+
+    while (*link != i)
+        link = &cache->entries[*link].chain;
+    *link = cache->entries[i].chain;
+}
+
+// Entries are taken from the array in order and never given back to it, a
+// removed entry stays on the LRU list as the oldest and is reused first
+static void drop(peer_cache *cache, uint32_t i) {
+    chain_unlink(cache, i);
+    lru_unlink(cache, i);
+    cache->entries[i].not_after = 0;
+    cache->entries[i].newer = NONE;
+    cache->entries[i].older = cache->oldest;
+    if (cache->oldest != NONE)
+        cache->entries[cache->oldest].newer = i;
+    else
+        cache->newest = i;
+    cache->oldest = i;
+    cache->stats.entries--;
+}
+
+static uint32_t find(peer_cache *cache, const uint8_t *fp) {
+    uint32_t i = *bucket(cache, fp);
+
+    while (i != NONE && memcmp(cache->entries[i].fingerprint, fp, sizeof(cache->entries[i].fingerprint)) != 0)
+        i = cache->entries[i].chain;
+    return i;
+}
+
+static void insert(peer_cache *cache, const uint8_t *fp, time_t not_after) {
+    uint32_t *head, i;
+
+    if (cache->used < cache->capacity) {
+        i = cache->used++;
+    }
+    else {
+        i = cache->oldest;
+        if (cache->entries[i].not_after != 0) {
+            chain_unlink(cache, i);
+            cache->stats.evictions++;
+            cache->stats.entries--;
+        }
+        lru_unlink(cache, i);
+    }
+
+    memcpy(cache->entries[i].fingerprint, fp, sizeof(cache->entries[i].fingerprint));
+    cache->entries[i].not_after = not_after;
+    head = bucket(cache, fp);
+    cache->entries[i].chain = *head;
+    *head = i;
+    lru_push(cache, i);
+    cache->stats.entries++;
+}
+
+static time_t not_after(WOLFSSL_X509 *cert) {
+    WOLFSSL_ASN1_TIME *t = wolfSSL_X509_get_notAfter(cert);
+    struct tm tm;
+
+    if (!t || wolfSSL_ASN1_TIME_to_tm(t, &tm) != WOLFSSL_SUCCESS)
+        return 0;
+    return timegm(&tm);
+}
+
+static int verify_leaf(peer_cache *cache, WOLFSSL_X509 *cert) {
+    const unsigned char *der;
+    uint8_t fp[CERT_FINGERPRINT_LEN];
+    time_t expiry;
+    uint32_t i;
+    int derSz = 0;
+
+    der = wolfSSL_X509_get_der(cert, &derSz);
+    if (!der || derSz <= 0 || cert_fingerprint(cert, fp) != 0)
+        return 0;
+
+    cache->stats.lookups++;
+    i = find(cache, fp);
+    if (i != NONE) {
+        if (time(NULL) < cache->entries[i].not_after) {
+            lru_unlink(cache, i);
+            lru_push(cache, i);
+            cache->stats.hits++;
+            return 1;
+        }
+        cache->stats.expired++;
+        drop(cache, i);
+    }
+
+    // Checks the CA's signature and both validity dates
+    if (wolfSSL_CertManagerVerifyBuffer(cache->cm, der, derSz,
+                                        WOLFSSL_FILETYPE_ASN1) != WOLFSSL_SUCCESS) {
+        cache->stats.rejected++;
+        return 0;
+    }
+
+    expiry = not_after(cert);
+    if (expiry > time(NULL))
+        insert(cache, fp, expiry);
+    return 1;
+}
+
+static int verify_cb(int preverify, WOLFSSL_X509_STORE_CTX *store) {
+    peer_cache *cache = verify_ctx_data(store, ex_index);
+    WOLFSSL_X509 *cert;
+
+    (void)preverify;
+
+    // The fleet's certificates are issued by the CA directly, a chain
+    // would need its intermediates validated here as well
+    if (!cache || wolfSSL_X509_STORE_CTX_get_error_depth(store) > 0)
+        return 0;
+
+    cert = wolfSSL_X509_STORE_CTX_get_current_cert(store);
+    return cert && verify_leaf(cache, cert);
+}
+
+peer_cache *peer_cache_new(const char *ca_file, uint32_t entries) {
+    peer_cache *cache;
+    uint32_t buckets = 1;
+
+    if (entries == 0)
+        return NULL;
+
+    cache = calloc(1, sizeof(*cache));
+    if (!cache)
+        return NULL;
+
+    while (buckets < entries)
+        buckets <<= 1;
+
+    cache->entries = calloc(entries, sizeof(*cache->entries));
+    cache->buckets = malloc(buckets * sizeof(*cache->buckets));
+    cache->cm = wolfSSL_CertManagerNew();
+    if (!cache->entries || !cache->buckets || !cache->cm)
+        goto fail;
+
+    if (wolfSSL_CertManagerLoadCA(cache->cm, ca_file, NULL) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "Peer cache: failed to load %s\n", ca_file);
+        goto fail;
+    }
+
+    memset(cache->buckets, 0xff, buckets * sizeof(*cache->buckets));
+    cache->mask = buckets - 1;
+    cache->capacity = entries;
+    cache->newest = cache->oldest = NONE;
+    return cache;
+
+fail:
+    peer_cache_free(cache);
+    return NULL;
+}
+
+void peer_cache_free(peer_cache *cache) {
+    if (!cache)
+        return;
+
+    if (cache->cm)
+        wolfSSL_CertManagerFree(cache->cm);
+    free(cache->buckets);
+    free(cache->entries);
+    free(cache);
+}
+
+int peer_cache_attach(peer_cache *cache, WOLFSSL_CTX *ctx, int mode) {
+    if (set_verify_ctx_data(ctx, &ex_index, cache) != 0)
+        return -1;
+    wolfSSL_CTX_set_verify(ctx, mode, verify_cb);
+    return 0;
+}
+
+void peer_cache_stats(const peer_cache *cache, peer_cache_stats_t *stats) {
+    *stats = cache->stats;
+}
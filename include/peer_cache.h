@@ -0,0 +1,40 @@
+#ifndef PEER_CACHE_H
+#define PEER_CACHE_H
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+/* Remembers which peer certificates already passed chain validation, so a
+ * device that reconnects does not have its certificate's signature checked
+ * against the CA again. Entries are keyed by the SHA-256 of the certificate
+ * DER, expire at the certificate's notAfter and are evicted least recently
+ * used first. The handshake still checks the peer's signature with the
+ * certificate's key, the cache only skips the CA's signature on it.
+ *
+ * The CA is loaded into the cache's own certificate manager, not into the
+ * WOLFSSL_CTX, so that wolfSSL leaves every verdict to the cache. Not thread
+ * safe, handshakes on the attached ctx must not run concurrently. */
+typedef struct peer_cache peer_cache;
+
+typedef struct {
+    uint64_t lookups;           /* leaf certificates seen */
+    uint64_t hits;              /* accepted without chain validation */
+    uint64_t expired;           /* found past notAfter, validated again */
+    uint64_t evictions;         /* valid entries dropped for space */
+    uint64_t rejected;          /* failed chain validation */
+    uint32_t entries;           /* certificates cached right now */
+} peer_cache_stats_t;
+
+/* Returns NULL if ca_file cannot be loaded. */
+peer_cache *peer_cache_new(const char *ca_file, uint32_t entries);
+void peer_cache_free(peer_cache *cache);
+
+/* Makes ctx verify peers through the cache, with mode as for
+ * wolfSSL_CTX_set_verify(). ctx must not have CA certificates loaded. cache
+ * must outlive the handshakes on ctx. Returns -1 if wolfSSL has no ex_data
+ * slot for it. */
+int peer_cache_attach(peer_cache *cache, WOLFSSL_CTX *ctx, int mode);
+
+void peer_cache_stats(const peer_cache *cache, peer_cache_stats_t *stats);
+
+#endif
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+#include "pinned_keys.h"
+#include "util.h"
+
+typedef struct {
+    uint8_t used;
+    uint8_t fingerprint[PINNED_KEY_LEN];
+} slot;
+
+struct pinned_keys {
+    slot *slots;
+    uint32_t mask;      // capacity - 1, capacity is a power of two
+    size_t count;
+    pinned_keys_stats_t stats;
+};
+
+static int ex_index = -1;
+
+static uint32_t home(const pinned_keys *pins, const uint8_t *fp) {
+    return ((uint32_t)fp[0] | fp[1] << 8 | fp[2] << 16 | (uint32_t)fp[3] << 24) & pins->mask;
+}
+
+static void insert(pinned_keys *pins, const uint8_t *fp) {
+    uint32_t i = home(pins, fp);
+
+    while (pins->slots[i].used) {
+        if (memcmp(pins->slots[i].fingerprint, fp, PINNED_KEY_LEN) == 0)
+            return;
+        i = (i + 1) & pins->mask;
+    }
+    pins->slots[i].used = 1;
+    memcpy(pins->slots[i].fingerprint, fp, PINNED_KEY_LEN);
+    pins->count++;
+}
+
+int pinned_keys_contains(const pinned_keys *pins, const uint8_t fingerprint[PINNED_KEY_LEN]) {
+    uint32_t i = home(pins, fingerprint);
+
+    // Never full, see pinned_keys_load(), so an empty slot ends every probe
+    while (pins->slots[i].used) {
+        if (memcmp(pins->slots[i].fingerprint, fingerprint, PINNED_KEY_LEN) == 0)
+            return 1;
+        i = (i + 1) & pins->mask;
+    }
+    return 0;
+}
+
+static int parse_line(const char *line, uint8_t *fp) {
+    while (isspace((unsigned char)*line))
+        line++;
+    if (*line == '\0' || *line == '#')
+        return 1;
+
+    for (int i = 0; i < PINNED_KEY_LEN; i++) {
+        unsigned int byte;
+
+        if (!isxdigit((unsigned char)line[0]) || !isxdigit((unsigned char)line[1]) ||
+            sscanf(line, "%2x", &byte) != 1)
+            return -1;
+        fp[i] = (uint8_t)byte;
+        line += 2;
+    }
+    // sha256sum puts the file name after the digest
+    return *line == '\0' || isspace((unsigned char)*line) ? 0 : -1;
+}
+
+pinned_keys *pinned_keys_load(const char *path) {
+    uint8_t (*fps)[PINNED_KEY_LEN] = NULL;
+    size_t n = 0, cap = 0;
+    uint32_t capacity = 1;
+    pinned_keys *pins = NULL;
+    char line[256];
+    int lineNo = 0;
+    FILE *file;
+
+    file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Pinned keys: failed to open %s\n", path);
+        return NULL;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        uint8_t fp[PINNED_KEY_LEN];
+        int ret;
+
+        lineNo++;
+        ret = parse_line(line, fp);
+        if (ret < 0) {
+            fprintf(stderr, "Pinned keys: %s:%d is not a SHA-256 in hex\n", path, lineNo);
+            goto exit;
+        }
+        if (ret > 0)
+            continue;
+
+        if (n == cap) {
+            void *grown = realloc(fps, (cap ? 2 * cap : 16) * sizeof(*fps));
+            if (!grown)
+                goto exit;
+            fps = grown;
+            cap = cap ? 2 * cap : 16;
+        }
+        memcpy(fps[n++], fp, PINNED_KEY_LEN);
+    }
+
+    if (n == 0) {
+        fprintf(stderr, "Pinned keys: no keys in %s\n", path);
+        goto exit;
+    }
+
+    // At most half full keeps the probes short
+    while (capacity < 2 * n)
+        capacity <<= 1;
+
+    pins = calloc(1, sizeof(*pins));
+    if (!pins)
+        goto exit;
+    pins->slots = calloc(capacity, sizeof(*pins->slots));
+    if (!pins->slots) {
+        free(pins);
+        pins = NULL;
+        goto exit;
+    }
+    pins->mask = capacity - 1;
+    for (size_t i = 0; i < n; i++)
+        insert(pins, fps[i]);
+
+exit:
+    fclose(file);
+    free(fps);
+    return pins;
+}
+
+void pinned_keys_free(pinned_keys *pins) {
+    if (!pins)
+        return;
+
+    free(pins->slots);
+    free(pins);
+}
+
+size_t pinned_keys_count(const pinned_keys *pins) {
+    return pins->count;
+}
+
+// SHA-256 over the DER SubjectPublicKeyInfo of cert
+static int key_fingerprint(WOLFSSL_X509 *cert, uint8_t *fp) {
+    WOLFSSL_EVP_PKEY *key;
+    unsigned char *der = NULL;
+    int derSz, ret = -1;
+
+    key = wolfSSL_X509_get_pubkey(cert);
+    if (!key)
+        return -1;
+
+    derSz = wolfSSL_i2d_PUBKEY(key, &der);
+    if (derSz > 0 && wc_Sha256Hash(der, (word32)derSz, fp) == 0)
+        ret = 0;
+
+    XFREE(der, NULL, DYNAMIC_TYPE_OPENSSL);
+    wolfSSL_EVP_PKEY_free(key);
+    return ret;
+}
+
+static int verify_cb(int preverify, WOLFSSL_X509_STORE_CTX *store) {
+    pinned_keys *pins = verify_ctx_data(store, ex_index);
+    WOLFSSL_X509 *cert;
+    uint8_t fp[PINNED_KEY_LEN];
+    int ok;
+
+    (void)preverify;
+
+    if (!pins)
+        return 0;
+
+    // Only the leaf carries the key, anything above it is not looked at
+    if (wolfSSL_X509_STORE_CTX_get_error_depth(store) > 0)
+        return 1;
+
+    cert = wolfSSL_X509_STORE_CTX_get_current_cert(store);
+    ok = cert && key_fingerprint(cert, fp) == 0 && pinned_keys_contains(pins, fp);
+    if (ok)
+        pins->stats.accepted++;
+    else
+        pins->stats.rejected++;
+    return ok;
+}
+
+int pinned_keys_attach(pinned_keys *pins, WOLFSSL_CTX *ctx, int mode) {
+    if (set_verify_ctx_data(ctx, &ex_index, pins) != 0)
+        return -1;
+    wolfSSL_CTX_set_verify(ctx, mode, verify_cb);
+    return 0;
+}
+
+void pinned_keys_stats(const pinned_keys *pins, pinned_keys_stats_t *stats) {
+    *stats = pins->stats;
+}
@@ -0,0 +1,40 @@
+#ifndef PINNED_KEYS_H
+#define PINNED_KEYS_H
+#include <stddef.h>
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#define PINNED_KEY_LEN 32   /* SHA-256 of the DER SubjectPublicKeyInfo */
+
+/* Peer authentication by an allowlist of public keys instead of a CA, for a
+ * fixed fleet of devices. The peer's certificate is only a container for its
+ * key: no chain is built and no CA signature is checked, the handshake still
+ * proves possession of the private key. The set is an open-addressing hash
+ * table, so the lookup costs one SHA-256 over the key regardless of the
+ * fleet size. */
+typedef struct pinned_keys pinned_keys;
+
+typedef struct {
+    uint64_t accepted;
+    uint64_t rejected;
+} pinned_keys_stats_t;
+
+/* Reads one hex SHA-256 per line, '#' starts a comment, e.g. the output of
+ * sha256sum over the *-pubkey.der files. Returns NULL if the file cannot be
+ * read, has a malformed line or no keys. */
+pinned_keys *pinned_keys_load(const char *path);
+void pinned_keys_free(pinned_keys *pins);
+
+size_t pinned_keys_count(const pinned_keys *pins);
+int pinned_keys_contains(const pinned_keys *pins, const uint8_t fingerprint[PINNED_KEY_LEN]);
+
+/* Makes ctx accept exactly the pinned peers, with mode as for
+ * wolfSSL_CTX_set_verify(). ctx must not have CA certificates loaded, they
+ * would let chain-valid peers past the pin check. pins must outlive the
+ * handshakes on ctx. Returns -1 if wolfSSL has no ex_data slot for it. */
+int pinned_keys_attach(pinned_keys *pins, WOLFSSL_CTX *ctx, int mode);
+
+void pinned_keys_stats(const pinned_keys *pins, pinned_keys_stats_t *stats);
+
+#endif
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/challenge.h"
+#include "puf_prover.h"
+#include "puf_device.h"
+
+/* The server sends init and commitment only when it needs them, the proofs
+ * challenge always comes last. */
+#define MAX_REQUESTS 3
+
+struct puf_device {
+    uint32_t id;
+    uint8_t seed[LEN32];
+    puf_proof_buf_t proof;      // g, h and COM are fixed per device
+};
+
+puf_device *puf_device_new(uint32_t id) {
+    uint8_t nonce[PUF_NONCE_LEN] = {0};
+    puf_device *dev;
+
+    dev = calloc(1, sizeof(*dev));
+    if (!dev)
+        return NULL;
+
+    dev->id = id;
+    dev->seed[0] = (uint8_t)id;
+    dev->seed[1] = (uint8_t)(id >> 8);
+    dev->seed[2] = (uint8_t)(id >> 16);
+    dev->seed[3] = (uint8_t)(id >> 24);
+
+    // g, h and COM do not depend on the nonce, derive them once
+    if (puf_prover_prove(dev->seed, nonce, &dev->proof) != 0) {
+        free(dev);
+        return NULL;
+    }
+    return dev;
+}
+
+void puf_device_free(puf_device *dev) {
+    free(dev);
+}
+
+static const uint8_t *request_pattern(func_t base, int compressed) {
+    switch (base) {
+    case PUF_TA_INIT_FUNC_ID:
+        return compressed ? pattern_none : pattern_init_commit;
+    case PUF_TA_GET_COMMITMENT_FUNC_ID:
+        return compressed ? pattern_commit_request : pattern_init_commit;
+    case PUF_TA_GET_ZK_PROOFS_FUNC_ID:
+        return compressed ? pattern_proofs_request : pattern_proofs;
+    }
+    return NULL;
+}
+
+// Fills rsp with the answer to req, in the encoding req asked for
+static int answer(puf_device *dev, func_call_t *req, func_call_t *rsp) {
+    func_t base = req->func & ~PUF_TA_COMPRESSED_POINTS;
+    int compressed = (req->func & PUF_TA_COMPRESSED_POINTS) != 0;
+    puf_proof_buf_t *pr = &dev->proof;
+
+    switch (base) {
+    case PUF_TA_INIT_FUNC_ID:
+        if (initFunc(rsp, req->func, compressed ? pattern_init_compressed : pattern_init_commit))
+            return -1;
+        if (compressed) {
+            compressPoint(pr->gx, pr->gy, rsp->data_p[0].data);
+            compressPoint(pr->hx, pr->hy, rsp->data_p[1].data);
+        } else {
+            memcpy(rsp->data_p[0].data, pr->gx, LEN32);
+            memcpy(rsp->data_p[1].data, pr->gy, LEN32);
+            memcpy(rsp->data_p[2].data, pr->hx, LEN32);
+            memcpy(rsp->data_p[3].data, pr->hy, LEN32);
+        }
+        return 0;
+
+    case PUF_TA_GET_COMMITMENT_FUNC_ID:
+        if (initFunc(rsp, req->func, compressed ? pattern_commit_compressed : pattern_init_commit))
+            return -1;
+        if (compressed) {
+            compressPoint(pr->COMx, pr->COMy, rsp->data_p[0].data);
+        } else {
+            memcpy(rsp->data_p[0].data, req->data_p[0].data, LEN32);
+            memcpy(rsp->data_p[1].data, req->data_p[1].data, LEN32);
+            memcpy(rsp->data_p[2].data, pr->COMx, LEN32);
+            memcpy(rsp->data_p[3].data, pr->COMy, LEN32);
+        }
+        return 0;
+
+    case PUF_TA_GET_ZK_PROOFS_FUNC_ID:
+        // The nonce is the third portion in both encodings
+        if (puf_prover_prove(dev->seed, req->data_p[2].data, pr) != 0)
+            return -1;
+        if (initFunc(rsp, req->func, compressed ? pattern_proofs_compressed : pattern_proofs))
+            return -1;
+        if (compressed) {
+            compressPoint(pr->Px, pr->Py, rsp->data_p[0].data);
+            memcpy(rsp->data_p[1].data, pr->v, LEN64);
+            memcpy(rsp->data_p[2].data, pr->w, LEN64);
+        } else {
+            memcpy(rsp->data_p[0].data, pr->Px, LEN32);
+            memcpy(rsp->data_p[1].data, pr->Py, LEN32);
+            memcpy(rsp->data_p[2].data, pr->v, LEN64);
+            memcpy(rsp->data_p[3].data, pr->w, LEN64);
+        }
+        return 0;
+    }
+    return -1;
+}
+
+int puf_device_serve(puf_device *dev, WOLFSSL *ssl, int delay_ms) {
+    func_call_t req, rsp[MAX_REQUESTS];
+    const uint8_t *pattern;
+    func_t id = 0;
+    int count = 0;
+    int ret = -1;
+
+    memset(&req, 0, sizeof(req));
+    memset(rsp, 0, sizeof(rsp));
+
+    while ((id & ~PUF_TA_COMPRESSED_POINTS) != PUF_TA_GET_ZK_PROOFS_FUNC_ID) {
+        if (count == MAX_REQUESTS || recFuncId(ssl, &id))
+            goto exit;
+
+        pattern = request_pattern(id & ~PUF_TA_COMPRESSED_POINTS,
+                                  (id & PUF_TA_COMPRESSED_POINTS) != 0);
+        if (!pattern) {
+            fprintf(stderr, "PUF device %u: unknown func id 0x%08X\n", dev->id, id);
+            goto exit;
+        }
+
+        freeFunc(&req);
+        if (initFunc(&req, id, pattern) || recPortions(ssl, &req) ||
+            answer(dev, &req, &rsp[count]) != 0)
+            goto exit;
+        count++;
+    }
+
+    if (delay_ms > 0)
+        sleepUs((uint64_t)delay_ms * 1000);
+
+    for (int i = 0; i < count; i++) {
+        if (sendResponse(ssl, &rsp[i]))
+            goto exit;
+    }
+    ret = 0;
+
+exit:
+    freeFunc(&req);
+    for (int i = 0; i < MAX_REQUESTS; i++)
+        freeFunc(&rsp[i]);
+    return ret;
+}
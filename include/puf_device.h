@@ -0,0 +1,21 @@
+#ifndef PUF_DEVICE_H
+#define PUF_DEVICE_H
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+/* The LPC55S69 side of the NXP_PUF exchange, answered with puf_prover
+ * proofs. Used by the load test tools. Not for production use. */
+typedef struct puf_device puf_device;
+
+/* Devices created with the same id share one PUF. id 0 is the PUF every
+ * puf-sim device presents by default. */
+puf_device *puf_device_new(uint32_t id);
+void puf_device_free(puf_device *dev);
+
+/* Receives the server's challenges up to the proofs one, waits delay_ms,
+ * then sends the responses in order, as the LPC firmware does. Answers in
+ * the encoding the server asks for. Returns 0 on success. */
+int puf_device_serve(puf_device *dev, WOLFSSL *ssl, int delay_ms);
+
+#endif
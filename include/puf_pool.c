@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+
+#include "puf_pool.h"
+
+struct puf_job {
+    puf_proof_buf_t buf;
+    int fd;         // eventfd, written once by the worker
+    int done;
+    int result;
+};
+
+typedef struct {
+    puf_pool *pool;
+    puf_verifier_ctx *ctx;
+    pthread_t thread;
+    int started;
+} Worker;
+
+struct puf_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty, not_full;
+
+    // Ring of pending jobs
+    puf_job **queue;
+    int depth, head, count;
+    int stopping;
+
+    Worker *workers;
+    int threads;
+};
+
+static void *worker_main(void *arg) {
+    Worker *worker = arg;
+    puf_pool *pool = worker->pool;
+    puf_proof_t proof;
+    uint64_t one = 1;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->count == 0 && !pool->stopping)
+            pthread_cond_wait(&pool->not_empty, &pool->lock);
+        if (pool->count == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        puf_job *job = pool->queue[pool->head];
+        pool->head = (pool->head + 1) % pool->depth;
+        pool->count--;
+        pthread_cond_signal(&pool->not_full);
+        pthread_mutex_unlock(&pool->lock);
+
+        puf_proof_view(&job->buf, &proof);
+        job->result = verify_proof(worker->ctx, &proof);
+
+        if (write(job->fd, &one, sizeof(one)) != sizeof(one))
+            fprintf(stderr, "PUF pool: failed to signal job completion (%d)\n", errno);
+    }
+
+    return NULL;
+}
+
+puf_pool *puf_pool_new(int threads, int queue_depth) {
+    puf_pool *pool;
+
+    if (threads < 1 || queue_depth < 1)
+        return NULL;
+
+    pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    pool->depth = queue_depth;
+    pool->threads = threads;
+    pool->queue = calloc(queue_depth, sizeof(*pool->queue));
+    pool->workers = calloc(threads, sizeof(*pool->workers));
+    if (!pool->queue || !pool->workers) {
+        free(pool->queue);
+        free(pool->workers);
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->not_empty, NULL);
+    pthread_cond_init(&pool->not_full, NULL);
+
+    for (int i = 0; i < threads; i++) {
+        Worker *worker = &pool->workers[i];
+
+        worker->pool = pool;
+        worker->ctx = puf_verifier_ctx_new();
+        if (!worker->ctx) {
+            fprintf(stderr, "PUF pool: failed to create verifier context\n");
+            goto error;
+        }
+        // Step by step output of parallel workers would interleave
+        puf_verifier_ctx_set_verbose(worker->ctx, 0);
+
+        if (pthread_create(&worker->thread, NULL, worker_main, worker) != 0) {
+            fprintf(stderr, "PUF pool: failed to start worker %d\n", i);
+            goto error;
+        }
+        worker->started = 1;
+    }
+
+    return pool;
+
+error:
+    puf_pool_free(pool);
+    return NULL;
+}
+
+void puf_pool_free(puf_pool *pool) {
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_cond_broadcast(&pool->not_full);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->threads; i++) {
+        if (pool->workers[i].started)
+            pthread_join(pool->workers[i].thread, NULL);
+        puf_verifier_ctx_free(pool->workers[i].ctx);
+    }
+
+    pthread_cond_destroy(&pool->not_full);
+    pthread_cond_destroy(&pool->not_empty);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool->queue);
+    free(pool);
+}
+
+puf_job *puf_pool_submit(puf_pool *pool, const puf_proof_t *proof) {
+    puf_job *job = calloc(1, sizeof(*job));
+    if (!job)
+        return NULL;
+
+    job->fd = eventfd(0, EFD_CLOEXEC);
+    if (job->fd < 0) {
+        fprintf(stderr, "PUF pool: eventfd() failed (%d)\n", errno);
+        free(job);
+        return NULL;
+    }
+    puf_proof_copy(&job->buf, proof);
+
+    pthread_mutex_lock(&pool->lock);
+    while (pool->count == pool->depth && !pool->stopping)
+        pthread_cond_wait(&pool->not_full, &pool->lock);
+    if (pool->stopping) {
+        pthread_mutex_unlock(&pool->lock);
+        close(job->fd);
+        free(job);
+        return NULL;
+    }
+    pool->queue[(pool->head + pool->count) % pool->depth] = job;
+    pool->count++;
+    pthread_cond_signal(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    return job;
+}
+
+puf_job *puf_pool_submit_portions(puf_pool *pool, func_call_t *init, func_call_t *comm,
+                                  func_call_t *proofs, data_portion_t *nonce) {
+    puf_proof_t proof;
+
+    if (puf_proof_from_portions(&proof, init, comm, proofs, nonce) != 0)
+        return NULL;
+    return puf_pool_submit(pool, &proof);
+}
+
+int puf_job_wait(puf_job *job) {
+    uint64_t value;
+
+    while (!job->done) {
+        if (read(job->fd, &value, sizeof(value)) == sizeof(value)) {
+            job->done = 1;
+        } else if (errno != EINTR) {
+            fprintf(stderr, "PUF pool: failed to wait for job (%d)\n", errno);
+            return -1;
+        }
+    }
+
+    return job->result;
+}
+
+void puf_job_free(puf_job *job) {
+    if (!job)
+        return;
+
+    puf_job_wait(job);
+    close(job->fd);
+    free(job);
+}
@@ -0,0 +1,28 @@
+#ifndef PUF_POOL_H
+#define PUF_POOL_H
+#include "puf_verifier.h"
+
+/* Worker threads verifying PUF proofs off the connection thread. Each worker
+ * owns its own puf_verifier_ctx and jobs are fed through a bounded queue. */
+typedef struct puf_pool puf_pool;
+typedef struct puf_job puf_job;
+
+puf_pool *puf_pool_new(int threads, int queue_depth);
+
+/* Finishes the queued jobs, then stops and joins the workers. */
+void puf_pool_free(puf_pool *pool);
+
+/* Queue a verification, blocking while the queue is full. The proof material
+ * is copied, so the caller may reuse its buffers right away. Returns NULL on
+ * error. */
+puf_job *puf_pool_submit(puf_pool *pool, const puf_proof_t *proof);
+puf_job *puf_pool_submit_portions(puf_pool *pool, func_call_t *init, func_call_t *comm,
+                                  func_call_t *proofs, data_portion_t *nonce);
+
+/* Blocks until the job is done and returns the verify_proof() result. */
+int puf_job_wait(puf_job *job);
+
+/* Waits for the job if needed and releases it. */
+void puf_job_free(puf_job *job);
+
+#endif
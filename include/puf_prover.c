@@ -0,0 +1,175 @@
+#include <string.h>
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+#include "puf_prover.h"
+
+// P-256 domain parameters
+#define P256_PRIME "FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF"
+#define P256_A     "FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFC"
+#define P256_ORDER "FFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551"
+#define P256_GX    "6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296"
+#define P256_GY    "4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5"
+
+// Labels mixed into the seed for each derived secret
+enum { LABEL_XG = 1, LABEL_XH, LABEL_S, LABEL_T, LABEL_A, LABEL_B };
+
+typedef struct {
+    mp_int prime, a, order;
+    mp_int xg, xh, s, t, ra, rb;    // discrete logs of g, h and the witnesses
+    mp_int alpha, k, tmp;
+    ecc_point *G, *R;
+} Prover;
+
+// out = SHA256(seed || nonce || label) mod n, never zero
+static int derive_scalar(Prover* pr, const uint8_t* seed, const uint8_t* nonce,
+                         uint8_t label, mp_int* out) {
+    wc_Sha256 sha;
+    byte digest[WC_SHA256_DIGEST_SIZE];
+    int ret;
+
+    ret = wc_InitSha256(&sha);
+    if (ret == 0)
+        ret = wc_Sha256Update(&sha, seed, LEN32);
+    if (ret == 0 && nonce)
+        ret = wc_Sha256Update(&sha, nonce, PUF_NONCE_LEN);
+    if (ret == 0)
+        ret = wc_Sha256Update(&sha, &label, 1);
+    if (ret == 0)
+        ret = wc_Sha256Final(&sha, digest);
+    wc_Sha256Free(&sha);
+
+    if (ret == 0)
+        ret = mp_read_unsigned_bin(out, digest, sizeof(digest));
+    if (ret == 0)
+        ret = mp_mod(out, &pr->order, out);
+    if (ret == 0 && mp_iszero(out))
+        ret = mp_set(out, 1);
+    return ret;
+}
+
+// (x, y) = k * G
+static int base_mul(Prover* pr, mp_int* k, uint8_t* x, uint8_t* y) {
+    int ret = wc_ecc_mulmod(k, pr->G, pr->R, &pr->a, &pr->prime, 1);
+    if (ret == 0)
+        ret = mp_to_unsigned_bin_len(pr->R->x, x, PUF_COORDINATE_LEN);
+    if (ret == 0)
+        ret = mp_to_unsigned_bin_len(pr->R->y, y, PUF_COORDINATE_LEN);
+    return ret;
+}
+
+// out = (x * y1 + y * y2) mod n
+static int combine(Prover* pr, mp_int* x, mp_int* y1, mp_int* y, mp_int* y2, mp_int* out) {
+    int ret = mp_mulmod(x, y1, &pr->order, &pr->tmp);
+    if (ret == 0)
+        ret = mp_mulmod(y, y2, &pr->order, out);
+    if (ret == 0)
+        ret = mp_addmod(out, &pr->tmp, &pr->order, out);
+    return ret;
+}
+
+int puf_prover_prove(const uint8_t seed[LEN32], const uint8_t nonce[PUF_NONCE_LEN],
+                     puf_proof_buf_t *out) {
+    Prover pr;
+    byte alpha[WC_SHA256_DIGEST_SIZE];
+    wc_Sha256 sha;
+    int ret;
+
+    memset(&pr, 0, sizeof(pr));
+    memset(out, 0, sizeof(*out));
+    memcpy(out->nonce, nonce, PUF_NONCE_LEN);
+
+    ret = mp_init(&pr.prime);
+    if (ret == 0) ret = mp_init(&pr.a);
+    if (ret == 0) ret = mp_init(&pr.order);
+    if (ret == 0) ret = mp_init(&pr.xg);
+    if (ret == 0) ret = mp_init(&pr.xh);
+    if (ret == 0) ret = mp_init(&pr.s);
+    if (ret == 0) ret = mp_init(&pr.t);
+    if (ret == 0) ret = mp_init(&pr.ra);
+    if (ret == 0) ret = mp_init(&pr.rb);
+    if (ret == 0) ret = mp_init(&pr.alpha);
+    if (ret == 0) ret = mp_init(&pr.k);
+    if (ret == 0) ret = mp_init(&pr.tmp);
+    if (ret != 0)
+        goto cleanup;
+
+    pr.G = wc_ecc_new_point();
+    pr.R = wc_ecc_new_point();
+    if (!pr.G || !pr.R) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    ret = mp_read_radix(&pr.prime, P256_PRIME, 16);
+    if (ret == 0) ret = mp_read_radix(&pr.a, P256_A, 16);
+    if (ret == 0) ret = mp_read_radix(&pr.order, P256_ORDER, 16);
+    if (ret == 0) ret = mp_read_radix(pr.G->x, P256_GX, 16);
+    if (ret == 0) ret = mp_read_radix(pr.G->y, P256_GY, 16);
+    if (ret == 0) ret = mp_set(pr.G->z, 1);
+    if (ret != 0)
+        goto cleanup;
+
+    // Device secrets depend on the seed only, the witnesses on the nonce too
+    ret = derive_scalar(&pr, seed, NULL, LABEL_XG, &pr.xg);
+    if (ret == 0) ret = derive_scalar(&pr, seed, NULL, LABEL_XH, &pr.xh);
+    if (ret == 0) ret = derive_scalar(&pr, seed, NULL, LABEL_S, &pr.s);
+    if (ret == 0) ret = derive_scalar(&pr, seed, NULL, LABEL_T, &pr.t);
+    if (ret == 0) ret = derive_scalar(&pr, seed, nonce, LABEL_A, &pr.ra);
+    if (ret == 0) ret = derive_scalar(&pr, seed, nonce, LABEL_B, &pr.rb);
+    if (ret != 0)
+        goto cleanup;
+
+    // g = xg*G, h = xh*G, COM = g^s*h^t, P = g^a*h^b
+    ret = base_mul(&pr, &pr.xg, out->gx, out->gy);
+    if (ret == 0) ret = base_mul(&pr, &pr.xh, out->hx, out->hy);
+    if (ret == 0) ret = combine(&pr, &pr.s, &pr.xg, &pr.t, &pr.xh, &pr.k);
+    if (ret == 0) ret = base_mul(&pr, &pr.k, out->COMx, out->COMy);
+    if (ret == 0) ret = combine(&pr, &pr.ra, &pr.xg, &pr.rb, &pr.xh, &pr.k);
+    if (ret == 0) ret = base_mul(&pr, &pr.k, out->Px, out->Py);
+    if (ret != 0)
+        goto cleanup;
+
+    // α = H(Px || Py || nonce), as computed by the verifier
+    ret = wc_InitSha256(&sha);
+    if (ret == 0) ret = wc_Sha256Update(&sha, out->Px, PUF_COORDINATE_LEN);
+    if (ret == 0) ret = wc_Sha256Update(&sha, out->Py, PUF_COORDINATE_LEN);
+    if (ret == 0) ret = wc_Sha256Update(&sha, nonce, PUF_NONCE_LEN);
+    if (ret == 0) ret = wc_Sha256Final(&sha, alpha);
+    wc_Sha256Free(&sha);
+    if (ret == 0) ret = mp_read_unsigned_bin(&pr.alpha, alpha, sizeof(alpha));
+    if (ret != 0)
+        goto cleanup;
+
+    // v = a + α*s, w = b + α*t (mod n)
+    ret = mp_mulmod(&pr.alpha, &pr.s, &pr.order, &pr.k);
+    if (ret == 0) ret = mp_addmod(&pr.k, &pr.ra, &pr.order, &pr.k);
+    if (ret == 0) ret = mp_to_unsigned_bin_len(&pr.k, out->v, PUF_SCALAR_LEN);
+    if (ret == 0) ret = mp_mulmod(&pr.alpha, &pr.t, &pr.order, &pr.k);
+    if (ret == 0) ret = mp_addmod(&pr.k, &pr.rb, &pr.order, &pr.k);
+    if (ret == 0) ret = mp_to_unsigned_bin_len(&pr.k, out->w, PUF_SCALAR_LEN);
+
+cleanup:
+    wc_ecc_del_point(pr.G);
+    wc_ecc_del_point(pr.R);
+    mp_forcezero(&pr.xg);
+    mp_forcezero(&pr.xh);
+    mp_forcezero(&pr.s);
+    mp_forcezero(&pr.t);
+    mp_forcezero(&pr.ra);
+    mp_forcezero(&pr.rb);
+    mp_clear(&pr.prime);
+    mp_clear(&pr.a);
+    mp_clear(&pr.order);
+    mp_clear(&pr.xg);
+    mp_clear(&pr.xh);
+    mp_clear(&pr.s);
+    mp_clear(&pr.t);
+    mp_clear(&pr.ra);
+    mp_clear(&pr.rb);
+    mp_clear(&pr.alpha);
+    mp_clear(&pr.k);
+    mp_clear(&pr.tmp);
+    return ret == 0 ? 0 : -1;
+}
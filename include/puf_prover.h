@@ -0,0 +1,14 @@
+#ifndef PUF_PROVER_H
+#define PUF_PROVER_H
+#include "puf_verifier.h"
+
+/* Software stand-in for the PUF TA, used to generate proofs for benchmarks
+ * and tests without a device. Every secret is derived from the seed, so the
+ * same seed always yields the same g, h and COM. Not for production use. */
+
+/* Fills out with a valid proof for the device identified by seed, answering
+ * the given nonce. Returns 0 on success. */
+int puf_prover_prove(const uint8_t seed[LEN32], const uint8_t nonce[PUF_NONCE_LEN],
+                     puf_proof_buf_t *out);
+
+#endif
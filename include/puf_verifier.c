@@ -5,11 +5,11 @@
 #include <wolfssl/options.h>
 #include <wolfssl/wolfcrypt/ecc.h>
 #include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/random.h>
 #include <wolfssl/wolfcrypt/asn.h>
-#include <stdbool.h>
 
+#include "puf_verifier.h"
 #ifndef STANDALONE
-  #include "common/challenge.h"
   #include "common/log.h"
 #endif
 
@@ -24,77 +24,96 @@
     #define USE_SP_MATH 0
 #endif
 
-#define HEX_BUFFER_SIZE 1024
-#define COORDINATE_BYTES 32
-#define NONCE_BYTES 64
-#define PREIMAGE_BYTES 128
+#define COORDINATE_BYTES PUF_COORDINATE_LEN
+#define SCALAR_BYTES PUF_SCALAR_LEN
+#define NONCE_BYTES PUF_NONCE_LEN
 
 typedef struct {
     math_int_t x, y;
 } EccPoint;
 
-typedef struct {
-    char *gx, *gy, *hx, *hy;
-    char *COMx, *COMy, *Px, *Py;
-    char *nonce, *v, *w;
-} Args;
+#ifdef PUF_WOLFCRYPT_BACKEND
+  #define DEFAULT_BACKEND PUF_BACKEND_WOLFCRYPT
+#else
+  #define DEFAULT_BACKEND PUF_BACKEND_CUSTOM
+#endif
 
-// Function prototypes
-int parse_hex_to_math(const char* input_str, math_int_t* num);
-void print_usage(const char* program_name);
-int init_ecc_point(EccPoint* point);
-void free_ecc_point(EccPoint* point);
-void print_ecc_point(const char* name, EccPoint* point);
-void print_scalar(const char* name, math_int_t* scalar);
-int ecc_point_add_custom(EccPoint* result, EccPoint* a, EccPoint* b, ecc_key* key);
-int ecc_point_mul_custom(EccPoint* result, math_int_t* scalar, EccPoint* point, ecc_key* key);
-int ecc_points_equal(EccPoint* a, EccPoint* b);
-int verify_zk_proof(Args* args);
+struct puf_verifier_ctx {
+    int verbose;
+    puf_backend_t backend;
+    ecc_key key;
+    WC_RNG rng;
+    int rng_ready;
+    math_int_t prime, curve_a, curve_b, order;
 
-// Helper function to test if a specific bit is set in a big integer
-int test_bit(math_int_t* num, int bit_index) {
-#if USE_SP_MATH
-    // For SP math, use a simple approach similar to mp_int
-    if (bit_index >= sp_count_bits(num)) return 0;
+    // Proof inputs
+    EccPoint g, h, COM, P;
+    math_int_t v, w, alpha;
 
-    sp_int temp;
-    sp_init(&temp);
-    sp_copy(num, &temp);
+    // Step 11 intermediates
+    EccPoint vg, wh, left_side, alpha_COM, right_side;
 
-    // Divide by 2^bit_index to shift right
-    for (int i = 0; i < bit_index; i++) {
-        sp_div_2(&temp, &temp);
-    }
+    // ecc_point_add_custom() scratch
+    math_int_t temp1, temp2, temp3, lambda, x3, y3;
 
-    // Check if the result is odd (bit is set)
-    int result = sp_isodd(&temp);
+    // ecc_point_mul_custom() scratch
+    EccPoint mul_result, mul_point;
 
-    sp_clear(&temp);
-    return result;
-#else
-    // For mp_int, implement bit testing using division
-    if (bit_index >= mp_count_bits(num)) return 0;
+    // ecc_point_mul_wolfcrypt() scratch
+    ecc_point *wc_base, *wc_result;
+    math_int_t reduced;
 
-    mp_int temp;
-    mp_init(&temp);
+    // Batch verification scratch
+    math_int_t weight;
 
-    // Copy the number
-    mp_copy(num, &temp);
+    // (p + 1) / 4, square roots mod p are a single exponentiation
+    math_int_t sqrt_exp;
+};
 
-    // Divide by 2^bit_index to shift right
-    for (int i = 0; i < bit_index; i++) {
-        mp_div_2(&temp, &temp);
-    }
+// Step by step output, silenced for benchmarks
+#define VERBOSE(ctx, ...) do { if ((ctx)->verbose) printf(__VA_ARGS__); } while (0)
+
+typedef struct {
+    char *gx, *gy, *hx, *hy;
+    char *COMx, *COMy, *Px, *Py;
+    char *nonce, *v, *w;
+} Args;
 
-    // Check if the result is odd (bit is set)
-    int result = mp_isodd(&temp);
+// Function prototypes
+static int parse_hex_to_math(const char* input_str, math_int_t* num);
+#ifdef STANDALONE
+static void print_usage(const char* program_name);
+#endif
+static int init_math_int(math_int_t* num);
+static void free_math_int(math_int_t* num);
+static int load_math_int(math_int_t* num, const uint8_t* data, int len);
+static int store_math_int(math_int_t* num, uint8_t* data, int len);
+static int init_ecc_point(EccPoint* point);
+static void free_ecc_point(EccPoint* point);
+static void print_ecc_point(const char* name, EccPoint* point);
+static void print_scalar(const char* name, math_int_t* scalar);
+static int ecc_point_add_custom(puf_verifier_ctx* ctx, EccPoint* result, EccPoint* a, EccPoint* b);
+static int ecc_point_mul_custom(puf_verifier_ctx* ctx, EccPoint* result, math_int_t* scalar, EccPoint* point);
+static int ecc_point_mul_wolfcrypt(puf_verifier_ctx* ctx, EccPoint* result, math_int_t* scalar, EccPoint* point);
+static int ecc_point_mul(puf_verifier_ctx* ctx, EccPoint* result, math_int_t* scalar, EccPoint* point);
+static int ecc_point_on_curve(puf_verifier_ctx* ctx, EccPoint* point);
+static void set_infinity(EccPoint* point);
+static int is_infinity(EccPoint* point);
+static int ecc_points_equal(EccPoint* a, EccPoint* b);
+#ifdef STANDALONE
+static int verify_zk_proof(puf_verifier_ctx* ctx, Args* args);
+#endif
 
-    mp_clear(&temp);
-    return result;
+// Helper function to test if a specific bit is set in a big integer
+static int test_bit(math_int_t* num, int bit_index) {
+#if USE_SP_MATH
+    return sp_is_bit_set(num, (unsigned int)bit_index);
+#else
+    return mp_is_bit_set(num, (mp_digit)bit_index);
 #endif
 }
 
-int parse_hex_to_math(const char* hex_str, math_int_t* num) {
+static int parse_hex_to_math(const char* hex_str, math_int_t* num) {
     char* clean_str = (char*)hex_str;
     int radix = 10;  // Default to decimal
 
@@ -114,7 +133,7 @@ int parse_hex_to_math(const char* hex_str, math_int_t* num) {
 
 #ifdef STANDALONE
 // Print usage information
-void print_usage(const char* program_name) {
+static void print_usage(const char* program_name) {
     printf("Zero Knowledge Verifier Proof Tool (P-256)\n");
     printf("Usage: %s [OPTIONS]\n\n", program_name);
     printf("Options:\n");
@@ -133,8 +152,26 @@ void print_usage(const char* program_name) {
 }
 #endif /* STANDALONE */
 
+// Initialize big integer
+static int init_math_int(math_int_t* num) {
+#if USE_SP_MATH
+    return sp_init(num) == MP_OKAY ? 0 : -1;
+#else
+    return mp_init(num) == MP_OKAY ? 0 : -1;
+#endif
+}
+
+// Free big integer
+static void free_math_int(math_int_t* num) {
+#if USE_SP_MATH
+    sp_clear(num);
+#else
+    mp_clear(num);
+#endif
+}
+
 // Initialize ECC point
-int init_ecc_point(EccPoint* point) {
+static int init_ecc_point(EccPoint* point) {
 #if USE_SP_MATH
     if (sp_init(&point->x) != MP_OKAY) return -1;
     if (sp_init(&point->y) != MP_OKAY) {
@@ -152,7 +189,7 @@ int init_ecc_point(EccPoint* point) {
 }
 
 // Free ECC point
-void free_ecc_point(EccPoint* point) {
+static void free_ecc_point(EccPoint* point) {
 #if USE_SP_MATH
     sp_clear(&point->x);
     sp_clear(&point->y);
@@ -163,7 +200,7 @@ void free_ecc_point(EccPoint* point) {
 }
 
 // Print ECC point in SageMath format: E((0xhex_x, 0xhex_y))
-void print_ecc_point(const char* name, EccPoint* point) {
+static void print_ecc_point(const char* name, EccPoint* point) {
     byte x_bytes[64], y_bytes[64];  // Large enough for any coordinate
     int x_len, y_len;
 
@@ -193,7 +230,7 @@ void print_ecc_point(const char* name, EccPoint* point) {
 }
 
 // Print scalar in hex format to match SageMath
-void print_scalar(const char* name, math_int_t* scalar) {
+static void print_scalar(const char* name, math_int_t* scalar) {
     byte bytes[64];  // Large enough for any scalar
     int len;
 
@@ -212,32 +249,12 @@ void print_scalar(const char* name, math_int_t* scalar) {
     printf("\n");
 }
 
-// Parse decimal or hexadecimal string to math_int_t (matches SageMath parse_input)
-int ecc_point_add_custom(EccPoint* result, EccPoint* a, EccPoint* b, ecc_key* key) {
-    // Remove verbose output - only print on first call
-    static int first_call = 1;
-    if (first_call) {
-        printf("Performing point addition manually...\n");
-        first_call = 0;
-    }
-
-    // P-256 prime: p = 2^256 - 2^224 + 2^192 + 2^96 - 1
-    math_int_t p, temp1, temp2, temp3, lambda, x3, y3;
-
-    // Initialize temporary variables
-#if USE_SP_MATH
-    sp_init(&p); sp_init(&temp1); sp_init(&temp2); sp_init(&temp3);
-    sp_init(&lambda); sp_init(&x3); sp_init(&y3);
-
-    // Set P-256 prime
-    sp_read_radix(&p, "FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF", 16);
-#else
-    mp_init(&p); mp_init(&temp1); mp_init(&temp2); mp_init(&temp3);
-    mp_init(&lambda); mp_init(&x3); mp_init(&y3);
-
-    // Set P-256 prime
-    mp_read_radix(&p, "FFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF", 16);
-#endif
+// Affine point addition and doubling on P-256, using the context scratch
+static int ecc_point_add_custom(puf_verifier_ctx* ctx, EccPoint* result, EccPoint* a, EccPoint* b) {
+    // P-256 prime and temporaries live in the context, set up once
+    math_int_t *p = &ctx->prime;
+    math_int_t *temp1 = &ctx->temp1, *temp2 = &ctx->temp2, *temp3 = &ctx->temp3;
+    math_int_t *lambda = &ctx->lambda, *x3 = &ctx->x3, *y3 = &ctx->y3;
 
     // Check for point at infinity cases
 #if USE_SP_MATH
@@ -245,13 +262,13 @@ int ecc_point_add_custom(EccPoint* result, EccPoint* a, EccPoint* b, ecc_key* ke
         // a is point at infinity, result = b
         sp_copy(&b->x, &result->x);
         sp_copy(&b->y, &result->y);
-        goto cleanup_add;
+        return 0;
     }
     if (sp_iszero(&b->x) && sp_iszero(&b->y)) {
         // b is point at infinity, result = a
         sp_copy(&a->x, &result->x);
         sp_copy(&a->y, &result->y);
-        goto cleanup_add;
+        return 0;
     }
 
     // Check if points are the same (point doubling case)
@@ -261,77 +278,73 @@ int ecc_point_add_custom(EccPoint* result, EccPoint* a, EccPoint* b, ecc_key* ke
             // For P-256, a = -3, so 3*x1^2 + a = 3*x1^2 - 3
 
             // temp1 = x1^2
-            sp_sqr(&a->x, &temp1);
-            sp_mod(&temp1, &p, &temp1);
+            sp_sqr(&a->x, temp1);
+            sp_mod(temp1, p, temp1);
 
             // temp2 = 3*x1^2
-            sp_mul_d(&temp1, 3, &temp2);
-            sp_mod(&temp2, &p, &temp2);
+            sp_mul_d(temp1, 3, temp2);
+            sp_mod(temp2, p, temp2);
 
             // temp1 = 3*x1^2 - 3
-            sp_sub_d(&temp2, 3, &temp1);
-            sp_mod(&temp1, &p, &temp1);
+            sp_sub_d(temp2, 3, temp1);
+            sp_mod(temp1, p, temp1);
 
             // temp2 = 2*y1
-            sp_mul_d(&a->y, 2, &temp2);
-            sp_mod(&temp2, &p, &temp2);
+            sp_mul_d(&a->y, 2, temp2);
+            sp_mod(temp2, p, temp2);
 
             // lambda = (3*x1^2 - 3) / (2*y1) = temp1 * inv(temp2)
-            sp_invmod(&temp2, &p, &temp3);
-            sp_mulmod(&temp1, &temp3, &p, &lambda);
+            sp_invmod(temp2, p, temp3);
+            sp_mulmod(temp1, temp3, p, lambda);
         } else {
             // Points are inverses, result is point at infinity
             sp_zero(&result->x);
             sp_zero(&result->y);
-            goto cleanup_add;
+            return 0;
         }
     } else {
         // Regular point addition: lambda = (y2 - y1) / (x2 - x1)
 
         // temp1 = y2 - y1
-        sp_sub(&b->y, &a->y, &temp1);
-        sp_mod(&temp1, &p, &temp1);
+        sp_sub(&b->y, &a->y, temp1);
+        sp_mod(temp1, p, temp1);
 
         // temp2 = x2 - x1
-        sp_sub(&b->x, &a->x, &temp2);
-        sp_mod(&temp2, &p, &temp2);
+        sp_sub(&b->x, &a->x, temp2);
+        sp_mod(temp2, p, temp2);
 
         // lambda = (y2 - y1) / (x2 - x1) = temp1 * inv(temp2)
-        sp_invmod(&temp2, &p, &temp3);
-        sp_mulmod(&temp1, &temp3, &p, &lambda);
+        sp_invmod(temp2, p, temp3);
+        sp_mulmod(temp1, temp3, p, lambda);
     }
 
     // x3 = lambda^2 - x1 - x2
-    sp_sqr(&lambda, &x3);
-    sp_sub(&x3, &a->x, &x3);
-    sp_sub(&x3, &b->x, &x3);
-    sp_mod(&x3, &p, &x3);
+    sp_sqr(lambda, x3);
+    sp_sub(x3, &a->x, x3);
+    sp_sub(x3, &b->x, x3);
+    sp_mod(x3, p, x3);
 
     // y3 = lambda * (x1 - x3) - y1
-    sp_sub(&a->x, &x3, &temp1);
-    sp_mulmod(&lambda, &temp1, &p, &y3);
-    sp_sub(&y3, &a->y, &y3);
-    sp_mod(&y3, &p, &y3);
+    sp_sub(&a->x, x3, temp1);
+    sp_mulmod(lambda, temp1, p, y3);
+    sp_sub(y3, &a->y, y3);
+    sp_mod(y3, p, y3);
 
     // Copy result
-    sp_copy(&x3, &result->x);
-    sp_copy(&y3, &result->y);
-
-cleanup_add:
-    sp_clear(&p); sp_clear(&temp1); sp_clear(&temp2); sp_clear(&temp3);
-    sp_clear(&lambda); sp_clear(&x3); sp_clear(&y3);
+    sp_copy(x3, &result->x);
+    sp_copy(y3, &result->y);
 #else
     if (mp_iszero(&a->x) && mp_iszero(&a->y)) {
         // a is point at infinity, result = b
         mp_copy(&b->x, &result->x);
         mp_copy(&b->y, &result->y);
-        goto cleanup_add_mp;
+        return 0;
     }
     if (mp_iszero(&b->x) && mp_iszero(&b->y)) {
         // b is point at infinity, result = a
         mp_copy(&a->x, &result->x);
         mp_copy(&a->y, &result->y);
-        goto cleanup_add_mp;
+        return 0;
     }
 
     // Check if points are the same (point doubling case)
@@ -340,79 +353,68 @@ cleanup_add:
             // Point doubling: lambda = (3*x1^2 - 3) / (2*y1)
 
             // temp1 = x1^2
-            mp_sqr(&a->x, &temp1);
-            mp_mod(&temp1, &p, &temp1);
+            mp_sqr(&a->x, temp1);
+            mp_mod(temp1, p, temp1);
 
             // temp2 = 3*x1^2
-            mp_mul_d(&temp1, 3, &temp2);
-            mp_mod(&temp2, &p, &temp2);
+            mp_mul_d(temp1, 3, temp2);
+            mp_mod(temp2, p, temp2);
 
             // temp1 = 3*x1^2 - 3
-            mp_sub_d(&temp2, 3, &temp1);
-            mp_mod(&temp1, &p, &temp1);
+            mp_sub_d(temp2, 3, temp1);
+            mp_mod(temp1, p, temp1);
 
             // temp2 = 2*y1
-            mp_mul_d(&a->y, 2, &temp2);
-            mp_mod(&temp2, &p, &temp2);
+            mp_mul_d(&a->y, 2, temp2);
+            mp_mod(temp2, p, temp2);
 
             // lambda = (3*x1^2 - 3) / (2*y1) = temp1 * inv(temp2)
-            mp_invmod(&temp2, &p, &temp3);
-            mp_mulmod(&temp1, &temp3, &p, &lambda);
+            mp_invmod(temp2, p, temp3);
+            mp_mulmod(temp1, temp3, p, lambda);
         } else {
             // Points are inverses, result is point at infinity
             mp_zero(&result->x);
             mp_zero(&result->y);
-            goto cleanup_add_mp;
+            return 0;
         }
     } else {
         // Regular point addition: lambda = (y2 - y1) / (x2 - x1)
 
         // temp1 = y2 - y1
-        mp_sub(&b->y, &a->y, &temp1);
-        mp_mod(&temp1, &p, &temp1);
+        mp_sub(&b->y, &a->y, temp1);
+        mp_mod(temp1, p, temp1);
 
         // temp2 = x2 - x1
-        mp_sub(&b->x, &a->x, &temp2);
-        mp_mod(&temp2, &p, &temp2);
+        mp_sub(&b->x, &a->x, temp2);
+        mp_mod(temp2, p, temp2);
 
         // lambda = (y2 - y1) / (x2 - x1) = temp1 * inv(temp2)
-        mp_invmod(&temp2, &p, &temp3);
-        mp_mulmod(&temp1, &temp3, &p, &lambda);
+        mp_invmod(temp2, p, temp3);
+        mp_mulmod(temp1, temp3, p, lambda);
     }
 
     // x3 = lambda^2 - x1 - x2
-    mp_sqr(&lambda, &x3);
-    mp_sub(&x3, &a->x, &x3);
-    mp_sub(&x3, &b->x, &x3);
-    mp_mod(&x3, &p, &x3);
+    mp_sqr(lambda, x3);
+    mp_sub(x3, &a->x, x3);
+    mp_sub(x3, &b->x, x3);
+    mp_mod(x3, p, x3);
 
     // y3 = lambda * (x1 - x3) - y1
-    mp_sub(&a->x, &x3, &temp1);
-    mp_mulmod(&lambda, &temp1, &p, &y3);
-    mp_sub(&y3, &a->y, &y3);
-    mp_mod(&y3, &p, &y3);
+    mp_sub(&a->x, x3, temp1);
+    mp_mulmod(lambda, temp1, p, y3);
+    mp_sub(y3, &a->y, y3);
+    mp_mod(y3, p, y3);
 
     // Copy result
-    mp_copy(&x3, &result->x);
-    mp_copy(&y3, &result->y);
-
-cleanup_add_mp:
-    mp_clear(&p); mp_clear(&temp1); mp_clear(&temp2); mp_clear(&temp3);
-    mp_clear(&lambda); mp_clear(&x3); mp_clear(&y3);
+    mp_copy(x3, &result->x);
+    mp_copy(y3, &result->y);
 #endif
 
     return 0;
 }
 
 // ECC scalar multiplication using double-and-add algorithm
-int ecc_point_mul_custom(EccPoint* result, math_int_t* scalar, EccPoint* point, ecc_key* key) {
-    // Remove verbose output - only print on first call per operation
-    static int first_call = 1;
-    if (first_call) {
-        printf("Performing scalar multiplication using double-and-add...\n");
-        first_call = 0;
-    }
-
+static int ecc_point_mul_custom(puf_verifier_ctx* ctx, EccPoint* result, math_int_t* scalar, EccPoint* point) {
     // Check if scalar is zero
 #if USE_SP_MATH
     if (sp_iszero(scalar)) {
@@ -431,18 +433,15 @@ int ecc_point_mul_custom(EccPoint* result, math_int_t* scalar, EccPoint* point,
 #endif
 
     // Initialize result to point at infinity
-    EccPoint temp_result, temp_point;
-    if (init_ecc_point(&temp_result) < 0 || init_ecc_point(&temp_point) < 0) {
-        return -1;
-    }
+    EccPoint *temp_result = &ctx->mul_result, *temp_point = &ctx->mul_point;
 
 #if USE_SP_MATH
-    sp_zero(&temp_result.x);
-    sp_zero(&temp_result.y);
+    sp_zero(&temp_result->x);
+    sp_zero(&temp_result->y);
 
     // Copy input point
-    sp_copy(&point->x, &temp_point.x);
-    sp_copy(&point->y, &temp_point.y);
+    sp_copy(&point->x, &temp_point->x);
+    sp_copy(&point->y, &temp_point->y);
 
     // Get number of bits in scalar
     int bits = sp_count_bits(scalar);
@@ -451,32 +450,26 @@ int ecc_point_mul_custom(EccPoint* result, math_int_t* scalar, EccPoint* point,
     for (int i = bits - 1; i >= 0; i--) {
         // Double the current result (except on first iteration)
         if (i < bits - 1) {
-            int ret = ecc_point_add_custom(&temp_result, &temp_result, &temp_result, key);
-            if (ret != 0) {
-                free_ecc_point(&temp_result);
-                free_ecc_point(&temp_point);
+            int ret = ecc_point_add_custom(ctx, temp_result, temp_result, temp_result);
+            if (ret != 0)
                 return ret;
-            }
         }
 
         // Check if bit i is set (add point if bit is 1)
         if (test_bit(scalar, i)) {
             // Add input point to result
-            int ret = ecc_point_add_custom(&temp_result, &temp_result, &temp_point, key);
-            if (ret != 0) {
-                free_ecc_point(&temp_result);
-                free_ecc_point(&temp_point);
+            int ret = ecc_point_add_custom(ctx, temp_result, temp_result, temp_point);
+            if (ret != 0)
                 return ret;
-            }
         }
     }
 #else
-    mp_zero(&temp_result.x);
-    mp_zero(&temp_result.y);
+    mp_zero(&temp_result->x);
+    mp_zero(&temp_result->y);
 
     // Copy input point
-    mp_copy(&point->x, &temp_point.x);
-    mp_copy(&point->y, &temp_point.y);
+    mp_copy(&point->x, &temp_point->x);
+    mp_copy(&point->y, &temp_point->y);
 
     // Get number of bits in scalar
     int bits = mp_count_bits(scalar);
@@ -485,44 +478,97 @@ int ecc_point_mul_custom(EccPoint* result, math_int_t* scalar, EccPoint* point,
     for (int i = bits - 1; i >= 0; i--) {
         // Double the current result (except on first iteration)
         if (i < bits - 1) {
-            int ret = ecc_point_add_custom(&temp_result, &temp_result, &temp_result, key);
-            if (ret != 0) {
-                free_ecc_point(&temp_result);
-                free_ecc_point(&temp_point);
+            int ret = ecc_point_add_custom(ctx, temp_result, temp_result, temp_result);
+            if (ret != 0)
                 return ret;
-            }
         }
 
         // Check if bit i is set (add point if bit is 1)
         if (test_bit(scalar, i)) {
             // Add input point to result
-            int ret = ecc_point_add_custom(&temp_result, &temp_result, &temp_point, key);
-            if (ret != 0) {
-                free_ecc_point(&temp_result);
-                free_ecc_point(&temp_point);
+            int ret = ecc_point_add_custom(ctx, temp_result, temp_result, temp_point);
+            if (ret != 0)
                 return ret;
-            }
         }
     }
 #endif
 
     // Copy result
 #if USE_SP_MATH
-    sp_copy(&temp_result.x, &result->x);
-    sp_copy(&temp_result.y, &result->y);
+    sp_copy(&temp_result->x, &result->x);
+    sp_copy(&temp_result->y, &result->y);
+#else
+    mp_copy(&temp_result->x, &result->x);
+    mp_copy(&temp_result->y, &result->y);
+#endif
+
+    return 0;
+}
+
+// ECC scalar multiplication through wolfCrypt, which uses the SP math
+// optimized P-256 code when it is built in
+static int ecc_point_mul_wolfcrypt(puf_verifier_ctx* ctx, EccPoint* result, math_int_t* scalar, EccPoint* point) {
+    int ret;
+
+    // wc_ecc_mulmod() expects k < n, every point on P-256 has order n
+#if USE_SP_MATH
+    ret = sp_mod(scalar, &ctx->order, &ctx->reduced);
+    if (ret != MP_OKAY)
+        return ret;
+
+    if (sp_iszero(&ctx->reduced) || is_infinity(point)) {
+        set_infinity(result);
+        return 0;
+    }
+
+    sp_copy(&point->x, ctx->wc_base->x);
+    sp_copy(&point->y, ctx->wc_base->y);
+    sp_set(ctx->wc_base->z, 1);
 #else
-    mp_copy(&temp_result.x, &result->x);
-    mp_copy(&temp_result.y, &result->y);
+    ret = mp_mod(scalar, &ctx->order, &ctx->reduced);
+    if (ret != MP_OKAY)
+        return ret;
+
+    if (mp_iszero(&ctx->reduced) || is_infinity(point)) {
+        set_infinity(result);
+        return 0;
+    }
+
+    mp_copy(&point->x, ctx->wc_base->x);
+    mp_copy(&point->y, ctx->wc_base->y);
+    mp_set(ctx->wc_base->z, 1);
 #endif
 
-    free_ecc_point(&temp_result);
-    free_ecc_point(&temp_point);
+    ret = wc_ecc_mulmod(&ctx->reduced, ctx->wc_base, ctx->wc_result,
+                        &ctx->curve_a, &ctx->prime, 1);
+    if (ret != 0)
+        return ret;
+
+    if (wc_ecc_point_is_at_infinity(ctx->wc_result)) {
+        set_infinity(result);
+        return 0;
+    }
+
+#if USE_SP_MATH
+    sp_copy(ctx->wc_result->x, &result->x);
+    sp_copy(ctx->wc_result->y, &result->y);
+#else
+    mp_copy(ctx->wc_result->x, &result->x);
+    mp_copy(ctx->wc_result->y, &result->y);
+#endif
 
     return 0;
 }
 
+// Scalar multiplication with the backend selected in ctx
+static int ecc_point_mul(puf_verifier_ctx* ctx, EccPoint* result, math_int_t* scalar, EccPoint* point) {
+    if (ctx->backend == PUF_BACKEND_WOLFCRYPT)
+        return ecc_point_mul_wolfcrypt(ctx, result, scalar, point);
+    return ecc_point_mul_custom(ctx, result, scalar, point);
+}
+
 // Compare two ECC points for equality
-int ecc_points_equal(EccPoint* a, EccPoint* b) {
+static int ecc_points_equal(EccPoint* a, EccPoint* b) {
 #if USE_SP_MATH
     return (sp_cmp(&a->x, &b->x) == MP_EQ && sp_cmp(&a->y, &b->y) == MP_EQ);
 #else
@@ -530,175 +576,275 @@ int ecc_points_equal(EccPoint* a, EccPoint* b) {
 #endif
 }
 
-int verify_zk_proof(Args* args) {
-    int ret = 0;
-    ecc_key key;
-    EccPoint g, h, COM, P;
-    math_int_t nonce, v, w, alpha;
-    wc_Sha256 sha;
-    byte hash[WC_SHA256_DIGEST_SIZE];
-    byte preimage[PREIMAGE_BYTES];
+puf_verifier_ctx *puf_verifier_ctx_new(void) {
+    puf_verifier_ctx *ctx = calloc(1, sizeof(*ctx));
+    int ret;
 
-#if STANDALONE
-    printf("\n=== Zero Knowledge Verifier Proof Tool (CLI Mode) ===\n\n");
-#else
-    printf("=== Attempting to verify PUF! ===\n");
-#endif
+    if (!ctx) {
+        printf("Error allocating verifier context\n");
+        return NULL;
+    }
 
-    // Step 1: Initialize P-256 curve
-    printf("Step 1: Initialize secp256r1 curve (P-256)...\n");
-    printf("Math backend: %s\n", USE_SP_MATH ? "SP Math" : "mp_int");
+    ctx->verbose = 1;
+    ctx->backend = DEFAULT_BACKEND;
 
-    ret = wc_ecc_init(&key);
+    ret = wc_ecc_init(&ctx->key);
     if (ret != 0) {
         printf("Error initializing ECC key: %d\n", ret);
-        return ret;
+        free(ctx);
+        return NULL;
     }
 
-    ret = wc_ecc_set_curve(&key, 32, ECC_SECP256R1);
+    ret = wc_ecc_set_curve(&ctx->key, 32, ECC_SECP256R1);
     if (ret != 0) {
         printf("Error setting P-256 curve: %d\n", ret);
-        wc_ecc_free(&key);
-        return ret;
-    }
-    printf("Curve initialized: y^2 = x^3 + ax + b\n\n");
-
-    // Initialize points and scalars
-    if (init_ecc_point(&g) < 0 || init_ecc_point(&h) < 0 ||
-        init_ecc_point(&COM) < 0 || init_ecc_point(&P) < 0) {
-        printf("Error initializing ECC points\n");
-        ret = -1;
-        goto cleanup;
+        goto error;
     }
 
-#if USE_SP_MATH
-    if (sp_init(&nonce) != MP_OKAY || sp_init(&v) != MP_OKAY ||
-        sp_init(&w) != MP_OKAY || sp_init(&alpha) != MP_OKAY) {
-        printf("Error initializing sp_int variables\n");
-        ret = -1;
-        goto cleanup;
+    ret = wc_InitRng(&ctx->rng);
+    if (ret != 0) {
+        printf("Error initializing RNG: %d\n", ret);
+        goto error;
     }
-#else
-    if (mp_init(&nonce) != MP_OKAY || mp_init(&v) != MP_OKAY ||
-        mp_init(&w) != MP_OKAY || mp_init(&alpha) != MP_OKAY) {
-        printf("Error initializing mp_int variables\n");
-        ret = -1;
-        goto cleanup;
+    ctx->rng_ready = 1;
+
+    if (init_math_int(&ctx->prime) < 0 || init_math_int(&ctx->curve_a) < 0 ||
+        init_math_int(&ctx->curve_b) < 0 || init_math_int(&ctx->order) < 0 ||
+        init_ecc_point(&ctx->g) < 0 || init_ecc_point(&ctx->h) < 0 ||
+        init_ecc_point(&ctx->COM) < 0 || init_ecc_point(&ctx->P) < 0 ||
+        init_math_int(&ctx->v) < 0 || init_math_int(&ctx->w) < 0 ||
+        init_math_int(&ctx->alpha) < 0 ||
+        init_ecc_point(&ctx->vg) < 0 || init_ecc_point(&ctx->wh) < 0 ||
+        init_ecc_point(&ctx->left_side) < 0 || init_ecc_point(&ctx->alpha_COM) < 0 ||
+        init_ecc_point(&ctx->right_side) < 0 ||
+        init_math_int(&ctx->temp1) < 0 || init_math_int(&ctx->temp2) < 0 ||
+        init_math_int(&ctx->temp3) < 0 || init_math_int(&ctx->lambda) < 0 ||
+        init_math_int(&ctx->x3) < 0 || init_math_int(&ctx->y3) < 0 ||
+        init_ecc_point(&ctx->mul_result) < 0 || init_ecc_point(&ctx->mul_point) < 0 ||
+        init_math_int(&ctx->weight) < 0 || init_math_int(&ctx->reduced) < 0 ||
+        init_math_int(&ctx->sqrt_exp) < 0) {
+        printf("Error initializing verifier scratch storage\n");
+        goto error;
     }
-#endif
 
-    // CLI mode - parse from arguments
-    printf("=== CLI Mode ===\n\n");
+    ctx->wc_base = wc_ecc_new_point();
+    ctx->wc_result = wc_ecc_new_point();
+    if (!ctx->wc_base || !ctx->wc_result) {
+        printf("Error allocating wolfCrypt points\n");
+        goto error;
+    }
 
-    if (!args->gx || !args->gy || !args->hx || !args->hy ||
-        !args->COMx || !args->COMy || !args->Px || !args->Py ||
-        !args->nonce || !args->v || !args->w) {
-        printf("Error: All parameters required in CLI mode\n");
-        ret = -1;
-        goto cleanup;
+    // P-256 prime: p = 2^256 - 2^224 + 2^192 + 2^96 - 1, a = p - 3,
+    // b and the group order n
+    if (parse_hex_to_math("0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF",
+                          &ctx->prime) != MP_OKAY ||
+        parse_hex_to_math("0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFC",
+                          &ctx->curve_a) != MP_OKAY ||
+        parse_hex_to_math("0x5AC635D8AA3A93E7B3EBBD55769886BC651D06B0CC53B0F63BCE3C3E27D2604B",
+                          &ctx->curve_b) != MP_OKAY ||
+        parse_hex_to_math("0xFFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551",
+                          &ctx->order) != MP_OKAY ||
+        parse_hex_to_math("0x3FFFFFFFC0000000400000000000000000000000400000000000000000000000",
+                          &ctx->sqrt_exp) != MP_OKAY) {
+        printf("Error setting P-256 curve parameters\n");
+        goto error;
     }
 
-    printf("Step 2: Parsing base points g and h\n");
-    parse_hex_to_math(args->gx, &g.x);
-    parse_hex_to_math(args->gy, &g.y);
-    print_ecc_point("g", &g);
+    return ctx;
+
+error:
+    puf_verifier_ctx_free(ctx);
+    return NULL;
+}
 
-    parse_hex_to_math(args->hx, &h.x);
-    parse_hex_to_math(args->hy, &h.y);
-    print_ecc_point("h", &h);
+void puf_verifier_ctx_free(puf_verifier_ctx *ctx) {
+    if (!ctx)
+        return;
+
+    free_math_int(&ctx->prime);
+    free_math_int(&ctx->curve_a);
+    free_math_int(&ctx->curve_b);
+    free_math_int(&ctx->order);
+    free_ecc_point(&ctx->g);
+    free_ecc_point(&ctx->h);
+    free_ecc_point(&ctx->COM);
+    free_ecc_point(&ctx->P);
+    free_math_int(&ctx->v);
+    free_math_int(&ctx->w);
+    free_math_int(&ctx->alpha);
+    free_ecc_point(&ctx->vg);
+    free_ecc_point(&ctx->wh);
+    free_ecc_point(&ctx->left_side);
+    free_ecc_point(&ctx->alpha_COM);
+    free_ecc_point(&ctx->right_side);
+    free_math_int(&ctx->temp1);
+    free_math_int(&ctx->temp2);
+    free_math_int(&ctx->temp3);
+    free_math_int(&ctx->lambda);
+    free_math_int(&ctx->x3);
+    free_math_int(&ctx->y3);
+    free_ecc_point(&ctx->mul_result);
+    free_ecc_point(&ctx->mul_point);
+    free_math_int(&ctx->weight);
+    free_math_int(&ctx->reduced);
+    free_math_int(&ctx->sqrt_exp);
+    wc_ecc_del_point(ctx->wc_base);
+    wc_ecc_del_point(ctx->wc_result);
+    if (ctx->rng_ready)
+        wc_FreeRng(&ctx->rng);
+    wc_ecc_free(&ctx->key);
+    free(ctx);
+}
 
-    printf("\nStep 3: Parsing COM commitment\n");
-    parse_hex_to_math(args->COMx, &COM.x);
-    parse_hex_to_math(args->COMy, &COM.y);
-    print_ecc_point("COM", &COM);
+void puf_verifier_ctx_set_verbose(puf_verifier_ctx* ctx, int verbose) {
+    ctx->verbose = verbose;
+}
 
-    printf("\nStep 4: Parsing nonce\n");
-    parse_hex_to_math(args->nonce, &nonce);
-    print_scalar("nonce", &nonce);
+int puf_verifier_ctx_set_backend(puf_verifier_ctx* ctx, puf_backend_t backend) {
+    if (backend != PUF_BACKEND_CUSTOM && backend != PUF_BACKEND_WOLFCRYPT)
+        return -1;
 
-    printf("\nStep 5: Parsing P commitment\n");
-    parse_hex_to_math(args->Px, &P.x);
-    parse_hex_to_math(args->Py, &P.y);
-    print_ecc_point("P", &P);
+    ctx->backend = backend;
+    return 0;
+}
 
-    printf("\nStep 6: Parsing scalars v and w\n");
-    parse_hex_to_math(args->v, &v);
-    parse_hex_to_math(args->w, &w);
-    print_scalar("v", &v);
-    print_scalar("w", &w);
+const char* puf_backend_name(puf_backend_t backend) {
+    switch (backend) {
+    case PUF_BACKEND_CUSTOM:    return "custom";
+    case PUF_BACKEND_WOLFCRYPT: return "wolfcrypt";
+    }
+    return "unknown";
+}
 
+void puf_proof_view(const puf_proof_buf_t *buf, puf_proof_t *proof) {
+    proof->gx = buf->gx;
+    proof->gy = buf->gy;
+    proof->hx = buf->hx;
+    proof->hy = buf->hy;
+    proof->COMx = buf->COMx;
+    proof->COMy = buf->COMy;
+    proof->Px = buf->Px;
+    proof->Py = buf->Py;
+    proof->v = buf->v;
+    proof->w = buf->w;
+    proof->nonce = buf->nonce;
+}
 
-    // Step 7: Reconstruct raw 64-byte P = P.x || P.y
-    printf("\nStep 7: Reconstruct raw P.x||P.y as hex\n");
+void puf_proof_copy(puf_proof_buf_t *buf, const puf_proof_t *proof) {
+    memcpy(buf->gx, proof->gx, COORDINATE_BYTES);
+    memcpy(buf->gy, proof->gy, COORDINATE_BYTES);
+    memcpy(buf->hx, proof->hx, COORDINATE_BYTES);
+    memcpy(buf->hy, proof->hy, COORDINATE_BYTES);
+    memcpy(buf->COMx, proof->COMx, COORDINATE_BYTES);
+    memcpy(buf->COMy, proof->COMy, COORDINATE_BYTES);
+    memcpy(buf->Px, proof->Px, COORDINATE_BYTES);
+    memcpy(buf->Py, proof->Py, COORDINATE_BYTES);
+    memcpy(buf->v, proof->v, SCALAR_BYTES);
+    memcpy(buf->w, proof->w, SCALAR_BYTES);
+    memcpy(buf->nonce, proof->nonce, NONCE_BYTES);
+}
 
-    // Convert P coordinates to bytes (32 bytes each, big-endian)
-    byte px_bytes[COORDINATE_BYTES], py_bytes[COORDINATE_BYTES];
+// Load big-endian unsigned bytes into a big integer
+static int load_math_int(math_int_t* num, const uint8_t* data, int len) {
 #if USE_SP_MATH
-    sp_to_unsigned_bin_len(&P.x, px_bytes, COORDINATE_BYTES);
-    sp_to_unsigned_bin_len(&P.y, py_bytes, COORDINATE_BYTES);
+    return sp_read_unsigned_bin(num, data, len) == MP_OKAY ? 0 : -1;
 #else
-    mp_to_unsigned_bin_len(&P.x, px_bytes, COORDINATE_BYTES);
-    mp_to_unsigned_bin_len(&P.y, py_bytes, COORDINATE_BYTES);
+    return mp_read_unsigned_bin(num, data, len) == MP_OKAY ? 0 : -1;
 #endif
+}
 
-    // Copy to preimage buffer
-    memcpy(preimage, px_bytes, COORDINATE_BYTES);
-    memcpy(preimage + COORDINATE_BYTES, py_bytes, COORDINATE_BYTES);
-
-    printf("P (hex) = ");
-    for (int i = 0; i < 2 * COORDINATE_BYTES; i++) {
-        printf("%02X", preimage[i]);
-    }
-    printf("\n");
-
-    // Step 8: Reconstruct raw 64-byte nonce
-    printf("\nStep 8: Reconstruct raw 64-byte nonce as hex\n");
-
-    byte nonce_bytes[NONCE_BYTES];
-
-    // Get the actual nonce size and copy to the right position
-    int nonce_actual_size;
+// Store a big integer as len big-endian bytes, left padded with zeros
+static int store_math_int(math_int_t* num, uint8_t* data, int len) {
 #if USE_SP_MATH
-    nonce_actual_size = sp_unsigned_bin_size(&nonce);
-    // Place nonce at the end (right-aligned in 16 bytes)
-    sp_to_unsigned_bin(&nonce, nonce_bytes);
+    return sp_to_unsigned_bin_len(num, data, len) == MP_OKAY ? 0 : -1;
 #else
-    nonce_actual_size = mp_unsigned_bin_size(&nonce);
-    // Place nonce at the end (right-aligned in 16 bytes)
-    mp_to_unsigned_bin(&nonce, nonce_bytes);
+    return mp_to_unsigned_bin_len(num, data, len) == MP_OKAY ? 0 : -1;
 #endif
+}
 
-    if (nonce_actual_size != NONCE_BYTES) {
-        fprintf(stderr, "Nonce size mismatch: expected 64, got %d\n", nonce_actual_size);
-        goto cleanup;
+int verify_proof(puf_verifier_ctx* ctx, const puf_proof_t* proof) {
+    int ret = 0;
+    EccPoint *g = &ctx->g, *h = &ctx->h, *COM = &ctx->COM, *P = &ctx->P;
+    math_int_t *v = &ctx->v, *w = &ctx->w, *alpha = &ctx->alpha;
+    EccPoint *vg = &ctx->vg, *wh = &ctx->wh, *left_side = &ctx->left_side;
+    EccPoint *alpha_COM = &ctx->alpha_COM, *right_side = &ctx->right_side;
+    wc_Sha256 sha;
+    byte hash[WC_SHA256_DIGEST_SIZE];
+
+    // Step 1: The P-256 curve and all scratch storage are owned by ctx
+    VERBOSE(ctx, "Step 1: Using secp256r1 curve (P-256) from verifier context...\n");
+    VERBOSE(ctx, "Math backend: %s\n", USE_SP_MATH ? "SP Math" : "mp_int");
+    VERBOSE(ctx, "Point backend: %s\n\n", puf_backend_name(ctx->backend));
+
+    if (!proof->gx || !proof->gy || !proof->hx || !proof->hy ||
+        !proof->COMx || !proof->COMy || !proof->Px || !proof->Py ||
+        !proof->nonce || !proof->v || !proof->w) {
+        printf("Error: All proof portions are required\n");
+        return -1;
     }
 
-    memcpy(preimage + 2 * COORDINATE_BYTES, nonce_bytes, NONCE_BYTES);
+    VERBOSE(ctx, "Step 2: Loading base points g and h\n");
+    if (load_math_int(&g->x, proof->gx, COORDINATE_BYTES) < 0 ||
+        load_math_int(&g->y, proof->gy, COORDINATE_BYTES) < 0 ||
+        load_math_int(&h->x, proof->hx, COORDINATE_BYTES) < 0 ||
+        load_math_int(&h->y, proof->hy, COORDINATE_BYTES) < 0) {
+        printf("Error loading base points\n");
+        return -1;
+    }
+    if (!ecc_point_on_curve(ctx, g) || !ecc_point_on_curve(ctx, h)) {
+        printf("Error: Base points are not on P-256\n");
+        return -1;
+    }
+    if (ctx->verbose) print_ecc_point("g", g);
+    if (ctx->verbose) print_ecc_point("h", h);
 
-    printf("n (hex) = ");
-    for (int i = 0; i < NONCE_BYTES; i++) {
-        printf("%02X", nonce_bytes[i]);
+    VERBOSE(ctx, "\nStep 3: Loading COM commitment\n");
+    if (load_math_int(&COM->x, proof->COMx, COORDINATE_BYTES) < 0 ||
+        load_math_int(&COM->y, proof->COMy, COORDINATE_BYTES) < 0) {
+        printf("Error loading COM commitment\n");
+        return -1;
     }
-    printf("\n");
-    printf("Nonce actual size: %d bytes\n", nonce_actual_size);
+    if (!ecc_point_on_curve(ctx, COM)) {
+        printf("Error: COM commitment is not on P-256\n");
+        return -1;
+    }
+    if (ctx->verbose) print_ecc_point("COM", COM);
 
-    // Step 9: Build 80-byte preimage P||n
-    printf("\nStep 9: Preimage (P || nonce) as hex:\n");
-    for (int i = 0; i < PREIMAGE_BYTES; i++) {
-        printf("%02X", preimage[i]);
+    VERBOSE(ctx, "\nStep 4: Loading P commitment\n");
+    if (load_math_int(&P->x, proof->Px, COORDINATE_BYTES) < 0 ||
+        load_math_int(&P->y, proof->Py, COORDINATE_BYTES) < 0) {
+        printf("Error loading P commitment\n");
+        return -1;
     }
-    printf("\n");
+    if (!ecc_point_on_curve(ctx, P)) {
+        printf("Error: P commitment is not on P-256\n");
+        return -1;
+    }
+    if (ctx->verbose) print_ecc_point("P", P);
 
-    // Step 10: Compute α = H(P, n)
-    printf("\nStep 10: Compute α = H(P, n)\n");
+    VERBOSE(ctx, "\nStep 5: Loading scalars v and w\n");
+    if (load_math_int(v, proof->v, SCALAR_BYTES) < 0 ||
+        load_math_int(w, proof->w, SCALAR_BYTES) < 0) {
+        printf("Error loading scalars\n");
+        return -1;
+    }
+    if (ctx->verbose) print_scalar("v", v);
+    if (ctx->verbose) print_scalar("w", w);
+
+    // Step 6: Compute α = H(P.x || P.y || n) straight from the raw portions
+    VERBOSE(ctx, "\nStep 6: Compute α = H(P, n)\n");
 
     ret = wc_InitSha256(&sha);
     if (ret != 0) {
         printf("Error initializing SHA-256: %d\n", ret);
-        goto cleanup;
+        return ret;
     }
 
-    ret = wc_Sha256Update(&sha, preimage, PREIMAGE_BYTES);
+    ret = wc_Sha256Update(&sha, proof->Px, COORDINATE_BYTES);
+    if (ret == 0)
+        ret = wc_Sha256Update(&sha, proof->Py, COORDINATE_BYTES);
+    if (ret == 0)
+        ret = wc_Sha256Update(&sha, proof->nonce, NONCE_BYTES);
     if (ret != 0) {
         printf("Error updating SHA-256: %d\n", ret);
         goto cleanup;
@@ -710,127 +856,549 @@ int verify_zk_proof(Args* args) {
         goto cleanup;
     }
 
-    printf("α (as hex) = ");
-    for (int i = 0; i < WC_SHA256_DIGEST_SIZE; i++) {
-        printf("%02X", hash[i]);
+    if (ctx->verbose) {
+        printf("α (as hex) = ");
+        for (int i = 0; i < WC_SHA256_DIGEST_SIZE; i++) {
+            printf("%02X", hash[i]);
+        }
+        printf("\n");
     }
-    printf("\n");
 
     // Convert hash to math_int_t
-#if USE_SP_MATH
-    sp_read_unsigned_bin(&alpha, hash, WC_SHA256_DIGEST_SIZE);
-#else
-    mp_read_unsigned_bin(&alpha, hash, WC_SHA256_DIGEST_SIZE);
-#endif
-
-    // Step 11: Verify proof g^v*h^w = P*COM^α
-    printf("\nStep 11: Check if g^v*h^w = P*COM^α\n");
-
-    EccPoint vg, wh, left_side, alpha_COM, right_side;
-
-    // Initialize temporary points
-    if (init_ecc_point(&vg) < 0 || init_ecc_point(&wh) < 0 ||
-        init_ecc_point(&left_side) < 0 || init_ecc_point(&alpha_COM) < 0 ||
-        init_ecc_point(&right_side) < 0) {
-        printf("Error initializing temporary ECC points\n");
+    if (load_math_int(alpha, hash, WC_SHA256_DIGEST_SIZE) < 0) {
+        printf("Error loading α\n");
         ret = -1;
         goto cleanup;
     }
 
+    // Step 7: Verify proof g^v*h^w = P*COM^α
+    VERBOSE(ctx, "\nStep 7: Check if g^v*h^w = P*COM^α\n");
+
     // Left side: g^v * h^w = (v*g) + (w*h)
-    printf("Computing left side: g^v * h^w\n");
+    VERBOSE(ctx, "Computing left side: g^v * h^w\n");
 
     // Compute v*g
-    printf("Computing v*g...\n");
-    ret = ecc_point_mul_custom(&vg, &v, &g, &key);
+    VERBOSE(ctx, "Computing v*g...\n");
+    ret = ecc_point_mul(ctx, vg, v, g);
     if (ret != 0) {
         printf("Error computing v*g: %d\n", ret);
-        goto step11_cleanup;
+        goto cleanup;
     }
-    print_ecc_point("v*g", &vg);
+    if (ctx->verbose) print_ecc_point("v*g", vg);
 
     // Compute w*h
-    printf("Computing w*h...\n");
-    ret = ecc_point_mul_custom(&wh, &w, &h, &key);
+    VERBOSE(ctx, "Computing w*h...\n");
+    ret = ecc_point_mul(ctx, wh, w, h);
     if (ret != 0) {
         printf("Error computing w*h: %d\n", ret);
-        goto step11_cleanup;
+        goto cleanup;
     }
-    print_ecc_point("w*h", &wh);
+    if (ctx->verbose) print_ecc_point("w*h", wh);
 
     // Compute (v*g) + (w*h)
-    printf("Computing (v*g) + (w*h)...\n");
-    ret = ecc_point_add_custom(&left_side, &vg, &wh, &key);
+    VERBOSE(ctx, "Computing (v*g) + (w*h)...\n");
+    ret = ecc_point_add_custom(ctx, left_side, vg, wh);
     if (ret != 0) {
         printf("Error computing (v*g) + (w*h): %d\n", ret);
-        goto step11_cleanup;
+        goto cleanup;
     }
-    print_ecc_point("g^v * h^w", &left_side);
+    if (ctx->verbose) print_ecc_point("g^v * h^w", left_side);
 
     // Right side: P * COM^α = P + α*COM
-    printf("Computing right side: P * COM^α\n");
+    VERBOSE(ctx, "Computing right side: P * COM^α\n");
 
     // Compute α*COM
-    printf("Computing α*COM...\n");
-    ret = ecc_point_mul_custom(&alpha_COM, &alpha, &COM, &key);
+    VERBOSE(ctx, "Computing α*COM...\n");
+    ret = ecc_point_mul(ctx, alpha_COM, alpha, COM);
     if (ret != 0) {
         printf("Error computing α*COM: %d\n", ret);
-        goto step11_cleanup;
+        goto cleanup;
     }
-    print_ecc_point("α*COM", &alpha_COM);
+    if (ctx->verbose) print_ecc_point("α*COM", alpha_COM);
 
     // Compute P + α*COM
-    printf("Computing P + α*COM...\n");
-    ret = ecc_point_add_custom(&right_side, &P, &alpha_COM, &key);
+    VERBOSE(ctx, "Computing P + α*COM...\n");
+    ret = ecc_point_add_custom(ctx, right_side, P, alpha_COM);
     if (ret != 0) {
         printf("Error computing P + α*COM: %d\n", ret);
-        goto step11_cleanup;
+        goto cleanup;
     }
-    print_ecc_point("P * COM^α", &right_side);
+    if (ctx->verbose) print_ecc_point("P * COM^α", right_side);
 
     // Check equality
-    printf("Comparing points for equality...\n");
-    if (ecc_points_equal(&left_side, &right_side)) {
-        printf("✅ Proof verifies: g^v·h^w = P·COM^α\n");
+    VERBOSE(ctx, "Comparing points for equality...\n");
+    if (ecc_points_equal(left_side, right_side)) {
+        VERBOSE(ctx, "✅ Proof verifies: g^v·h^w = P·COM^α\n");
         ret = 0;
     } else {
-        printf("❌ Proof FAILED: g^v·h^w ≠ P·COM^α\n");
+        VERBOSE(ctx, "❌ Proof FAILED: g^v·h^w ≠ P·COM^α\n");
         ret = -1;
     }
 
-step11_cleanup:
-    // Clean up temporary points
-    free_ecc_point(&vg);
-    free_ecc_point(&wh);
-    free_ecc_point(&left_side);
-    free_ecc_point(&alpha_COM);
-    free_ecc_point(&right_side);
+cleanup:
+    wc_Sha256Free(&sha);
+    VERBOSE(ctx, "Computation complete\n");
 
-    printf("Computation complete\n");
+    return ret;
+}
 
-cleanup:
-    // Clean up
-    free_ecc_point(&g);
-    free_ecc_point(&h);
-    free_ecc_point(&COM);
-    free_ecc_point(&P);
+/* Batch verification */
+
+// Each proof contributes r*v*g + r*w*h - r*P - r*α*COM to the combination
+#define BATCH_TERMS_PER_PROOF 4
+#define BATCH_WEIGHT_BYTES 16
+#define BATCH_MAX_WINDOW 8
+#define ORDER_BITS 256
+
+typedef struct {
+    EccPoint point;
+    math_int_t scalar;
+} MsmTerm;
+
+// Set point to the (0, 0) encoding of the point at infinity
+static void set_infinity(EccPoint* point) {
+#if USE_SP_MATH
+    sp_zero(&point->x);
+    sp_zero(&point->y);
+#else
+    mp_zero(&point->x);
+    mp_zero(&point->y);
+#endif
+}
+
+static int is_infinity(EccPoint* point) {
+#if USE_SP_MATH
+    return sp_iszero(&point->x) && sp_iszero(&point->y);
+#else
+    return mp_iszero(&point->x) && mp_iszero(&point->y);
+#endif
+}
+
+// Check y^2 = x^3 + ax + b (mod p) with coordinates below p
+static int ecc_point_on_curve(puf_verifier_ctx* ctx, EccPoint* point) {
+    math_int_t *p = &ctx->prime, *lhs = &ctx->temp1, *rhs = &ctx->temp2;
+
+#if USE_SP_MATH
+    if (sp_cmp(&point->x, p) != MP_LT || sp_cmp(&point->y, p) != MP_LT)
+        return 0;
+
+    sp_sqrmod(&point->y, p, lhs);               // y^2
+    sp_sqrmod(&point->x, p, rhs);               // x^2
+    sp_add(rhs, &ctx->curve_a, rhs);            // x^2 + a
+    sp_mulmod(rhs, &point->x, p, rhs);          // x^3 + ax
+    sp_addmod(rhs, &ctx->curve_b, p, rhs);      // x^3 + ax + b
+    return sp_cmp(lhs, rhs) == MP_EQ;
+#else
+    if (mp_cmp(&point->x, p) != MP_LT || mp_cmp(&point->y, p) != MP_LT)
+        return 0;
+
+    mp_sqrmod(&point->y, p, lhs);               // y^2
+    mp_sqrmod(&point->x, p, rhs);               // x^2
+    mp_add(rhs, &ctx->curve_a, rhs);            // x^2 + a
+    mp_mulmod(rhs, &point->x, p, rhs);          // x^3 + ax
+    mp_addmod(rhs, &ctx->curve_b, p, rhs);      // x^3 + ax + b
+    return mp_cmp(lhs, rhs) == MP_EQ;
+#endif
+}
+
+int puf_point_decompress(puf_verifier_ctx* ctx, const uint8_t* in, uint8_t* x, uint8_t* y) {
+    EccPoint* point = &ctx->mul_point;
+    math_int_t *p = &ctx->prime, *rhs = &ctx->temp3;
+
+    if (in[0] != 0x02 && in[0] != 0x03)
+        return -1;
+    if (load_math_int(&point->x, in + 1, COORDINATE_BYTES) < 0)
+        return -1;
+
+    // p = 3 (mod 4), so sqrt(rhs) = rhs^((p + 1) / 4) when rhs is a square
+#if USE_SP_MATH
+    if (sp_cmp(&point->x, p) != MP_LT)
+        return -1;
+    sp_sqrmod(&point->x, p, rhs);               // x^2
+    sp_add(rhs, &ctx->curve_a, rhs);            // x^2 + a
+    sp_mulmod(rhs, &point->x, p, rhs);          // x^3 + ax
+    sp_addmod(rhs, &ctx->curve_b, p, rhs);      // x^3 + ax + b
+    if (sp_exptmod(rhs, &ctx->sqrt_exp, p, &point->y) != MP_OKAY)
+        return -1;
+#else
+    if (mp_cmp(&point->x, p) != MP_LT)
+        return -1;
+    mp_sqrmod(&point->x, p, rhs);               // x^2
+    mp_add(rhs, &ctx->curve_a, rhs);            // x^2 + a
+    mp_mulmod(rhs, &point->x, p, rhs);          // x^3 + ax
+    mp_addmod(rhs, &ctx->curve_b, p, rhs);      // x^3 + ax + b
+    if (mp_exptmod(rhs, &ctx->sqrt_exp, p, &point->y) != MP_OKAY)
+        return -1;
+#endif
+
+    // Not a square: there is no point with this x
+    if (!ecc_point_on_curve(ctx, point))
+        return -1;
+
+    // Pick the root whose parity the prefix asks for
+#if USE_SP_MATH
+    if ((sp_isodd(&point->y) ? 0x03 : 0x02) != in[0]) {
+        if (sp_iszero(&point->y))
+            return -1;
+        sp_sub(p, &point->y, &point->y);
+    }
+#else
+    if ((mp_isodd(&point->y) ? 0x03 : 0x02) != in[0]) {
+        if (mp_iszero(&point->y))
+            return -1;
+        mp_sub(p, &point->y, &point->y);
+    }
+#endif
+
+    if (store_math_int(&point->x, x, COORDINATE_BYTES) < 0 ||
+        store_math_int(&point->y, y, COORDINATE_BYTES) < 0)
+        return -1;
+    return 0;
+}
+
+// result = -point, i.e. (x, p - y)
+static void ecc_point_negate(puf_verifier_ctx* ctx, EccPoint* result, EccPoint* point) {
+#if USE_SP_MATH
+    sp_copy(&point->x, &result->x);
+    if (sp_iszero(&point->y))
+        sp_zero(&result->y);
+    else
+        sp_sub(&ctx->prime, &point->y, &result->y);
+#else
+    mp_copy(&point->x, &result->x);
+    if (mp_iszero(&point->y))
+        mp_zero(&result->y);
+    else
+        mp_sub(&ctx->prime, &point->y, &result->y);
+#endif
+}
+
+// result = -(a * b) mod n when negate is set, a * b mod n otherwise
+static void scalar_mulmod(puf_verifier_ctx* ctx, math_int_t* result, math_int_t* a, math_int_t* b, int negate) {
+#if USE_SP_MATH
+    sp_mulmod(a, b, &ctx->order, result);
+    if (negate && !sp_iszero(result))
+        sp_sub(&ctx->order, result, result);
+#else
+    mp_mulmod(a, b, &ctx->order, result);
+    if (negate && !mp_iszero(result))
+        mp_sub(&ctx->order, result, result);
+#endif
+}
+
+// Read width bits of scalar starting at bit
+static int scalar_window(math_int_t* scalar, int bit, int width) {
+    int digit = 0;
+
+    for (int i = width - 1; i >= 0; i--)
+        digit = (digit << 1) | (test_bit(scalar, bit + i) ? 1 : 0);
+
+    return digit;
+}
+
+// Pippenger window width, balancing bucket sums against per-term additions
+static int batch_window_width(int terms) {
+    if (terms < 16)   return 2;
+    if (terms < 64)   return 3;
+    if (terms < 256)  return 4;
+    if (terms < 1024) return 5;
+    if (terms < 4096) return 6;
+    if (terms < 8192) return 7;
+    return BATCH_MAX_WINDOW;
+}
+
+// Multi-scalar multiplication with the bucket method:
+// result = sum(terms[i].scalar * terms[i].point)
+static int ecc_msm_custom(puf_verifier_ctx* ctx, EccPoint* result, MsmTerm* terms, int count,
+                   EccPoint* buckets, int width) {
+    EccPoint *running = &ctx->vg, *sum = &ctx->wh;
+    int windows = (ORDER_BITS + width - 1) / width;
+    int ret;
+
+    set_infinity(result);
+
+    for (int win = windows - 1; win >= 0; win--) {
+        for (int i = 0; i < width; i++) {
+            ret = ecc_point_add_custom(ctx, result, result, result);
+            if (ret != 0)
+                return ret;
+        }
+
+        for (int d = 1; d < (1 << width); d++)
+            set_infinity(&buckets[d]);
+
+        for (int t = 0; t < count; t++) {
+            int d = scalar_window(&terms[t].scalar, win * width, width);
+            if (d == 0)
+                continue;
+
+            ret = ecc_point_add_custom(ctx, &buckets[d], &buckets[d], &terms[t].point);
+            if (ret != 0)
+                return ret;
+        }
+
+        // sum = 1*B1 + 2*B2 + ... via running suffix sums
+        set_infinity(running);
+        set_infinity(sum);
+        for (int d = (1 << width) - 1; d >= 1; d--) {
+            ret = ecc_point_add_custom(ctx, running, running, &buckets[d]);
+            if (ret == 0)
+                ret = ecc_point_add_custom(ctx, sum, sum, running);
+            if (ret != 0)
+                return ret;
+        }
+
+        ret = ecc_point_add_custom(ctx, result, result, sum);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+// Check the proofs listed in idx together, bisect when the combination fails
+static int batch_check(puf_verifier_ctx* ctx, const puf_proof_t* proofs, const byte* alphas,
+                const int* idx, int count, int* results, MsmTerm* terms, EccPoint* buckets) {
+    byte weight[BATCH_WEIGHT_BYTES];
+    int half, ret;
+
+    if (count == 0)
+        return 0;
+
+    if (count == 1) {
+        results[idx[0]] = verify_proof(ctx, &proofs[idx[0]]) == 0 ? 0 : -1;
+        return 0;
+    }
+
+    for (int j = 0; j < count; j++) {
+        const puf_proof_t *proof = &proofs[idx[j]];
+        MsmTerm *t = &terms[j * BATCH_TERMS_PER_PROOF];
+
+        // Fresh non-zero random weight r for every proof and every attempt
+        ret = wc_RNG_GenerateBlock(&ctx->rng, weight, sizeof(weight));
+        if (ret != 0)
+            return ret;
+        weight[BATCH_WEIGHT_BYTES - 1] |= 1;
+
+        if (load_math_int(&ctx->weight, weight, BATCH_WEIGHT_BYTES) < 0 ||
+            load_math_int(&ctx->v, proof->v, SCALAR_BYTES) < 0 ||
+            load_math_int(&ctx->w, proof->w, SCALAR_BYTES) < 0 ||
+            load_math_int(&ctx->alpha, alphas + idx[j] * WC_SHA256_DIGEST_SIZE,
+                          WC_SHA256_DIGEST_SIZE) < 0 ||
+            load_math_int(&t[0].point.x, proof->gx, COORDINATE_BYTES) < 0 ||
+            load_math_int(&t[0].point.y, proof->gy, COORDINATE_BYTES) < 0 ||
+            load_math_int(&t[1].point.x, proof->hx, COORDINATE_BYTES) < 0 ||
+            load_math_int(&t[1].point.y, proof->hy, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->P.x, proof->Px, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->P.y, proof->Py, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->COM.x, proof->COMx, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->COM.y, proof->COMy, COORDINATE_BYTES) < 0)
+            return -1;
+
+        scalar_mulmod(ctx, &t[0].scalar, &ctx->weight, &ctx->v, 0);
+        scalar_mulmod(ctx, &t[1].scalar, &ctx->weight, &ctx->w, 0);
+        ecc_point_negate(ctx, &t[2].point, &ctx->P);
 #if USE_SP_MATH
-    sp_clear(&nonce);
-    sp_clear(&v);
-    sp_clear(&w);
-    sp_clear(&alpha);
+        sp_copy(&ctx->weight, &t[2].scalar);
 #else
-    mp_clear(&nonce);
-    mp_clear(&v);
-    mp_clear(&w);
-    mp_clear(&alpha);
+        mp_copy(&ctx->weight, &t[2].scalar);
 #endif
-    wc_ecc_free(&key);
+        ecc_point_negate(ctx, &t[3].point, &ctx->COM);
+        scalar_mulmod(ctx, &t[3].scalar, &ctx->weight, &ctx->alpha, 0);
+    }
+
+    ret = ecc_msm_custom(ctx, &ctx->left_side, terms, count * BATCH_TERMS_PER_PROOF, buckets,
+                         batch_window_width(count * BATCH_TERMS_PER_PROOF));
+    if (ret != 0)
+        return ret;
+
+    if (is_infinity(&ctx->left_side)) {
+        for (int j = 0; j < count; j++)
+            results[idx[j]] = 0;
+        return 0;
+    }
 
+    VERBOSE(ctx, "Batch of %d proofs failed, bisecting\n", count);
+
+    half = count / 2;
+    ret = batch_check(ctx, proofs, alphas, idx, half, results, terms, buckets);
+    if (ret == 0)
+        ret = batch_check(ctx, proofs, alphas, idx + half, count - half, results, terms, buckets);
     return ret;
 }
 
+int verify_proof_batch(puf_verifier_ctx* ctx, const puf_proof_t* proofs, int count, int* results) {
+    MsmTerm *terms = NULL;
+    EccPoint *buckets = NULL;
+    byte *alphas = NULL;
+    int *idx = NULL;
+    int valid = 0, term_count = 0, bucket_count = 0, failed = 0;
+    int ret = 0;
+
+    if (count <= 0)
+        return 0;
+
+    alphas = malloc((size_t)count * WC_SHA256_DIGEST_SIZE);
+    idx = malloc((size_t)count * sizeof(*idx));
+    if (!alphas || !idx) {
+        ret = -1;
+        goto cleanup;
+    }
+
+    // Reject malformed proofs up front, the combination is only sound for
+    // points on the curve. Compute α = H(P, n) once per proof.
+    for (int i = 0; i < count; i++) {
+        const puf_proof_t *proof = &proofs[i];
+
+        results[i] = -1;
+
+        if (!proof->gx || !proof->gy || !proof->hx || !proof->hy ||
+            !proof->COMx || !proof->COMy || !proof->Px || !proof->Py ||
+            !proof->nonce || !proof->v || !proof->w)
+            continue;
+
+        if (load_math_int(&ctx->g.x, proof->gx, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->g.y, proof->gy, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->h.x, proof->hx, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->h.y, proof->hy, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->COM.x, proof->COMx, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->COM.y, proof->COMy, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->P.x, proof->Px, COORDINATE_BYTES) < 0 ||
+            load_math_int(&ctx->P.y, proof->Py, COORDINATE_BYTES) < 0)
+            continue;
+
+        if (!ecc_point_on_curve(ctx, &ctx->g) || !ecc_point_on_curve(ctx, &ctx->h) ||
+            !ecc_point_on_curve(ctx, &ctx->COM) || !ecc_point_on_curve(ctx, &ctx->P)) {
+            VERBOSE(ctx, "Proof %d has a point off the curve\n", i);
+            continue;
+        }
+
+        wc_Sha256 sha;
+        ret = wc_InitSha256(&sha);
+        if (ret == 0)
+            ret = wc_Sha256Update(&sha, proof->Px, COORDINATE_BYTES);
+        if (ret == 0)
+            ret = wc_Sha256Update(&sha, proof->Py, COORDINATE_BYTES);
+        if (ret == 0)
+            ret = wc_Sha256Update(&sha, proof->nonce, NONCE_BYTES);
+        if (ret == 0)
+            ret = wc_Sha256Final(&sha, alphas + i * WC_SHA256_DIGEST_SIZE);
+        wc_Sha256Free(&sha);
+        if (ret != 0)
+            goto cleanup;
+
+        idx[valid++] = i;
+    }
+
+    if (valid > 1) {
+        term_count = valid * BATCH_TERMS_PER_PROOF;
+        bucket_count = 1 << batch_window_width(term_count);
+
+        terms = calloc((size_t)term_count, sizeof(*terms));
+        buckets = calloc((size_t)bucket_count, sizeof(*buckets));
+        if (!terms || !buckets) {
+            ret = -1;
+            goto cleanup;
+        }
+
+        for (int t = 0; t < term_count; t++) {
+            if (init_ecc_point(&terms[t].point) < 0 || init_math_int(&terms[t].scalar) < 0) {
+                ret = -1;
+                goto cleanup;
+            }
+        }
+        for (int b = 0; b < bucket_count; b++) {
+            if (init_ecc_point(&buckets[b]) < 0) {
+                ret = -1;
+                goto cleanup;
+            }
+        }
+    }
+
+    ret = batch_check(ctx, proofs, alphas, idx, valid, results, terms, buckets);
+
+cleanup:
+    if (terms) {
+        for (int t = 0; t < term_count; t++) {
+            free_ecc_point(&terms[t].point);
+            free_math_int(&terms[t].scalar);
+        }
+    }
+    if (buckets) {
+        for (int b = 0; b < bucket_count; b++)
+            free_ecc_point(&buckets[b]);
+    }
+    free(terms);
+    free(buckets);
+    free(alphas);
+    free(idx);
+
+    if (ret != 0)
+        return ret < 0 ? ret : -ret;
+
+    for (int i = 0; i < count; i++)
+        failed += results[i] != 0;
+    return failed;
+}
+
 #ifdef STANDALONE
+// CLI front end: parse the string arguments into raw portions
+static int verify_zk_proof(puf_verifier_ctx* ctx, Args* args) {
+    math_int_t *num = &ctx->temp1;
+    byte gx[COORDINATE_BYTES], gy[COORDINATE_BYTES];
+    byte hx[COORDINATE_BYTES], hy[COORDINATE_BYTES];
+    byte COMx[COORDINATE_BYTES], COMy[COORDINATE_BYTES];
+    byte Px[COORDINATE_BYTES], Py[COORDINATE_BYTES];
+    byte nonce_bytes[NONCE_BYTES], v[SCALAR_BYTES], w[SCALAR_BYTES];
+    puf_proof_t proof = {
+        .gx = gx, .gy = gy, .hx = hx, .hy = hy,
+        .COMx = COMx, .COMy = COMy, .Px = Px, .Py = Py,
+        .nonce = nonce_bytes, .v = v, .w = w,
+    };
+
+    printf("\n=== Zero Knowledge Verifier Proof Tool (CLI Mode) ===\n\n");
+
+    if (!args->gx || !args->gy || !args->hx || !args->hy ||
+        !args->COMx || !args->COMy || !args->Px || !args->Py ||
+        !args->nonce || !args->v || !args->w) {
+        printf("Error: All parameters required in CLI mode\n");
+        return -1;
+    }
+
+    // Parse every string and store it as a fixed size big-endian portion,
+    // exactly as it would arrive from the device
+    if (parse_hex_to_math(args->gx, num) != MP_OKAY || store_math_int(num, gx, COORDINATE_BYTES) < 0 ||
+        parse_hex_to_math(args->gy, num) != MP_OKAY || store_math_int(num, gy, COORDINATE_BYTES) < 0 ||
+        parse_hex_to_math(args->hx, num) != MP_OKAY || store_math_int(num, hx, COORDINATE_BYTES) < 0 ||
+        parse_hex_to_math(args->hy, num) != MP_OKAY || store_math_int(num, hy, COORDINATE_BYTES) < 0 ||
+        parse_hex_to_math(args->COMx, num) != MP_OKAY || store_math_int(num, COMx, COORDINATE_BYTES) < 0 ||
+        parse_hex_to_math(args->COMy, num) != MP_OKAY || store_math_int(num, COMy, COORDINATE_BYTES) < 0 ||
+        parse_hex_to_math(args->Px, num) != MP_OKAY || store_math_int(num, Px, COORDINATE_BYTES) < 0 ||
+        parse_hex_to_math(args->Py, num) != MP_OKAY || store_math_int(num, Py, COORDINATE_BYTES) < 0 ||
+        parse_hex_to_math(args->v, num) != MP_OKAY || store_math_int(num, v, SCALAR_BYTES) < 0 ||
+        parse_hex_to_math(args->w, num) != MP_OKAY || store_math_int(num, w, SCALAR_BYTES) < 0) {
+        printf("Error: Failed to parse parameters\n");
+        return -1;
+    }
+
+    // The nonce is hashed as is, so it must be exactly NONCE_BYTES long
+    if (parse_hex_to_math(args->nonce, num) != MP_OKAY) {
+        printf("Error: Failed to parse nonce\n");
+        return -1;
+    }
+#if USE_SP_MATH
+    int nonce_actual_size = sp_unsigned_bin_size(num);
+#else
+    int nonce_actual_size = mp_unsigned_bin_size(num);
+#endif
+    if (nonce_actual_size != NONCE_BYTES || store_math_int(num, nonce_bytes, NONCE_BYTES) < 0) {
+        fprintf(stderr, "Nonce size mismatch: expected 64, got %d\n", nonce_actual_size);
+        return -1;
+    }
+
+    return verify_proof(ctx, &proof);
+}
+
 int main(int argc, char *argv[]) {
     Args args = {0};
     int opt;
@@ -874,58 +1442,55 @@ int main(int argc, char *argv[]) {
         }
     }
 
-    return verify_zk_proof(&args);
-}
-#else
-char *bytes_to_hex_string(const uint8_t *data, size_t len, bool prefix_0x) {
-    size_t hex_len = len * 2 + 1 + (prefix_0x ? 2 : 0); // 2 hex chars per byte + null + optional "0x"
-    char *out = malloc(hex_len);
-    if (!out) return NULL;
+    puf_verifier_ctx *ctx = puf_verifier_ctx_new();
+    if (!ctx)
+        return 1;
 
-    char *p = out;
-
-    if (prefix_0x) {
-        *p++ = '0';
-        *p++ = 'x';
-    }
+    int ret = verify_zk_proof(ctx, &args);
 
-    for (size_t i = 0; i < len; ++i) {
-        sprintf(p, "%02x", data[i]);
-        p += 2;
-    }
-
-    *p = '\0';
-    return out;
+    puf_verifier_ctx_free(ctx);
+    return ret;
 }
+#else
+// Map the challenge responses onto the raw proof portions, no copies made
+int puf_proof_from_portions(puf_proof_t *proof, func_call_t *init, func_call_t *comm,
+                            func_call_t *proofs, data_portion_t *nonce) {
+    if (init->data_p[0].len != COORDINATE_BYTES || init->data_p[1].len != COORDINATE_BYTES ||
+        init->data_p[2].len != COORDINATE_BYTES || init->data_p[3].len != COORDINATE_BYTES ||
+        comm->data_p[2].len != COORDINATE_BYTES || comm->data_p[3].len != COORDINATE_BYTES ||
+        proofs->data_p[0].len != COORDINATE_BYTES || proofs->data_p[1].len != COORDINATE_BYTES ||
+        proofs->data_p[2].len != SCALAR_BYTES || proofs->data_p[3].len != SCALAR_BYTES ||
+        nonce->len != NONCE_BYTES) {
+        fprintf(stderr, "Unexpected PUF response portion size!\n");
+        return -1;
+    }
 
-int verify(func_call_t *init, func_call_t *comm, func_call_t *proofs, data_portion_t *nonce) {
-    Args args = {0};  // Use the real Args struct
-
-    // Convert binary data to decimal strings
-    args.gx    = bytes_to_hex_string(init->data_p[0].data, init->data_p[0].len, true);
-    args.gy    = bytes_to_hex_string(init->data_p[1].data, init->data_p[1].len, true);
-    args.hx    = bytes_to_hex_string(init->data_p[2].data, init->data_p[2].len, true);
-    args.hy    = bytes_to_hex_string(init->data_p[3].data, init->data_p[3].len, true);
+    proof->gx    = init->data_p[0].data;
+    proof->gy    = init->data_p[1].data;
+    proof->hx    = init->data_p[2].data;
+    proof->hy    = init->data_p[3].data;
 
-    args.COMx  = bytes_to_hex_string(comm->data_p[2].data, comm->data_p[2].len, true);
-    args.COMy  = bytes_to_hex_string(comm->data_p[3].data, comm->data_p[3].len, true);
+    proof->COMx  = comm->data_p[2].data;
+    proof->COMy  = comm->data_p[3].data;
 
-    args.Px    = bytes_to_hex_string(proofs->data_p[0].data, proofs->data_p[0].len, true);
-    args.Py    = bytes_to_hex_string(proofs->data_p[1].data, proofs->data_p[1].len, true);
-    args.nonce = bytes_to_hex_string(nonce->data, nonce->len, true);
-    args.v     = bytes_to_hex_string(proofs->data_p[2].data, proofs->data_p[2].len, true);
-    args.w     = bytes_to_hex_string(proofs->data_p[3].data, proofs->data_p[3].len, true);
+    proof->Px    = proofs->data_p[0].data;
+    proof->Py    = proofs->data_p[1].data;
+    proof->nonce = nonce->data;
+    proof->v     = proofs->data_p[2].data;
+    proof->w     = proofs->data_p[3].data;
 
+    return 0;
+}
 
-    // Call the actual verifier
-    int result = verify_zk_proof(&args);
+int verify(puf_verifier_ctx *ctx, func_call_t *init, func_call_t *comm,
+           func_call_t *proofs, data_portion_t *nonce) {
+    puf_proof_t proof;
 
-    // Clean up
-    free(args.gx); free(args.gy); free(args.hx); free(args.hy);
-    free(args.COMx); free(args.COMy);
-    free(args.Px); free(args.Py); free(args.nonce); free(args.v); free(args.w);
+    if (puf_proof_from_portions(&proof, init, comm, proofs, nonce) != 0)
+        return -1;
 
-    return result;
+    VERBOSE(ctx, "=== Attempting to verify PUF! ===\n");
+    return verify_proof(ctx, &proof);
 }
 
 #endif /*STANDALONE*/
@@ -2,6 +2,81 @@
 #define PUF_VERIFIER_H
 #include "common/challenge.h"
 
-int verify(func_call_t *init, func_call_t *comm, func_call_t *proofs, data_portion_t *nonce);
+#define PUF_COORDINATE_LEN LEN32
+#define PUF_SCALAR_LEN     LEN64
+#define PUF_NONCE_LEN      LEN64
+
+/* Raw big-endian proof material, as carried by the func_call_t portions. */
+typedef struct {
+    const uint8_t *gx, *gy, *hx, *hy;   /* PUF_COORDINATE_LEN each */
+    const uint8_t *COMx, *COMy;         /* PUF_COORDINATE_LEN each */
+    const uint8_t *Px, *Py;             /* PUF_COORDINATE_LEN each */
+    const uint8_t *v, *w;               /* PUF_SCALAR_LEN each */
+    const uint8_t *nonce;               /* PUF_NONCE_LEN */
+} puf_proof_t;
+
+/* Owning storage for one proof, see puf_proof_view(). */
+typedef struct {
+    uint8_t gx[PUF_COORDINATE_LEN], gy[PUF_COORDINATE_LEN];
+    uint8_t hx[PUF_COORDINATE_LEN], hy[PUF_COORDINATE_LEN];
+    uint8_t COMx[PUF_COORDINATE_LEN], COMy[PUF_COORDINATE_LEN];
+    uint8_t Px[PUF_COORDINATE_LEN], Py[PUF_COORDINATE_LEN];
+    uint8_t v[PUF_SCALAR_LEN], w[PUF_SCALAR_LEN];
+    uint8_t nonce[PUF_NONCE_LEN];
+} puf_proof_buf_t;
+
+/* Points proof at the fields of buf. */
+void puf_proof_view(const puf_proof_buf_t *buf, puf_proof_t *proof);
+
+/* Copies the material proof points at into buf. */
+void puf_proof_copy(puf_proof_buf_t *buf, const puf_proof_t *proof);
+
+/* Verifier state owning the curve, the P-256 prime and every scratch point
+ * and scalar used by a verification. Create it once and reuse it, so that
+ * verify() does no per-call setup. Not thread safe, use one per thread. */
+typedef struct puf_verifier_ctx puf_verifier_ctx;
+
+puf_verifier_ctx *puf_verifier_ctx_new(void);
+void puf_verifier_ctx_free(puf_verifier_ctx *ctx);
+
+/* Point arithmetic used by verify_proof(). The wolfCrypt backend does the
+ * scalar multiplications with wc_ecc_mulmod(), the custom one with the
+ * verifier's own affine double-and-add. Building with -DPUF_WOLFCRYPT_BACKEND
+ * makes wolfCrypt the default for new contexts. */
+typedef enum {
+    PUF_BACKEND_CUSTOM,
+    PUF_BACKEND_WOLFCRYPT,
+} puf_backend_t;
+
+int puf_verifier_ctx_set_backend(puf_verifier_ctx *ctx, puf_backend_t backend);
+const char *puf_backend_name(puf_backend_t backend);
+
+/* Step-by-step tracing of each verification to stdout, on by default. */
+void puf_verifier_ctx_set_verbose(puf_verifier_ctx *ctx, int verbose);
+
+/* Recovers y from a COMPRESSED_POINT_LEN byte SEC1 point as the square root
+ * of x^3 + ax + b, writing both coordinates as PUF_COORDINATE_LEN bytes.
+ * Returns 0 on success, -1 if the encoding is malformed or x is not on the
+ * curve. */
+int puf_point_decompress(puf_verifier_ctx *ctx, const uint8_t *in,
+                         uint8_t *x, uint8_t *y);
+
+/* Returns 0 if g^v*h^w = P*COM^H(P, nonce), non-zero otherwise. */
+int verify_proof(puf_verifier_ctx *ctx, const puf_proof_t *proof);
+
+/* Checks count proofs with one random linear combination, falling back to
+ * bisection when the combination fails. results[i] is set to 0 for a valid
+ * proof and -1 otherwise. Returns the number of invalid proofs, or a negative
+ * value on internal error. */
+int verify_proof_batch(puf_verifier_ctx *ctx, const puf_proof_t *proofs,
+                       int count, int *results);
+
+/* Points proof at the PUF response portions, checking their sizes. Returns 0
+ * on success, -1 if a portion has an unexpected length. */
+int puf_proof_from_portions(puf_proof_t *proof, func_call_t *init, func_call_t *comm,
+                            func_call_t *proofs, data_portion_t *nonce);
+
+int verify(puf_verifier_ctx *ctx, func_call_t *init, func_call_t *comm,
+           func_call_t *proofs, data_portion_t *nonce);
 
 #endif
@@ -0,0 +1,163 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+#include "random_pool.h"
+#include "util.h"
+
+// Bytes generated per DRBG call on the pre-fill thread
+#define PREFILL_CHUNK 256
+
+struct random_pool {
+    pthread_mutex_t lock;
+    pthread_cond_t drained;     // signalled when the ring has room again
+
+    uint8_t *ring;
+    size_t size, head, avail;
+    int stopping;
+
+    pthread_t thread;
+    int started;
+
+    random_pool_stats_t stats;
+};
+
+static void *prefill_main(void *arg) {
+    random_pool *pool = arg;
+    uint8_t chunk[PREFILL_CHUNK];
+    WC_RNG *rng = thread_rng();
+    uint64_t start, elapsed;
+
+    if (!rng) {
+        fprintf(stderr, "Random pool: failed to initialize DRBG\n");
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->size - pool->avail < sizeof(chunk) && !pool->stopping)
+            pthread_cond_wait(&pool->drained, &pool->lock);
+        if (pool->stopping) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        // Generate outside the lock, consumers keep draining meanwhile
+        start = now_ns();
+        if (wc_RNG_GenerateBlock(rng, chunk, sizeof(chunk)) != 0) {
+            fprintf(stderr, "Random pool: DRBG failed, stopping pre-fill\n");
+            break;
+        }
+        elapsed = now_ns() - start;
+
+        pthread_mutex_lock(&pool->lock);
+        for (size_t i = 0; i < sizeof(chunk); i++)
+            pool->ring[(pool->head + pool->avail + i) % pool->size] = chunk[i];
+        pool->avail += sizeof(chunk);
+        pool->stats.bytes_prefilled += sizeof(chunk);
+        pool->stats.prefill_ns += elapsed;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    wipe(chunk, sizeof(chunk));
+    return NULL;
+}
+
+random_pool *random_pool_new(size_t ring_bytes) {
+    random_pool *pool;
+
+    if (ring_bytes < PREFILL_CHUNK)
+        ring_bytes = PREFILL_CHUNK;
+
+    pool = calloc(1, sizeof(*pool));
+    if (!pool)
+        return NULL;
+
+    pool->size = ring_bytes;
+    pool->ring = malloc(ring_bytes);
+    if (!pool->ring) {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->drained, NULL);
+
+    if (pthread_create(&pool->thread, NULL, prefill_main, pool) != 0) {
+        // Still usable, every request is served inline
+        fprintf(stderr, "Random pool: failed to start pre-fill thread\n");
+    } else {
+        pool->started = 1;
+    }
+
+    return pool;
+}
+
+void random_pool_free(random_pool *pool) {
+    if (!pool)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->drained);
+    pthread_mutex_unlock(&pool->lock);
+
+    if (pool->started)
+        pthread_join(pool->thread, NULL);
+
+    pthread_cond_destroy(&pool->drained);
+    pthread_mutex_destroy(&pool->lock);
+    wipe(pool->ring, pool->size);
+    free(pool->ring);
+    free(pool);
+}
+
+int random_pool_get(random_pool *pool, uint8_t *out, size_t len) {
+    WC_RNG *rng;
+    uint64_t start, elapsed;
+    int ret;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stats.requests++;
+    if (pool->avail >= len) {
+        for (size_t i = 0; i < len; i++) {
+            out[i] = pool->ring[pool->head];
+            pool->ring[pool->head] = 0;     // served bytes are never reused
+            pool->head = (pool->head + 1) % pool->size;
+        }
+        pool->avail -= len;
+        pool->stats.ring_hits++;
+        pthread_cond_signal(&pool->drained);
+        pthread_mutex_unlock(&pool->lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // Ring is dry, pay for the DRBG on this thread rather than wait
+    rng = thread_rng();
+    if (!rng)
+        return -1;
+
+    start = now_ns();
+    ret = wc_RNG_GenerateBlock(rng, out, (word32)len);
+    elapsed = now_ns() - start;
+    if (ret != 0)
+        return -1;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stats.inline_fills++;
+    pool->stats.inline_ns += elapsed;
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+void random_pool_stats(random_pool *pool, random_pool_stats_t *stats) {
+    pthread_mutex_lock(&pool->lock);
+    *stats = pool->stats;
+    pthread_mutex_unlock(&pool->lock);
+}
@@ -0,0 +1,29 @@
+#ifndef RANDOM_POOL_H
+#define RANDOM_POOL_H
+#include <stdint.h>
+#include <stddef.h>
+
+/* Random bytes for per-session challenges and nonces. A background thread
+ * keeps a ring of DRBG output topped up, so connection handlers normally
+ * just copy bytes out. When the ring runs dry the caller draws from its own
+ * per-thread wolfCrypt DRBG instead of waiting. */
+typedef struct random_pool random_pool;
+
+typedef struct {
+    uint64_t requests;          /* random_pool_get() calls */
+    uint64_t ring_hits;         /* served from the pre-filled ring */
+    uint64_t inline_fills;      /* generated on the caller's thread */
+    uint64_t bytes_prefilled;
+    uint64_t prefill_ns;        /* DRBG time on the pre-fill thread */
+    uint64_t inline_ns;         /* DRBG time on caller threads */
+} random_pool_stats_t;
+
+random_pool *random_pool_new(size_t ring_bytes);
+void random_pool_free(random_pool *pool);
+
+/* Fills out with len random bytes. Returns 0 on success. */
+int random_pool_get(random_pool *pool, uint8_t *out, size_t len);
+
+void random_pool_stats(random_pool *pool, random_pool_stats_t *stats);
+
+#endif
@@ -0,0 +1,180 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#include "revocation_index.h"
+#include "util.h"
+
+#define RECHECK_NS 1000000000ull
+
+struct revocation_index {
+    char *path;
+    const uint8_t *map;         // NULL for an empty file
+    size_t size;
+    dev_t dev;
+    ino_t ino;
+    uint64_t checked_ns;
+    VerifyCallback next_cb;     // the callback of ctx before attaching
+    revocation_index_stats_t stats;
+};
+
+static int ex_index = -1;
+
+static void unmap(revocation_index *idx) {
+    if (idx->map)
+        munmap((void *)idx->map, idx->size);
+    idx->map = NULL;
+    idx->size = 0;
+}
+
+// Maps the file path names now, the old mapping stays if that fails
+static int map(revocation_index *idx) {
+    struct stat st;
+    void *addr = NULL;
+    int fd;
+
+    fd = open(idx->path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (fstat(fd, &st) != 0 || st.st_size % REVOCATION_ENTRY_LEN != 0) {
+        fprintf(stderr, "Revocation index: %s is not a list of fingerprints\n", idx->path);
+        close(fd);
+        return -1;
+    }
+    if (st.st_size > 0) {
+        addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (addr == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+    }
+    close(fd);
+
+    unmap(idx);
+    idx->map = addr;
+    idx->size = st.st_size;
+    idx->dev = st.st_dev;
+    idx->ino = st.st_ino;
+    idx->stats.entries = st.st_size / REVOCATION_ENTRY_LEN;
+    return 0;
+}
+
+// A rename puts a new inode behind the path, the mapped one is unaffected
+static void recheck(revocation_index *idx) {
+    uint64_t now = now_ns();
+    struct stat st;
+
+    if (now - idx->checked_ns < RECHECK_NS)
+        return;
+    idx->checked_ns = now;
+
+    if (stat(idx->path, &st) != 0 || (st.st_dev == idx->dev && st.st_ino == idx->ino))
+        return;
+    if (map(idx) == 0)
+        idx->stats.reloads++;
+}
+
+revocation_index *revocation_index_open(const char *path) {
+    revocation_index *idx;
+
+    idx = calloc(1, sizeof(*idx));
+    if (!idx)
+        return NULL;
+
+    idx->path = strdup(path);
+    if (!idx->path || map(idx) != 0) {
+        if (idx->path)
+            fprintf(stderr, "Revocation index: failed to map %s\n", path);
+        free(idx->path);
+        free(idx);
+        return NULL;
+    }
+    idx->checked_ns = now_ns();
+    return idx;
+}
+
+void revocation_index_close(revocation_index *idx) {
+    if (!idx)
+        return;
+
+    unmap(idx);
+    free(idx->path);
+    free(idx);
+}
+
+int revocation_index_contains(revocation_index *idx,
+                              const uint8_t fingerprint[REVOCATION_ENTRY_LEN]) {
+    size_t lo = 0, hi;
+
+    recheck(idx);
+    idx->stats.lookups++;
+
+    hi = idx->size / REVOCATION_ENTRY_LEN;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = memcmp(idx->map + mid * REVOCATION_ENTRY_LEN, fingerprint,
+                         REVOCATION_ENTRY_LEN);
+
+        if (cmp == 0) {
+            idx->stats.revoked++;
+            return 1;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return 0;
+}
+
+static int revoked(revocation_index *idx, WOLFSSL_X509 *cert) {
+    uint8_t fp[REVOCATION_ENTRY_LEN];
+
+    // A certificate that cannot be fingerprinted cannot be cleared either
+    if (cert_fingerprint(cert, fp) != 0)
+        return 1;
+    return revocation_index_contains(idx, fp);
+}
+
+static int verify_cb(int preverify, WOLFSSL_X509_STORE_CTX *store) {
+    revocation_index *idx = verify_ctx_data(store, ex_index);
+    WOLFSSL_X509 *cert;
+
+    if (!idx)
+        return 0;
+    if (wolfSSL_X509_STORE_CTX_get_error_depth(store) == 0) {
+        cert = wolfSSL_X509_STORE_CTX_get_current_cert(store);
+        if (!cert || revoked(idx, cert))
+            return 0;
+    }
+    return idx->next_cb ? idx->next_cb(preverify, store) : preverify;
+}
+
+int revocation_index_attach(revocation_index *idx, WOLFSSL_CTX *ctx) {
+    VerifyCallback cb = wolfSSL_CTX_get_verify_callback(ctx);
+    revocation_index *prev = NULL;
+
+#ifndef WOLFSSL_ALWAYS_VERIFY_CB
+    if (!cb)
+        return -1;
+#endif
+    // Replacing an index attached before keeps the callback it chained to
+    if (cb == verify_cb && ex_index >= 0)
+        prev = wolfSSL_CTX_get_ex_data(ctx, ex_index);
+    idx->next_cb = cb != verify_cb ? cb : prev ? prev->next_cb : NULL;
+    if (set_verify_ctx_data(ctx, &ex_index, idx) != 0)
+        return -1;
+    wolfSSL_CTX_set_verify(ctx, wolfSSL_CTX_get_verify_mode(ctx), verify_cb);
+    return 0;
+}
+
+void revocation_index_stats(const revocation_index *idx, revocation_index_stats_t *stats) {
+    *stats = idx->stats;
+}
@@ -0,0 +1,45 @@
+#ifndef REVOCATION_INDEX_H
+#define REVOCATION_INDEX_H
+#include <stdint.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#define REVOCATION_ENTRY_LEN 32 /* SHA-256 of the certificate DER */
+
+/* Revoked peer certificates, looked up during the handshake. The file is a
+ * plain array of fingerprints sorted in ascending byte order, with no header,
+ * as written by scripts/revocation_index.sh. It is memory-mapped and binary
+ * searched, so it is never parsed and a lookup costs O(log n).
+ *
+ * The file is replaced by renaming a new one over it. At most once a second
+ * a lookup checks whether the path names a different file, and if so maps
+ * that one instead. Not thread safe, like the verify callbacks it runs in. */
+typedef struct revocation_index revocation_index;
+
+typedef struct {
+    uint64_t lookups;
+    uint64_t revoked;           /* certificates found in the index */
+    uint64_t reloads;           /* replacement files mapped */
+    uint32_t entries;           /* fingerprints in the current file */
+} revocation_index_stats_t;
+
+/* Returns NULL if path cannot be mapped or its size is not a multiple of
+ * REVOCATION_ENTRY_LEN. */
+revocation_index *revocation_index_open(const char *path);
+void revocation_index_close(revocation_index *idx);
+
+int revocation_index_contains(revocation_index *idx,
+                              const uint8_t fingerprint[REVOCATION_ENTRY_LEN]);
+
+/* Rejects revoked peers of ctx ahead of the verify callback already set,
+ * which keeps the last word for everything else. Call it after
+ * wolfSSL_CTX_set_verify() and friends. wolfSSL only calls back for
+ * certificates that fail its own checks, so without a callback already set
+ * this needs wolfSSL built with WOLFSSL_ALWAYS_VERIFY_CB and returns -1
+ * otherwise, as it does when wolfSSL has no ex_data slot for it. idx must
+ * outlive the handshakes on ctx. */
+int revocation_index_attach(revocation_index *idx, WOLFSSL_CTX *ctx);
+
+void revocation_index_stats(const revocation_index *idx, revocation_index_stats_t *stats);
+
+#endif
@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <time.h>
+#include <pthread.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/random.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+
+#include "util.h"
+
+static pthread_key_t rng_key;
+static pthread_once_t rng_key_once = PTHREAD_ONCE_INIT;
+
+static void free_thread_rng(void *ptr) {
+    WC_RNG *rng = ptr;
+
+    wc_FreeRng(rng);
+    free(rng);
+}
+
+static void make_rng_key(void) {
+    pthread_key_create(&rng_key, free_thread_rng);
+}
+
+WC_RNG *thread_rng(void) {
+    WC_RNG *rng;
+
+    pthread_once(&rng_key_once, make_rng_key);
+
+    rng = pthread_getspecific(rng_key);
+    if (rng)
+        return rng;
+
+    rng = malloc(sizeof(*rng));
+    if (!rng)
+        return NULL;
+    if (wc_InitRng(rng) != 0) {
+        free(rng);
+        return NULL;
+    }
+    pthread_setspecific(rng_key, rng);
+    return rng;
+}
+
+void wipe(void *ptr, size_t len) {
+    volatile uint8_t *p = ptr;
+
+    while (len--)
+        *p++ = 0;
+}
+
+uint64_t now_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+int cert_fingerprint(WOLFSSL_X509 *cert, uint8_t fingerprint[CERT_FINGERPRINT_LEN]) {
+    const unsigned char *der;
+    int derSz = 0;
+
+    der = wolfSSL_X509_get_der(cert, &derSz);
+    if (!der || derSz <= 0 || wc_Sha256Hash(der, (word32)derSz, fingerprint) != 0)
+        return -1;
+    return 0;
+}
+
+int set_verify_ctx_data(WOLFSSL_CTX *ctx, int *index, void *data) {
+    if (*index < 0)
+        *index = wolfSSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+    if (*index < 0 || wolfSSL_CTX_set_ex_data(ctx, *index, data) != WOLFSSL_SUCCESS)
+        return -1;
+    return 0;
+}
+
+void *verify_ctx_data(WOLFSSL_X509_STORE_CTX *store, int index) {
+    WOLFSSL *ssl;
+
+    ssl = wolfSSL_X509_STORE_CTX_get_ex_data(store, wolfSSL_get_ex_data_X509_STORE_CTX_idx());
+    if (!ssl || index < 0)
+        return NULL;
+    return wolfSSL_CTX_get_ex_data(wolfSSL_get_SSL_CTX(ssl), index);
+}
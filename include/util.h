@@ -0,0 +1,38 @@
+#ifndef UTIL_H
+#define UTIL_H
+#include <stdint.h>
+#include <stddef.h>
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+/* Small helpers shared by the modules in include/. */
+
+#define CERT_FINGERPRINT_LEN 32     /* SHA-256 of the DER certificate */
+
+/* The calling thread's own wolfCrypt DRBG, created on first use and
+ * released when the thread exits. NULL if it could not be set up. */
+WC_RNG *thread_rng(void);
+
+/* Clears len bytes at ptr in a way the compiler may not drop, like
+ * wolfCrypt's ForceZero(), which it does not export. */
+void wipe(void *ptr, size_t len);
+
+/* CLOCK_MONOTONIC in nanoseconds. */
+uint64_t now_ns(void);
+
+/* Identifies cert by the SHA-256 of its DER encoding, as the device
+ * registry, the client certificate cache, the auth tickets and the
+ * revocation index do. Returns 0, or -1 if cert cannot be encoded. */
+int cert_fingerprint(WOLFSSL_X509 *cert, uint8_t fingerprint[CERT_FINGERPRINT_LEN]);
+
+/* Stores data in the ex_data of ctx, for a verify callback to find with
+ * verify_ctx_data(). *index starts out negative and is allocated on first
+ * use. Returns 0, or -1 if wolfSSL has no ex_data slot left. */
+int set_verify_ctx_data(WOLFSSL_CTX *ctx, int *index, void *data);
+
+/* The data stored under index in the WOLFSSL_CTX of the connection that
+ * store verifies, NULL if there is none. */
+void *verify_ctx_data(WOLFSSL_X509_STORE_CTX *store, int index);
+
+#endif
@@ -0,0 +1,675 @@
+/* load-gen.c
+ *
+ * Copyright (C) 2025 3mdeb Sp. z o.o.
+ *
+ * Load generator for server-tls. It makes the same connection as client-tls
+ * (mTLS handshake, the optional CBA or PUF exchange, one message and the
+ * reply) from many threads at once, and reports connections per second and
+ * latency percentiles for every phase of the connection.
+ *
+ * In closed loop (the default) every worker starts its next connection as
+ * soon as the previous one ends. With -r the arrivals follow a fixed
+ * schedule instead, whatever the server does. Latency is then counted from
+ * the scheduled arrival, so time spent waiting for a free worker shows up
+ * in the results rather than lowering the offered load.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#include "include/common/challenge.h"
+
+/* The CBA build changes the framing, so a load-gen speaks either CBA or
+ * PUF, matching the server-tls built with the same flags. */
+#ifdef RPI_CBA
+  #include <tee_client_api.h>
+  #include "include/context_based_authentication.h"
+  #include "include/auth_ticket.h"
+#else
+  #include "include/puf_device.h"
+#endif
+
+#define DEFAULT_PORT        12345
+#define DEFAULT_WORKERS     1
+#define DEFAULT_CONNECTIONS 100
+
+#define CA_FILE     "certs/ca-cert.pem"
+#define CERT_FILE   "artifacts/certs/local-client-cert.pem"
+#define KEY_FILE    "artifacts/certs/local-client-key.pem"
+
+typedef enum {
+    FACTOR_NONE,
+    FACTOR_CBA,
+    FACTOR_PUF,
+} factor_t;
+
+typedef enum {
+    PHASE_QUEUE,        /* scheduled arrival to start, open loop only */
+    PHASE_CONNECT,      /* TCP connect */
+    PHASE_HANDSHAKE,    /* TLS handshake */
+    PHASE_FACTOR,       /* CBA or PUF exchange */
+    PHASE_APP,          /* message and reply */
+    PHASE_TOTAL,
+    PHASES
+} phase_t;
+
+static const char* phaseNames[PHASES] = {
+    "queue", "connect", "handshake", "second_factor", "app", "total"
+};
+
+typedef struct {
+    struct sockaddr_in servAddr;
+    WOLFSSL_CTX* ctx;
+    factor_t factor;
+    int connections;
+    double rate;            /* arrivals per second, 0 for closed loop */
+    int responseDelayMs;
+    int uniquePufs;
+
+    /* Shared by the workers */
+    pthread_mutex_t lock;
+    int next;
+    double start;
+
+    /* Indexed by connection number, each slot is written by one worker */
+    double* latency[PHASES];
+    int* failedPhase;       /* PHASES when the connection succeeded */
+} load_t;
+
+typedef struct {
+    load_t* load;
+    int index;
+#ifdef RPI_CBA
+    TEEC_Context teeCtx;
+    TEEC_Session teeSess;
+    int teeOpen;
+#else
+    puf_device* puf;
+#endif
+    pthread_t thread;
+} worker_t;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void sleep_until(double t)
+{
+    struct timespec ts;
+
+    ts.tv_sec = (time_t)t;
+    ts.tv_nsec = (long)((t - ts.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+        ;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+static void usage(const char* prog)
+{
+    printf("Usage: %s [options] <server IPv4 address>\n", prog);
+    printf("  -p port      Server port (default %d)\n", DEFAULT_PORT);
+    printf("  -n workers   Concurrent connections (default %d)\n", DEFAULT_WORKERS);
+    printf("  -N count     Connections in total (default %d)\n", DEFAULT_CONNECTIONS);
+    printf("  -r rate      Open loop: start connections at this rate per second,\n");
+    printf("               instead of one as soon as a worker is free\n");
+#ifdef RPI_CBA
+    printf("  -f factor    Second factor the server asks for: none or cba\n");
+    printf("               (default none)\n");
+    printf("  -w ms        Pause before every CBA frame (default 1000)\n");
+#else
+    printf("  -f factor    Second factor the server asks for: none or puf\n");
+    printf("               (default none)\n");
+    printf("  -d ms        PUF response delay per connection (default 0)\n");
+    printf("  -w ms        Pause before every PUF frame (default 1000)\n");
+    printf("  -u           Give every worker its own PUF\n");
+#endif
+    printf("  -c file      Client certificate (default %s)\n", CERT_FILE);
+    printf("  -k file      Client key (default %s)\n", KEY_FILE);
+    printf("  -A file      CA certificate (default %s)\n", CA_FILE);
+    printf("  -j file      Also write the results as JSON, - for stdout\n");
+    printf("  -h           Show this help\n");
+}
+
+#ifdef RPI_CBA
+/* Each worker keeps its TA session open for the whole run, so only the
+ * PROVE command is timed. */
+static int cba_open(worker_t* w)
+{
+    TEEC_UUID uuid = TA_CONTEXT_BASED_AUTHENTICATION_UUID;
+    TEEC_Result res;
+    uint32_t origin;
+
+    res = TEEC_InitializeContext(NULL, &w->teeCtx);
+    if (res != TEEC_SUCCESS) {
+        fprintf(stderr, "worker %d: TEEC_InitializeContext failed with code 0x%x\n",
+                w->index, res);
+        return -1;
+    }
+
+    res = TEEC_OpenSession(&w->teeCtx, &w->teeSess, &uuid, TEEC_LOGIN_PUBLIC,
+                           NULL, NULL, &origin);
+    if (res != TEEC_SUCCESS) {
+        fprintf(stderr, "worker %d: TEEC_OpenSession failed with code 0x%x origin 0x%x\n",
+                w->index, res, origin);
+        TEEC_FinalizeContext(&w->teeCtx);
+        return -1;
+    }
+    w->teeOpen = 1;
+    return 0;
+}
+
+static void cba_close(worker_t* w)
+{
+    if (!w->teeOpen)
+        return;
+
+    TEEC_CloseSession(&w->teeSess);
+    TEEC_FinalizeContext(&w->teeCtx);
+    w->teeOpen = 0;
+}
+
+static int cba_enroll(void)
+{
+    TEEC_UUID uuid = TA_CONTEXT_BASED_AUTHENTICATION_UUID;
+    TEEC_Context ctx;
+    TEEC_Session sess;
+    TEEC_Operation op;
+    TEEC_Result res;
+    uint32_t origin;
+
+    res = TEEC_InitializeContext(NULL, &ctx);
+    if (res != TEEC_SUCCESS)
+        return -1;
+
+    res = TEEC_OpenSession(&ctx, &sess, &uuid, TEEC_LOGIN_PUBLIC, NULL, NULL, &origin);
+    if (res == TEEC_SUCCESS) {
+        memset(&op, 0, sizeof(op));
+        op.paramTypes = TEEC_PARAM_TYPES(TEEC_NONE, TEEC_NONE, TEEC_NONE, TEEC_NONE);
+        res = TEEC_InvokeCommand(&sess, TA_CONTEXT_BASED_AUTHENTICATION_CMD_ENROLL,
+                                 &op, &origin);
+        TEEC_CloseSession(&sess);
+    }
+    TEEC_FinalizeContext(&ctx);
+
+    return res == TEEC_SUCCESS ? 0 : -1;
+}
+
+/* Signs the server's nonce, as client-tls does without a ticket. The
+ * signature travels in a fixed size message and must be followed by at
+ * least one zero byte. A granted ticket is dropped, so every connection
+ * runs the full CBA. */
+static int serve_cba(worker_t* w, WOLFSSL* ssl)
+{
+    const uint8_t noncePattern[DATA_PORTIONS] = {CBA_NONCE_SIZE};
+    const uint8_t messagePattern[DATA_PORTIONS] = {CBA_MESSAGE_SIZE};
+    uint8_t grant[AUTH_TICKET_GRANT_LEN];
+    func_call_t req, rsp;
+    TEEC_Operation op;
+    TEEC_Result res;
+    uint32_t origin;
+    uint32_t flags;
+    int ret = -1;
+
+    memset(&req, 0, sizeof(req));
+    memset(&rsp, 0, sizeof(rsp));
+
+    if (initFunc(&req, 0, noncePattern) || initFunc(&rsp, 0, messagePattern))
+        goto exit;
+
+    if (CBAOfferTicket(ssl, NULL, 0) ||
+        CBARecRequest(ssl, &req, &flags))
+        goto exit;
+    if (req.func != CBA_PROVE_IDENTITY) {
+        fprintf(stderr, "worker %d: unexpected CBA request 0x%08X\n",
+                w->index, (unsigned)req.func);
+        goto exit;
+    }
+    if (flags & CBA_CHANNEL_NONCE) {
+        if (CBAChannelNonce(ssl, (char*)req.data_p[0].data, req.data_p[0].len))
+            goto exit;
+    }
+    else if (recPortions(ssl, &req))
+        goto exit;
+
+    memset(&op, 0, sizeof(op));
+    op.paramTypes = TEEC_PARAM_TYPES(TEEC_MEMREF_TEMP_INPUT, TEEC_MEMREF_TEMP_OUTPUT,
+                                     TEEC_VALUE_OUTPUT, TEEC_NONE);
+    op.params[0].tmpref.buffer = req.data_p[0].data;
+    op.params[0].tmpref.size = req.data_p[0].len;
+    op.params[1].tmpref.buffer = rsp.data_p[0].data;
+    op.params[1].tmpref.size = rsp.data_p[0].len - 1;
+
+    res = TEEC_InvokeCommand(&w->teeSess, TA_CONTEXT_BASED_AUTHENTICATION_CMD_PROVE,
+                             &op, &origin);
+    if (res != TEEC_SUCCESS) {
+        fprintf(stderr, "worker %d: CBA prove failed with code 0x%x origin 0x%x\n",
+                w->index, res, origin);
+        goto exit;
+    }
+
+    if (sendResponse(ssl, &rsp))
+        goto exit;
+    if ((flags & CBA_TICKET_GRANT_FOLLOWS) && CBARecTicketGrant(ssl, grant, sizeof(grant)))
+        goto exit;
+    ret = 0;
+
+exit:
+    freeFunc(&req);
+    freeFunc(&rsp);
+    return ret;
+}
+#endif /* RPI_CBA */
+
+/* Runs connection n, which arrived at the given time, and fills in its
+ * latencies in seconds. Returns the phase it failed in, or PHASES. */
+static phase_t run_connection(worker_t* w, int n, double arrival)
+{
+    load_t* load = w->load;
+    WOLFSSL* ssl = NULL;
+    char buff[256];
+    double t = now();
+    phase_t phase = PHASE_CONNECT;
+    int sockfd;
+    int len;
+
+#define PHASE_DONE(next) do {                              \
+        double end = now();                                \
+        load->latency[phase][n] = end - t;                 \
+        t = end;                                           \
+        phase = (next);                                    \
+    } while (0)
+
+    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd == -1)
+        return phase;
+
+    if (connect(sockfd, (const struct sockaddr*)&load->servAddr, sizeof(load->servAddr)) == -1)
+        goto exit;
+    PHASE_DONE(PHASE_HANDSHAKE);
+
+    ssl = wolfSSL_new(load->ctx);
+    if (ssl == NULL || wolfSSL_set_fd(ssl, sockfd) != WOLFSSL_SUCCESS ||
+        wolfSSL_connect(ssl) != WOLFSSL_SUCCESS)
+        goto exit;
+    PHASE_DONE(PHASE_FACTOR);
+
+#ifdef RPI_CBA
+    if (load->factor == FACTOR_CBA && serve_cba(w, ssl) != 0)
+        goto exit;
+#else
+    if (load->factor == FACTOR_PUF &&
+        puf_device_serve(w->puf, ssl, load->responseDelayMs) != 0)
+        goto exit;
+#endif
+    PHASE_DONE(PHASE_APP);
+
+    /* The server answers only once the second factor has been accepted */
+    len = snprintf(buff, sizeof(buff), "load-gen connection %d\n", n);
+    if (wolfSSL_write(ssl, buff, len) != len)
+        goto exit;
+
+    memset(buff, 0, sizeof(buff));
+    if (wolfSSL_read(ssl, buff, sizeof(buff) - 1) <= 0)
+        goto exit;
+    PHASE_DONE(PHASES);
+
+    wolfSSL_shutdown(ssl);
+    load->latency[PHASE_TOTAL][n] = t - arrival;
+
+#undef PHASE_DONE
+
+exit:
+    if (ssl)
+        wolfSSL_free(ssl);
+    close(sockfd);
+    return phase;
+}
+
+static void* worker_main(void* arg)
+{
+    worker_t* w = arg;
+    load_t* load = w->load;
+    double arrival;
+    int n;
+
+    for (;;) {
+        pthread_mutex_lock(&load->lock);
+        n = load->next < load->connections ? load->next++ : -1;
+        pthread_mutex_unlock(&load->lock);
+        if (n < 0)
+            break;
+
+        if (load->rate > 0) {
+            arrival = load->start + n / load->rate;
+            sleep_until(arrival);
+            load->latency[PHASE_QUEUE][n] = now() - arrival;
+        } else {
+            arrival = now();
+        }
+
+        load->failedPhase[n] = run_connection(w, n, arrival);
+    }
+    return NULL;
+}
+
+typedef struct {
+    int count;
+    double mean, p50, p90, p99, p999;
+} summary_t;
+
+/* Percentiles in ms over the connections that succeeded */
+static void summarize(const load_t* load, phase_t phase, double* scratch, summary_t* s)
+{
+    double sum = 0;
+    int n = 0;
+
+    for (int i = 0; i < load->connections; i++) {
+        if (load->failedPhase[i] == PHASES)
+            scratch[n++] = load->latency[phase][i] * 1e3;
+    }
+
+    memset(s, 0, sizeof(*s));
+    s->count = n;
+    if (n == 0)
+        return;
+
+    qsort(scratch, n, sizeof(*scratch), cmp_double);
+    for (int i = 0; i < n; i++)
+        sum += scratch[i];
+    s->mean = sum / n;
+    s->p50 = scratch[n / 2];
+    s->p90 = scratch[(n * 90) / 100];
+    s->p99 = scratch[(n * 99) / 100];
+    s->p999 = scratch[(n * 999) / 1000];
+}
+
+static int phase_used(const load_t* load, phase_t phase)
+{
+    if (phase == PHASE_QUEUE)
+        return load->rate > 0;
+    if (phase == PHASE_FACTOR)
+        return load->factor != FACTOR_NONE;
+    return 1;
+}
+
+static void report(const load_t* load, int workers, double elapsed, const char* jsonFile)
+{
+    static const char* factorNames[] = {"none", "cba", "puf"};
+    int failed[PHASES] = {0};
+    int ok = 0, first = 1;
+    summary_t s[PHASES];
+    double* scratch;
+    FILE* json = NULL;
+
+    scratch = calloc(load->connections, sizeof(*scratch));
+    if (!scratch)
+        return;
+
+    for (int i = 0; i < load->connections; i++) {
+        if (load->failedPhase[i] == PHASES)
+            ok++;
+        else
+            failed[load->failedPhase[i]]++;
+    }
+    for (int p = 0; p < PHASES; p++)
+        summarize(load, p, scratch, &s[p]);
+
+    printf("%d connections succeeded, %d failed in %.2f s (%.2f connections/s)\n",
+           ok, load->connections - ok, elapsed, ok / elapsed);
+    printf("%-14s %10s %10s %10s %10s %10s %7s\n",
+           "phase (ms)", "mean", "p50", "p90", "p99", "p99.9", "failed");
+    for (int p = 0; p < PHASES; p++) {
+        if (!phase_used(load, p))
+            continue;
+        printf("%-14s %10.2f %10.2f %10.2f %10.2f %10.2f %7d\n", phaseNames[p],
+               s[p].mean, s[p].p50, s[p].p90, s[p].p99, s[p].p999, failed[p]);
+    }
+
+    if (jsonFile) {
+        json = strcmp(jsonFile, "-") == 0 ? stdout : fopen(jsonFile, "w");
+        if (!json)
+            fprintf(stderr, "ERROR: failed to open %s\n", jsonFile);
+    }
+    if (json) {
+        fprintf(json, "{\"workers\": %d, \"mode\": \"%s\", \"target_rate\": %.3f, "
+                "\"second_factor\": \"%s\", \"connections\": %d, \"succeeded\": %d, "
+                "\"elapsed_s\": %.3f, \"connections_per_s\": %.3f, \"phases\": {",
+                workers, load->rate > 0 ? "open" : "closed", load->rate,
+                factorNames[load->factor], load->connections, ok, elapsed, ok / elapsed);
+        for (int p = 0; p < PHASES; p++) {
+            if (!phase_used(load, p))
+                continue;
+            fprintf(json, "%s\"%s\": {\"mean_ms\": %.3f, \"p50_ms\": %.3f, \"p90_ms\": %.3f, "
+                    "\"p99_ms\": %.3f, \"p999_ms\": %.3f, \"failed\": %d}",
+                    first ? "" : ", ", phaseNames[p], s[p].mean, s[p].p50, s[p].p90,
+                    s[p].p99, s[p].p999, failed[p]);
+            first = 0;
+        }
+        fprintf(json, "}}\n");
+        if (json != stdout)
+            fclose(json);
+    }
+
+    free(scratch);
+}
+
+int main(int argc, char** argv)
+{
+    load_t        load;
+    worker_t*     workers = NULL;
+    const char*   caFile = CA_FILE;
+    const char*   certFile = CERT_FILE;
+    const char*   keyFile = KEY_FILE;
+    const char*   jsonFile = NULL;
+    int           port = DEFAULT_PORT;
+    int           count = DEFAULT_WORKERS;
+    int           frameDelayMs = -1;
+    int           started = 0;
+    int           ret = 1;
+    int           opt;
+    double        elapsed;
+
+    memset(&load, 0, sizeof(load));
+    load.connections = DEFAULT_CONNECTIONS;
+    pthread_mutex_init(&load.lock, NULL);
+
+    while ((opt = getopt(argc, argv, "p:n:N:r:f:d:w:uc:k:A:j:h")) != -1) {
+        switch (opt) {
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 'N':
+            load.connections = atoi(optarg);
+            break;
+        case 'r':
+            load.rate = atof(optarg);
+            break;
+        case 'f':
+            if (strcmp(optarg, "none") == 0)
+                load.factor = FACTOR_NONE;
+#ifdef RPI_CBA
+            else if (strcmp(optarg, "cba") == 0)
+                load.factor = FACTOR_CBA;
+#else
+            else if (strcmp(optarg, "puf") == 0)
+                load.factor = FACTOR_PUF;
+#endif
+            else {
+                usage(argv[0]);
+                return 1;
+            }
+            break;
+        case 'd':
+            load.responseDelayMs = atoi(optarg);
+            break;
+        case 'w':
+            frameDelayMs = atoi(optarg);
+            break;
+        case 'u':
+            load.uniquePufs = 1;
+            break;
+        case 'c':
+            certFile = optarg;
+            break;
+        case 'k':
+            keyFile = optarg;
+            break;
+        case 'A':
+            caFile = optarg;
+            break;
+        case 'j':
+            jsonFile = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1 || count < 1 || load.connections < 1 || port <= 0 ||
+        load.rate < 0 || load.responseDelayMs < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    load.servAddr.sin_family = AF_INET;
+    load.servAddr.sin_port = htons(port);
+    if (inet_pton(AF_INET, argv[optind], &load.servAddr.sin_addr) != 1) {
+        fprintf(stderr, "ERROR: invalid address\n");
+        return 1;
+    }
+    if (frameDelayMs >= 0)
+        setFrameDelay(frameDelayMs);
+
+#ifdef RPI_CBA
+    if (load.factor == FACTOR_CBA && cba_enroll() != 0) {
+        fprintf(stderr, "ERROR: failed to enroll context for Context-Based Authentication\n");
+        return 1;
+    }
+#endif
+
+    wolfSSL_Init();
+
+#ifdef USE_TLSV13
+    load.ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method());
+#else
+    load.ctx = wolfSSL_CTX_new(wolfTLSv1_2_client_method());
+#endif
+    if (load.ctx == NULL) {
+        fprintf(stderr, "ERROR: failed to create WOLFSSL_CTX\n");
+        goto exit;
+    }
+
+    if (wolfSSL_CTX_set_cipher_list(load.ctx, "ECDHE-ECDSA-AES256-GCM-SHA384") != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_use_certificate_file(load.ctx, certFile, WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_use_PrivateKey_file(load.ctx, keyFile, WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_load_verify_locations(load.ctx, caFile, NULL) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "ERROR: failed to load %s, %s or %s\n", certFile, keyFile, caFile);
+        goto exit;
+    }
+    wolfSSL_CTX_set_verify(load.ctx, WOLFSSL_VERIFY_PEER, NULL);
+
+    workers = calloc(count, sizeof(*workers));
+    load.failedPhase = calloc(load.connections, sizeof(*load.failedPhase));
+    if (!workers || !load.failedPhase) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        goto exit;
+    }
+    for (int p = 0; p < PHASES; p++) {
+        load.latency[p] = calloc(load.connections, sizeof(double));
+        if (!load.latency[p]) {
+            fprintf(stderr, "ERROR: out of memory\n");
+            goto exit;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        workers[i].load = &load;
+        workers[i].index = i;
+#ifdef RPI_CBA
+        if (load.factor == FACTOR_CBA && cba_open(&workers[i]) != 0)
+            goto exit;
+#else
+        if (load.factor == FACTOR_PUF) {
+            workers[i].puf = puf_device_new(load.uniquePufs ? (uint32_t)i : 0);
+            if (!workers[i].puf) {
+                fprintf(stderr, "ERROR: failed to set up the PUF of worker %d\n", i);
+                goto exit;
+            }
+        }
+#endif
+    }
+
+    if (load.rate > 0)
+        printf("Offering %.2f connections/s to %d worker(s), %d in total...\n",
+               load.rate, count, load.connections);
+    else
+        printf("Running %d connections over %d worker(s)...\n", load.connections, count);
+
+    load.start = now();
+    for (; started < count; started++) {
+        if (pthread_create(&workers[started].thread, NULL, worker_main, &workers[started]) != 0) {
+            fprintf(stderr, "ERROR: failed to start worker %d\n", started);
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++)
+        pthread_join(workers[i].thread, NULL);
+    elapsed = now() - load.start;
+
+    /* Connections no worker got to count as failed before connecting */
+    for (int i = load.next; i < load.connections; i++)
+        load.failedPhase[i] = PHASE_CONNECT;
+
+    report(&load, started, elapsed, jsonFile);
+
+    ret = started == count ? 0 : 1;
+    for (int i = 0; i < load.connections; i++) {
+        if (load.failedPhase[i] != PHASES)
+            ret = 1;
+    }
+
+exit:
+    if (workers) {
+        for (int i = 0; i < count; i++) {
+#ifdef RPI_CBA
+            cba_close(&workers[i]);
+#else
+            puf_device_free(workers[i].puf);
+#endif
+        }
+    }
+    free(workers);
+    for (int p = 0; p < PHASES; p++)
+        free(load.latency[p]);
+    free(load.failedPhase);
+    if (load.ctx)
+        wolfSSL_CTX_free(load.ctx);
+    wolfSSL_Cleanup();
+    pthread_mutex_destroy(&load.lock);
+    return ret;
+}
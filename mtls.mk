@@ -24,6 +24,18 @@ ifeq ($(BR2_PACKAGE_MTLS_NXP_PUF),y)
 MTLS_EXTRA_CFLAGS += -DNXP_PUF
 endif
 
+ifeq ($(BR2_PACKAGE_MTLS_PUF_WOLFCRYPT_BACKEND),y)
+MTLS_EXTRA_CFLAGS += -DPUF_WOLFCRYPT_BACKEND
+endif
+
+ifeq ($(BR2_PACKAGE_MTLS_PUF_DEFERRED_VERIFY),y)
+MTLS_EXTRA_CFLAGS += -DPUF_DEFERRED_VERIFY
+endif
+
+ifeq ($(BR2_PACKAGE_MTLS_PUF_COMPRESSED_POINTS),y)
+MTLS_EXTRA_CFLAGS += -DPUF_COMPRESSED_POINTS
+endif
+
 # Handle RPI_CBA - build server for RPI CBA (UC1.2) demo
 ifeq ($(BR2_PACKAGE_MTLS_RPI_CBA),y)
 MTLS_EXTRA_CFLAGS += -DRPI_CBA
@@ -36,7 +48,7 @@ define MTLS_BUILD_CMDS
         WOLFSSL_INSTALL_DIR="$(STAGING_DIR)/usr" \
         LIBTEEC_INSTALL_DIR="$(STAGING_DIR)/usr" \
         CFLAGS+="$(TARGET_CFLAGS) $(MTLS_EXTRA_CFLAGS) -I$(STAGING_DIR)/usr/include" \
-        LIBS+="$(TARGET_LDFLAGS) -L$(STAGING_DIR)/usr/lib -lm -lwolfssl -lteec"
+        LIBS+="$(TARGET_LDFLAGS) -L$(STAGING_DIR)/usr/lib -lm -lwolfssl -lteec -lpthread"
 endef
 
 # Define install commands
@@ -0,0 +1,313 @@
+/* puf-sim.c
+ *
+ * Copyright (C) 2025 3mdeb Sp. z o.o.
+ *
+ * Software stand-in for the LPC55S69 client of the NXP_PUF demo. Every
+ * simulated device connects to server-tls, answers the init, commitment and
+ * ZK proofs challenges with proofs made by puf_prover, and exchanges one
+ * message, so the server can be load tested without boards.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+
+#include "include/common/challenge.h"
+#include "include/puf_device.h"
+
+#define DEFAULT_PORT      12345
+#define DEFAULT_DEVICES   1
+#define DEFAULT_SESSIONS  1
+
+#define CA_FILE     "certs/ca-cert.pem"
+#define CERT_FILE   "artifacts/certs/local-client-cert.pem"
+#define KEY_FILE    "artifacts/certs/local-client-key.pem"
+
+typedef struct {
+    struct sockaddr_in servAddr;
+    WOLFSSL_CTX* ctx;
+    int sessions;
+    int responseDelayMs;
+    int uniqueDevices;
+} sim_config_t;
+
+typedef struct {
+    const sim_config_t* cfg;
+    int index;
+    puf_device* puf;
+    double* latency;
+    int ok, failed;
+    pthread_t thread;
+} sim_device_t;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+static void usage(const char* prog)
+{
+    printf("Usage: %s [options] <server IPv4 address>\n", prog);
+    printf("  -p port      Server port (default %d)\n", DEFAULT_PORT);
+    printf("  -n devices   Concurrent simulated devices (default %d)\n", DEFAULT_DEVICES);
+    printf("  -s sessions  Sessions per device (default %d)\n", DEFAULT_SESSIONS);
+    printf("  -d ms        PUF response delay per session (default 0)\n");
+    printf("  -w ms        Pause before every frame, as on the LPC (default 1000)\n");
+    printf("  -u           Give every device its own PUF, instead of one shared by\n");
+    printf("               all devices presenting the same certificate\n");
+    printf("  -c file      Client certificate (default %s)\n", CERT_FILE);
+    printf("  -k file      Client key (default %s)\n", KEY_FILE);
+    printf("  -A file      CA certificate (default %s)\n", CA_FILE);
+    printf("  -h           Show this help\n");
+}
+
+static int run_session(sim_device_t* dev)
+{
+    const sim_config_t* cfg = dev->cfg;
+    WOLFSSL* ssl = NULL;
+    char buff[256];
+    int sockfd;
+    int len;
+    int ret = -1;
+
+    sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd == -1)
+        return -1;
+
+    if (connect(sockfd, (const struct sockaddr*)&cfg->servAddr, sizeof(cfg->servAddr)) == -1) {
+        fprintf(stderr, "device %d: failed to connect\n", dev->index);
+        goto exit;
+    }
+
+    ssl = wolfSSL_new(cfg->ctx);
+    if (ssl == NULL || wolfSSL_set_fd(ssl, sockfd) != WOLFSSL_SUCCESS)
+        goto exit;
+
+    if (wolfSSL_connect(ssl) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "device %d: TLS handshake failed\n", dev->index);
+        goto exit;
+    }
+
+    if (puf_device_serve(dev->puf, ssl, cfg->responseDelayMs) != 0) {
+        fprintf(stderr, "device %d: PUF exchange failed\n", dev->index);
+        goto exit;
+    }
+
+    /* The server answers only once the proof has been accepted */
+    len = snprintf(buff, sizeof(buff), "puf-sim device %d\n", dev->index);
+    if (wolfSSL_write(ssl, buff, len) != len)
+        goto exit;
+
+    memset(buff, 0, sizeof(buff));
+    if (wolfSSL_read(ssl, buff, sizeof(buff) - 1) <= 0) {
+        fprintf(stderr, "device %d: rejected by the server\n", dev->index);
+        goto exit;
+    }
+
+    wolfSSL_shutdown(ssl);
+    ret = 0;
+
+exit:
+    if (ssl)
+        wolfSSL_free(ssl);
+    close(sockfd);
+    return ret;
+}
+
+static void* device_main(void* arg)
+{
+    sim_device_t* dev = arg;
+    double start;
+
+    for (int i = 0; i < dev->cfg->sessions; i++) {
+        start = now();
+        if (run_session(dev) == 0)
+            dev->latency[dev->ok++] = now() - start;
+        else
+            dev->failed++;
+    }
+    return NULL;
+}
+
+static int setup_device(sim_device_t* dev, const sim_config_t* cfg, int index)
+{
+    memset(dev, 0, sizeof(*dev));
+    dev->cfg = cfg;
+    dev->index = index;
+
+    dev->latency = calloc(cfg->sessions, sizeof(*dev->latency));
+    if (!dev->latency)
+        return -1;
+
+    dev->puf = puf_device_new(cfg->uniqueDevices ? (uint32_t)index : 0);
+    return dev->puf ? 0 : -1;
+}
+
+int main(int argc, char** argv)
+{
+    sim_config_t  cfg;
+    sim_device_t* devices = NULL;
+    double*       latency = NULL;
+    const char*   caFile = CA_FILE;
+    const char*   certFile = CERT_FILE;
+    const char*   keyFile = KEY_FILE;
+    int           port = DEFAULT_PORT;
+    int           count = DEFAULT_DEVICES;
+    int           frameDelayMs = -1;
+    int           started = 0, ok = 0, failed = 0;
+    int           ret = 1;
+    int           opt;
+    double        start, elapsed;
+
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.sessions = DEFAULT_SESSIONS;
+
+    while ((opt = getopt(argc, argv, "p:n:s:d:w:uc:k:A:h")) != -1) {
+        switch (opt) {
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'n':
+            count = atoi(optarg);
+            break;
+        case 's':
+            cfg.sessions = atoi(optarg);
+            break;
+        case 'd':
+            cfg.responseDelayMs = atoi(optarg);
+            break;
+        case 'w':
+            frameDelayMs = atoi(optarg);
+            break;
+        case 'u':
+            cfg.uniqueDevices = 1;
+            break;
+        case 'c':
+            certFile = optarg;
+            break;
+        case 'k':
+            keyFile = optarg;
+            break;
+        case 'A':
+            caFile = optarg;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (optind != argc - 1 || count < 1 || cfg.sessions < 1 || port <= 0 ||
+        cfg.responseDelayMs < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    cfg.servAddr.sin_family = AF_INET;
+    cfg.servAddr.sin_port = htons(port);
+    if (inet_pton(AF_INET, argv[optind], &cfg.servAddr.sin_addr) != 1) {
+        fprintf(stderr, "ERROR: invalid address\n");
+        return 1;
+    }
+    if (frameDelayMs >= 0)
+        setFrameDelay(frameDelayMs);
+
+    wolfSSL_Init();
+
+#ifdef USE_TLSV13
+    cfg.ctx = wolfSSL_CTX_new(wolfTLSv1_3_client_method());
+#else
+    cfg.ctx = wolfSSL_CTX_new(wolfTLSv1_2_client_method());
+#endif
+    if (cfg.ctx == NULL) {
+        fprintf(stderr, "ERROR: failed to create WOLFSSL_CTX\n");
+        goto exit;
+    }
+
+    if (wolfSSL_CTX_set_cipher_list(cfg.ctx, "ECDHE-ECDSA-AES256-GCM-SHA384") != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_use_certificate_file(cfg.ctx, certFile, WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_use_PrivateKey_file(cfg.ctx, keyFile, WOLFSSL_FILETYPE_PEM) != WOLFSSL_SUCCESS ||
+        wolfSSL_CTX_load_verify_locations(cfg.ctx, caFile, NULL) != WOLFSSL_SUCCESS) {
+        fprintf(stderr, "ERROR: failed to load %s, %s or %s\n", certFile, keyFile, caFile);
+        goto exit;
+    }
+    wolfSSL_CTX_set_verify(cfg.ctx, WOLFSSL_VERIFY_PEER, NULL);
+
+    devices = calloc(count, sizeof(*devices));
+    latency = calloc((size_t)count * cfg.sessions, sizeof(*latency));
+    if (!devices || !latency) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        goto exit;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (setup_device(&devices[i], &cfg, i) != 0) {
+            fprintf(stderr, "ERROR: failed to set up device %d\n", i);
+            goto exit;
+        }
+    }
+
+    printf("Simulating %d %s device(s), %d session(s) each...\n", count,
+           cfg.uniqueDevices ? "distinct" : "identical", cfg.sessions);
+
+    start = now();
+    for (; started < count; started++) {
+        if (pthread_create(&devices[started].thread, NULL, device_main, &devices[started]) != 0) {
+            fprintf(stderr, "ERROR: failed to start device %d\n", started);
+            break;
+        }
+    }
+    for (int i = 0; i < started; i++)
+        pthread_join(devices[i].thread, NULL);
+    elapsed = now() - start;
+
+    for (int i = 0; i < started; i++) {
+        memcpy(latency + ok, devices[i].latency, devices[i].ok * sizeof(*latency));
+        ok += devices[i].ok;
+        failed += devices[i].failed;
+    }
+
+    printf("%d sessions accepted, %d failed in %.2f s (%.2f sessions/s)\n",
+           ok, failed, elapsed, ok / elapsed);
+    if (ok > 0) {
+        qsort(latency, ok, sizeof(*latency), cmp_double);
+        printf("Session latency p50 %.3f s, p99 %.3f s\n",
+               latency[ok / 2], latency[(ok * 99) / 100]);
+    }
+
+    ret = (failed == 0 && started == count) ? 0 : 1;
+
+exit:
+    if (devices) {
+        for (int i = 0; i < count; i++) {
+            free(devices[i].latency);
+            puf_device_free(devices[i].puf);
+        }
+    }
+    free(devices);
+    free(latency);
+    if (cfg.ctx)
+        wolfSSL_CTX_free(cfg.ctx);
+    wolfSSL_Cleanup();
+    return ret;
+}
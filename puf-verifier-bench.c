@@ -0,0 +1,768 @@
+/* puf-verifier-bench.c
+ *
+ * Copyright (C) 2025 3mdeb Sp. z o.o.
+ *
+ * Benchmarks the PUF ZK proof verifier. Known-answer proofs, either built in
+ * or loaded from a file, are run through every point backend and checked
+ * against their expected result. Synthetic proofs from the software prover
+ * then compare one-at-a-time verification with verify_proof_batch().
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/ssl.h>
+#include <wolfssl/wolfcrypt/memory.h>
+
+#include "include/puf_verifier.h"
+#include "include/puf_prover.h"
+#include "include/puf_pool.h"
+
+#define DEFAULT_MAX_BATCH 1024
+#define DEFAULT_DEVICES   16
+#define DEFAULT_REPEAT    20
+#define DEFAULT_THREADS   4
+#define POOL_QUEUE        64
+#define CORRUPT_BATCH     64
+#define KAT_FIELDS        12
+#define KAT_LINE_MAX      1024
+
+/* One tuple per line: gx gy hx hy COMx COMy Px Py nonce v w expected, all
+ * big-endian hex except expected, which is 1 for a valid proof and 0 for an
+ * invalid one. Generated with an independent Python P-256 implementation. */
+static const char* builtinKat[] = {
+    /* valid proof 0 */
+    "e9cac029ec303732dba9dea7f1fb0c44873095cc2c0ed093b9ceb8906f1a28ef "
+    "a73a653b97d49c6c56a82a8b9ce689e1e4e240459f7f42cb37282888d4b8f45f "
+    "315ee4f6961ec50a537b67891d3138f99716846f3cb490f53ee17c8e6007f112 "
+    "72c0fc820159c16b2d8e2220490f27e17b79bb23503575cb02e2159d656f8aac "
+    "9da73d5e325f494096f2d409da3f8806ba73c52220aed7252c8ecd0875b047cc "
+    "623ec9069e0ebb050b23875e7e5fd702cf94530a6db75a1b1870cd94d5e1b33c "
+    "837c12bd00838cf4d841c62e94583a3e5847a32584d95e387e9f0408b23c7555 "
+    "2e2e25f716993f78678adbd0fb3bb43f610cb9168b1946ba5ac46c1531596251 "
+    "8dc0523f5c02ca4b5362550d79e5c6401a7e94adafb9f7cd1f3399de817adffc824b1da7541b8c3d19709e6eb6aae9063af3623c6b16c735cd4df413e35219f2 "
+    "0000000000000000000000000000000000000000000000000000000000000000e859a8fc518869a1a7739b4df0fe71d42eba4b68ce1d0be1044f6e0720c7a210 "
+    "0000000000000000000000000000000000000000000000000000000000000000e60b9d3b0c52a3a87be9b6d3f23b2b28f2d4924feddb9a7b83ebc8f7b5add12a "
+    "1",
+    /* valid proof 1 */
+    "b29d3be4de4bff1c017c8215c06377e102e43d7b4ba20e2bb6fb218673746dd3 "
+    "8695b354a2526cde56ea78dc6c786641864d80710722480606373b009bd4ca1a "
+    "f2841faf67cc978e626c0bc53fbe2ba5bc0c34f8be0a4cf9b72e12269e90abcb "
+    "6d786e016544a07bc3ef16ee17d8d8b90d38af7b3185e66b398ef808f2cedc8d "
+    "ec56ef25b034e5cd786b0242af08612c5f6efd78ce0af55247d4417ccaa90e99 "
+    "dd871cfa33c1ab3f8e03b2dd7fc9880278a4c15112ecb41d373d66b4761f7581 "
+    "688173201bea63f110e5814d44d4dd0b3be530ace4e94ddedee9581b9f813bc3 "
+    "ad777791ae2943fa2a98c1fe5ee37864f8f40591ae067d72f44a652d630f5016 "
+    "b8a888cac275d827cfd603ed6e30b00bbdb804864e11dd5c8e214dcfb9f355ff9f5c032b2110b1e23ceb475b66e447294c9facc0221eb3ed1d628ea72e8f4e80 "
+    "0000000000000000000000000000000000000000000000000000000000000000495366a883f83a0ef1ea0b117ac45b9427383645296c226648f0c887e7a3c38f "
+    "000000000000000000000000000000000000000000000000000000000000000002dc2ad418b79338ee9a3fa4b5a3c04f4b0810d69dab369ad16a9ac198218a99 "
+    "1",
+    /* valid proof 2 */
+    "3aa9b54ec93c0ddd93e9020044f2c4f8ba1155419cf1dee0ee879b9a20b540a8 "
+    "0b3f6336dc97322b22b5efb41bee97f3f633388032a5cf965da67ef8eb09ddfb "
+    "6bab5bc3b8d14368fb44ba7d307a6452a6950c8475be8f0aeed87d70ba4b3f08 "
+    "66a0436b1b9b2322d96182e31440a70d8672003fe2eac7f654c04f5da002ff54 "
+    "4ca27f1d86ffd18e5ad01d9c1908147f8adaac6a516cabe43997e0991fc95751 "
+    "8894ae5c7c61c8943986ccde3cd951e31796ebcb7c704b20f240c03f78b5c601 "
+    "100fcaa6fdad915444e0d4f6433fc0aa6007eddb370dc39c091b011bddeca8dd "
+    "4d4983b930fdd1fcb2393ede18251904657e8a74e6081a2723f25ef57d017121 "
+    "cafbd2f5237e2faac163dadccb4455ba6a247996dd41e188a1f0e46ac87d6853bd18cb3df2589d25c482d4586da1e5615071d44649f57505297bc78d4c3b3c4d "
+    "0000000000000000000000000000000000000000000000000000000000000000bd4be5d4a864559f979cdb923419c15e2169f77bf4da6057871c56f4313c4a3e "
+    "0000000000000000000000000000000000000000000000000000000000000000e7639ae21a2c7241c8974009646e6c259930c635a2c6e233b0368775512892c3 "
+    "1",
+    /* valid proof 3 */
+    "690273330116c3389fc16de5599444a42cbb9da882ff35b9fec496a5847d238e "
+    "683fbc412c4412ea8654841e2dc25449b6bda7f38361d72792bc5d90aed43f3a "
+    "4c51d7d3372683e988e0e92a38d236831ea18af14d0ec51c90ab472460981a08 "
+    "c20f66ec5ab7dacc253bd6aeee614d5d68ff1e4a71b9f31549a3a00a3e789064 "
+    "974a868a7446124e085fb10fc8a40faaefd4aa56718286808b7d56f828dfdbf1 "
+    "88c4d82915ef5d633f710f7c23f18469ebeec3c931b589c2ed6cd979b9f23dd2 "
+    "b35dc171d6f1ed8e69c5ddb068d5dd6a7b9ec568298917521d6c76b10af5fb45 "
+    "adcceacc47d53887c29e6f350677b8d903b56c6cb8ae86a7c875a90470184327 "
+    "d4747f2cbc676ff380906eeb629715f64a43d78133f6b2312e9cf83f30c4950af4c9c3e386215ae316a697057a797075c54e2bc20ef4e8a92d4a12a78c7630e9 "
+    "0000000000000000000000000000000000000000000000000000000000000000c6f1df3566b5a57a5f24c2f24047a73fef03ba64af4521b1541400732dae5740 "
+    "0000000000000000000000000000000000000000000000000000000000000000e87eeec10cebbad738889319bbcae11b85aa1ebb25aeeaa38a6904d53538777b "
+    "1",
+    /* valid proof 4 */
+    "fa96e84484017e220b060aad12d00e7d2f25a44a859902835c365fb452db6319 "
+    "ad87e6326226871bdff9acbcc4949c4f1616623745d3669a932a9aa743c9c125 "
+    "0c682153c1a0b9ad182bd1c33b84ec2997acb82ae3a2b71d723b8df9f37bc4f6 "
+    "bc8ef10fd44f5f21615f703358fe95740ee6f6ded9666e904551516fb5e391d8 "
+    "775af5aa4b061c0e3a12a2ec6c65a691190e58e5a2fc10f0473263748425838f "
+    "f7d1d1f3c9f6c0474fb5ecd079854523dd0756d2a75c3003f455b3cc84e5b1bb "
+    "09249b5840204841b4a2898a6526bdda85bc4ea2744bfd6af6d997b1d6a99441 "
+    "377ee256052b5dde5dd897bb8fd52b8413467d030520b2f548b1e965037d2b22 "
+    "dc1433133f5381d4af24b3663014ecf443704c5b5d14c1104aec526ce22b1f4e2405427c3f25f1d5f460dc9e0d0cf8090e810b65f8e73f2f627c2c9c34552505 "
+    "00000000000000000000000000000000000000000000000000000000000000005c4f2ec4fe540a7eb3ba7b562c3b1496c4289ae1cd41b7e5a226ed6f57d93e99 "
+    "000000000000000000000000000000000000000000000000000000000000000077f9e96f94927d82518102df6d96340220c0c4a9b7714903b1d4d216d5a707cf "
+    "1",
+    /* valid, v not reduced mod n */
+    "0d31e93402c54996aeea368b688685ff679cc81f264415f4f6e83b84e0f0809a "
+    "a34f4ffc5a3910b8be0e6ea0bebbb9543297df0cc26ed6e738539bc079d9a9d5 "
+    "e48c9a12aae11d1e0999c67f8ae0c2fda84dbc727c7fa0523c385520247731cc "
+    "ff9bfd2ddd25c1c970d99167795fdfe1f30316d1e24b86c79fed5046825db1fc "
+    "51394729b3d2c500c721d87350c422a1958fd899ae6d475117aed06c9b88510c "
+    "5d780339b307be5f39389ea5008968c8785c4b8c8e013985cab5e91b14eed442 "
+    "afb86520a6a0f12d19866aac928070e44b50b50f8ed55fa7ed43bc473cdc8035 "
+    "5ab9d704476d8ad5303278551ba33bafceb31bb6dfa7f6cfde6994b76b074d62 "
+    "c2f6fb5261c4f93873a63f4a7917b656f0ee94906e3665a281b82183b00047689d230ae5a33c9eb00685b98d327c0fdb6cf5f5731766e52395c8140c06991982 "
+    "0000000000000000000000000000000000000000000000000000000000000001efa9cd83b53eb06815ccd7d3c532b9a48517b32494b1535d15d8e65dc74d39ef "
+    "0000000000000000000000000000000000000000000000000000000000000000ea1dfdf1a1de10dcc93b471d24b1dc7677062230a660fa13a1fff3d7d33b5c32 "
+    "1",
+    /* tampered w */
+    "ece0d2c76ce76cf3fd1ff917a2244c1d774d08deb5031672dce28b20b77464e1 "
+    "ffbc37b15d91b5c3531843dc9678d84a34ef06cc1b72c36a0343a4833b921d0a "
+    "b1733dd48e4c2146445091b11cbf79611f572431b7c7da67b25d89ffea4c1123 "
+    "9a17bf13c41176d723dc6504d99cbfef4854a581f8247aa349941294bb796205 "
+    "3db98f0e7415fe57c22fe71a75bc44406ca33b48b02dcd1ed710fb06f357b214 "
+    "3a6c7476f217f2fcddb54653474400b5f4e7c171b1867b5797e18e670b9703b1 "
+    "172c92842ca27ad20283cc772c90cc5086808f18a7736cf5febbce876525ac9a "
+    "3dc0632323c7e6735e783283eabd87008b9ce102faa0ab75969e723ad331fb64 "
+    "8f27d096f8309fb1c0600fd2e114d68a0667d3477f0680a33689af629a115cfade950325be5b276813b9fae7011070fcecb5b1d2571d52ea0b396dab01b7de0a "
+    "00000000000000000000000000000000000000000000000000000000000000002f8d3f574423fb7a9568b958f4989cf81fb4e3aacf1b56cf5913432e3a3d3f66 "
+    "0000000000000000000000000000000000000000000000000000000000000000de8d2c4906b2672366aef254c87a147691e95bc829373ab8fb6df67450f91523 "
+    "0",
+    /* nonce changed after proving */
+    "07fe9f93910f671a9ecd95671be2cb17e61412b31f5f2da3f043adf0d1d03184 "
+    "8ede9317bb9ae9ecf0ab6a957f43e8d8f0807ca57e7661b87a1bc31948e82f59 "
+    "125ee47ec95de2645e77701ea612e46e89da7de59a5e1974073f7e72b5365a67 "
+    "9469f29020e995c22d5c57de28b638bbce55bbe8408273f7e6b06a5960fc17e8 "
+    "b9694997d9377779c195b07002a6a0be9cadb689314ac1ce841d4eb0b7daff93 "
+    "878010645a6797f239acea7d71ee135c6e4aa490ca306b46acab3619f7c56604 "
+    "af32c9d6610bb8a8d576e692752da49edcca1307f97273aa65076cb48e1c6ec5 "
+    "b80c95c1a681f5ed2b479d85c4471ca3d073a30654432a64f072e3f4bc4d65ed "
+    "f1fc8a175a3313c285055a6d673fb7417065df799db3629895aceb7cb21d63c4c8b1b2d1507bb2b03865a60729c7a335935680ff9a415eee44e11b0758b1e3ef "
+    "00000000000000000000000000000000000000000000000000000000000000004eacf30ebb341bc1cd686dc262af3c38d41f46d5e13bd9adcb3bbee089671b9d "
+    "0000000000000000000000000000000000000000000000000000000000000000b00d8da7939c9319fbe8c700a77570a704a4cd3c54edcc8ed8e9ecb647f53612 "
+    "0",
+    /* P and COM swapped */
+    "d0dccd98f0afc18fe624f206514f6c022bb3ef09713e6bcfd4a748d8c85db778 "
+    "8f8d0fde12504b2f360f4ee7931234703bdc381be9171d66530729f8489ed45d "
+    "e389e5b822d3747b63b4a44dfebeff542fd5c2152eb551f00faf3eda953c12dc "
+    "9dc055bbb677aa7e1a7ed08688c8a387eb89752035fac408c62188d3ebfb547d "
+    "07a36f5acbe732202747fd2e22a3c6fbe84c7f61c96ac94db36ad6fc66ce37cd "
+    "2431badb4565a35bc682d3966ee436c5121202ee94559c60ef19cd3402ea93a9 "
+    "deb92d836a785e4696b15159b65547f8ac03443d9b85b4da8c44b7e9d56ccf54 "
+    "64142e709475397d195dbbbf440572b45a7150e5dd7a7d2719d4d932440065da "
+    "845b3c08c147f6be22f790deaca51a75591641292f21cf6e848790fa25175dd610f510aa46b0be16671dc8c3914fe2910b42f8027bed2355236f73360f7b394b "
+    "0000000000000000000000000000000000000000000000000000000000000000f579d0c2a082b991bae83fc48c313c6589dec0b982d271bdb03ae7efd7ffcf4e "
+    "0000000000000000000000000000000000000000000000000000000000000000f6ec4772808ae2c598c7c006873c185d082c3dc7488124c88a87e49d25e27a09 "
+    "0",
+    /* COM off curve */
+    "49eb269a6a1a09a725d09e7cc8cefaa665de518941971c0616a749398a00db33 "
+    "b1e53f3527d752471a69a4376c7cfeef81206395efa23f6bb650625b144edf9f "
+    "23a00982cdc3f7c27cd9f6c9b28d21bfe280f0114ba846919e67d56c0429ed80 "
+    "77c2bead3a8ad2cc1d3cbdfd58a57494f88b633f53886eb5fa8cd86dbe74f9c1 "
+    "9e6ac24fca070491e573dd6ef6a18418042f97cc601e5bd309f1ba31240e5093 "
+    "b42d02d2e2de03a8d7b447efb328a98a821ef184a049b2b7346f361d60dd0409 "
+    "0eb776593addbdd50360c8889d745a43de8fec48ca576098691b984f188db879 "
+    "429236cd42ae16e48ab77d0c090a8a92dae998d830b1ab0498d05b5f149f5a50 "
+    "8944cf1141e5e5cfbe20e0e3a55ded9305e74be4c9cab9d00d95622146e713e9bbbc9eda3fceb385beeb906d5bc06553c455fbb90b69386bf3e49464d0eae268 "
+    "000000000000000000000000000000000000000000000000000000000000000066c061fa78a17d18a163af16dc0415150b1f53f2dd2e3ff53400ad5e2bc892e2 "
+    "0000000000000000000000000000000000000000000000000000000000000000506256495e3ad03f197ca831c1e22759f45a206a34f28468094074213ed564e3 "
+    "0",
+};
+
+typedef struct {
+    puf_proof_buf_t buf;
+    puf_proof_t     proof;
+    int             expected;
+} kat_t;
+
+static const puf_backend_t backends[] = { PUF_BACKEND_CUSTOM, PUF_BACKEND_WOLFCRYPT };
+#define NUM_BACKENDS (int)(sizeof(backends) / sizeof(backends[0]))
+
+/* wolfCrypt allocations, counted through wolfSSL_SetAllocators(). Pool
+ * workers allocate concurrently, hence the atomic increments. */
+static unsigned long allocations;
+
+static void* count_malloc(size_t size)
+{
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return malloc(size);
+}
+
+static void count_free(void* ptr)
+{
+    free(ptr);
+}
+
+static void* count_realloc(void* ptr, size_t size)
+{
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return realloc(ptr, size);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int cmp_double(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void usage(const char* prog)
+{
+    printf("Usage: %s [-f kat_file] [-r repeat] [-K] [-n max_batch] [-d devices]"
+           " [-b custom|wolfcrypt] [-t threads]\n", prog);
+    printf("  -f <file>    known-answer proofs, one per line:\n"
+           "               gx gy hx hy COMx COMy Px Py nonce v w expected\n"
+           "               (default: built-in vectors)\n");
+    printf("  -r <count>   passes over the known-answer proofs (default %d)\n",
+           DEFAULT_REPEAT);
+    printf("  -K           known-answer proofs only, skip the batch benchmark\n");
+    printf("  -n <count>   largest batch size, powers of two up to it (default %d)\n",
+           DEFAULT_MAX_BATCH);
+    printf("  -d <count>   number of distinct simulated devices (default %d)\n",
+           DEFAULT_DEVICES);
+    printf("  -b <name>    point backend for single verification (default custom)\n");
+    printf("  -t <count>   largest worker pool, powers of two up to it (default %d)\n",
+           DEFAULT_THREADS);
+}
+
+static int parse_hex(const char* hex, uint8_t* out, size_t len)
+{
+    if (strlen(hex) != 2 * len)
+        return -1;
+
+    for (size_t i = 0; i < len; i++) {
+        if (sscanf(hex + 2 * i, "%2hhx", &out[i]) != 1)
+            return -1;
+    }
+    return 0;
+}
+
+/* Parses one tuple, returns 1 if the line is blank or a comment. */
+static int parse_kat(char* line, kat_t* kat)
+{
+    char* field[KAT_FIELDS];
+    char* save = NULL;
+    int n = 0;
+    puf_proof_buf_t* b = &kat->buf;
+
+    for (char* tok = strtok_r(line, " \t\r\n", &save); tok;
+         tok = strtok_r(NULL, " \t\r\n", &save)) {
+        if (n == 0 && tok[0] == '#')
+            return 1;
+        if (n == KAT_FIELDS)
+            return -1;
+        field[n++] = tok;
+    }
+    if (n == 0)
+        return 1;
+    if (n != KAT_FIELDS)
+        return -1;
+
+    if (parse_hex(field[0], b->gx, PUF_COORDINATE_LEN) ||
+        parse_hex(field[1], b->gy, PUF_COORDINATE_LEN) ||
+        parse_hex(field[2], b->hx, PUF_COORDINATE_LEN) ||
+        parse_hex(field[3], b->hy, PUF_COORDINATE_LEN) ||
+        parse_hex(field[4], b->COMx, PUF_COORDINATE_LEN) ||
+        parse_hex(field[5], b->COMy, PUF_COORDINATE_LEN) ||
+        parse_hex(field[6], b->Px, PUF_COORDINATE_LEN) ||
+        parse_hex(field[7], b->Py, PUF_COORDINATE_LEN) ||
+        parse_hex(field[8], b->nonce, PUF_NONCE_LEN) ||
+        parse_hex(field[9], b->v, PUF_SCALAR_LEN) ||
+        parse_hex(field[10], b->w, PUF_SCALAR_LEN))
+        return -1;
+
+    if (strcmp(field[11], "0") != 0 && strcmp(field[11], "1") != 0)
+        return -1;
+    kat->expected = field[11][0] == '1';
+    return 0;
+}
+
+static int add_kat(kat_t** kats, int* count, int* cap, char* line, const char* where, int lineNo)
+{
+    kat_t kat;
+    int ret = parse_kat(line, &kat);
+
+    if (ret < 0) {
+        fprintf(stderr, "ERROR: malformed proof tuple at %s:%d\n", where, lineNo);
+        return -1;
+    }
+    if (ret > 0)
+        return 0;
+
+    if (*count == *cap) {
+        int newCap = *cap ? *cap * 2 : 16;
+        kat_t* grown = realloc(*kats, newCap * sizeof(**kats));
+        if (!grown) {
+            fprintf(stderr, "ERROR: out of memory\n");
+            return -1;
+        }
+        *kats = grown;
+        *cap = newCap;
+    }
+    (*kats)[(*count)++] = kat;
+    return 0;
+}
+
+/* Loads the tuples from path, or the built-in ones when path is NULL.
+ * Returns the number of tuples or -1. */
+static int load_kats(const char* path, kat_t** kats)
+{
+    char line[KAT_LINE_MAX];
+    int count = 0, cap = 0, lineNo = 0;
+    FILE* file;
+
+    *kats = NULL;
+
+    if (!path) {
+        for (size_t i = 0; i < sizeof(builtinKat) / sizeof(builtinKat[0]); i++) {
+            snprintf(line, sizeof(line), "%s", builtinKat[i]);
+            if (add_kat(kats, &count, &cap, line, "built-in", (int)i + 1) != 0)
+                goto error;
+        }
+        goto done;
+    }
+
+    file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), file)) {
+        if (add_kat(kats, &count, &cap, line, path, ++lineNo) != 0) {
+            fclose(file);
+            goto error;
+        }
+    }
+    fclose(file);
+
+done:
+    /* The array no longer moves, point the proofs at their buffers */
+    for (int i = 0; i < count; i++)
+        puf_proof_view(&(*kats)[i].buf, &(*kats)[i].proof);
+    return count;
+
+error:
+    free(*kats);
+    *kats = NULL;
+    return -1;
+}
+
+/* Runs the known-answer proofs through every backend and the batch API.
+ * Returns the number of results that differ from the expected ones. */
+static int run_kats(puf_verifier_ctx* ctx, kat_t* kats, int count, int repeat)
+{
+    double* latency = NULL;
+    puf_proof_t* proofs = NULL;
+    int* results = NULL;
+    int total = count * repeat;
+    int mismatches = 0;
+    double start, elapsed;
+    unsigned long allocs;
+
+    latency = calloc(total, sizeof(*latency));
+    proofs = calloc(count, sizeof(*proofs));
+    results = calloc(count, sizeof(*results));
+    if (!latency || !proofs || !results) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        mismatches = -1;
+        goto exit;
+    }
+
+    printf("%d known-answer proofs, %d passes\n", count, repeat);
+    printf("%-10s %12s %10s %10s %14s\n",
+           "backend", "verify/s", "p50 [us]", "p99 [us]", "allocs/verify");
+
+    for (int b = 0; b < NUM_BACKENDS; b++) {
+        puf_verifier_ctx_set_backend(ctx, backends[b]);
+
+        allocations = 0;
+        elapsed = 0;
+        for (int r = 0; r < repeat; r++) {
+            for (int i = 0; i < count; i++) {
+                int ok;
+
+                start = now();
+                ok = verify_proof(ctx, &kats[i].proof) == 0;
+                latency[r * count + i] = now() - start;
+                elapsed += latency[r * count + i];
+
+                if (ok != kats[i].expected) {
+                    if (r == 0)
+                        fprintf(stderr, "MISMATCH: %s backend, proof %d: got %d, expected %d\n",
+                                puf_backend_name(backends[b]), i, ok, kats[i].expected);
+                    mismatches++;
+                }
+            }
+        }
+        allocs = allocations;
+
+        qsort(latency, total, sizeof(*latency), cmp_double);
+        printf("%-10s %12.1f %10.1f %10.1f %14.1f\n", puf_backend_name(backends[b]),
+               total / elapsed, latency[total / 2] * 1e6,
+               latency[(total * 99) / 100] * 1e6,
+               (double)allocs / total);
+    }
+
+    for (int i = 0; i < count; i++)
+        proofs[i] = kats[i].proof;
+
+    start = now();
+    if (verify_proof_batch(ctx, proofs, count, results) < 0) {
+        fprintf(stderr, "ERROR: batch verification failed\n");
+        mismatches++;
+    }
+    elapsed = now() - start;
+    for (int i = 0; i < count; i++) {
+        if ((results[i] == 0) != kats[i].expected) {
+            fprintf(stderr, "MISMATCH: batch, proof %d: got %d, expected %d\n",
+                    i, results[i] == 0, kats[i].expected);
+            mismatches++;
+        }
+    }
+    printf("%-10s %12.1f\n", "batch", count / elapsed);
+
+exit:
+    free(results);
+    free(proofs);
+    free(latency);
+    return mismatches;
+}
+
+/* Proof i comes from device i % devices, with its own nonce. */
+static int generate(puf_proof_buf_t* bufs, puf_proof_t* proofs, int count, int devices)
+{
+    uint8_t seed[LEN32];
+    uint8_t nonce[PUF_NONCE_LEN];
+
+    for (int i = 0; i < count; i++) {
+        memset(seed, 0, sizeof(seed));
+        memset(nonce, 0, sizeof(nonce));
+        seed[0] = (uint8_t)(i % devices);
+        seed[1] = (uint8_t)((i % devices) >> 8);
+        nonce[0] = (uint8_t)i;
+        nonce[1] = (uint8_t)(i >> 8);
+        nonce[2] = (uint8_t)(i >> 16);
+
+        if (puf_prover_prove(seed, nonce, &bufs[i]) != 0) {
+            fprintf(stderr, "ERROR: failed to generate proof %d\n", i);
+            return -1;
+        }
+        puf_proof_view(&bufs[i], &proofs[i]);
+    }
+    return 0;
+}
+
+/* Verifies all proofs through a pool of the given size, returns proofs/s or
+ * a negative value on error. */
+static double pool_throughput(puf_proof_t* proofs, int count, int threads)
+{
+    puf_pool* pool = puf_pool_new(threads, POOL_QUEUE);
+    puf_job** jobs = calloc(count, sizeof(*jobs));
+    double start, elapsed = -1;
+    int submitted = 0, failed = 0;
+
+    if (!pool || !jobs)
+        goto exit;
+
+    start = now();
+    for (int i = 0; i < count; i++) {
+        /* Collect the oldest job first when the pipeline is full */
+        if (i >= POOL_QUEUE) {
+            failed += puf_job_wait(jobs[i - POOL_QUEUE]) != 0;
+        }
+        jobs[i] = puf_pool_submit(pool, &proofs[i]);
+        if (!jobs[i])
+            goto exit;
+        submitted++;
+    }
+    for (int i = count > POOL_QUEUE ? count - POOL_QUEUE : 0; i < count; i++)
+        failed += puf_job_wait(jobs[i]) != 0;
+    elapsed = now() - start;
+
+    if (failed) {
+        fprintf(stderr, "ERROR: pool rejected %d proofs\n", failed);
+        elapsed = -1;
+    }
+
+exit:
+    for (int i = 0; i < submitted; i++)
+        puf_job_free(jobs[i]);
+    free(jobs);
+    puf_pool_free(pool);
+    return elapsed > 0 ? count / elapsed : -1;
+}
+
+/* Runs every proof, and a tampered copy of it, through both point backends
+ * and reports any disagreement. Returns the number of mismatches. */
+static int cross_check(puf_verifier_ctx* ctx, puf_proof_buf_t* bufs, puf_proof_t* proofs,
+                       int count)
+{
+    static const char* tamper[] = { "none", "v", "w", "P", "nonce", "COM off curve" };
+    int tampers = sizeof(tamper) / sizeof(tamper[0]);
+    int mismatches = 0;
+    int custom, wolfcrypt;
+
+    for (int i = 0; i < count; i++) {
+        puf_proof_buf_t saved = bufs[i];
+        int t = i % tampers;
+
+        switch (t) {
+        case 1: bufs[i].v[PUF_SCALAR_LEN - 1] ^= 1; break;
+        case 2: bufs[i].w[0] ^= 0x80; break;
+        case 3: memcpy(bufs[i].Px, bufs[i].COMx, PUF_COORDINATE_LEN);
+                memcpy(bufs[i].Py, bufs[i].COMy, PUF_COORDINATE_LEN); break;
+        case 4: bufs[i].nonce[PUF_NONCE_LEN - 1] ^= 1; break;
+        case 5: bufs[i].COMy[PUF_COORDINATE_LEN - 1] ^= 1; break;
+        }
+
+        puf_verifier_ctx_set_backend(ctx, PUF_BACKEND_CUSTOM);
+        custom = verify_proof(ctx, &proofs[i]);
+        puf_verifier_ctx_set_backend(ctx, PUF_BACKEND_WOLFCRYPT);
+        wolfcrypt = verify_proof(ctx, &proofs[i]);
+        bufs[i] = saved;
+
+        if ((custom == 0) != (wolfcrypt == 0) || (custom == 0) != (t == 0)) {
+            fprintf(stderr, "MISMATCH: proof %d tampered %s: custom %d, wolfcrypt %d\n",
+                    i, tamper[t], custom, wolfcrypt);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+static void pattern_size(const uint8_t* pattern, int* bytes, int* frames)
+{
+    for (int i = 0; i < 4; i++) {
+        *bytes += pattern[i];
+        *frames += pattern[i] > 0;
+    }
+}
+
+/* Compresses and recovers every point of the proofs, and checks that
+ * malformed encodings are refused. Returns the number of failures. */
+static int point_roundtrip(puf_verifier_ctx* ctx, puf_proof_t* proofs, int count)
+{
+    uint8_t packed[COMPRESSED_POINT_LEN];
+    uint8_t x[PUF_COORDINATE_LEN], y[PUF_COORDINATE_LEN];
+    int failures = 0;
+    int bytes = 0, frames = 0, packedBytes = 0, packedFrames = 0;
+
+    for (int i = 0; i < count; i++) {
+        const uint8_t* points[][2] = {
+            { proofs[i].gx, proofs[i].gy }, { proofs[i].hx, proofs[i].hy },
+            { proofs[i].COMx, proofs[i].COMy }, { proofs[i].Px, proofs[i].Py },
+        };
+
+        for (int j = 0; j < 4; j++) {
+            compressPoint(points[j][0], points[j][1], packed);
+            if (puf_point_decompress(ctx, packed, x, y) != 0 ||
+                memcmp(x, points[j][0], PUF_COORDINATE_LEN) != 0 ||
+                memcmp(y, points[j][1], PUF_COORDINATE_LEN) != 0) {
+                fprintf(stderr, "MISMATCH: proof %d point %d not recovered\n", i, j);
+                failures++;
+            }
+        }
+    }
+
+    // Uncompressed prefix, and an x beyond the prime
+    packed[0] = 0x04;
+    failures += puf_point_decompress(ctx, packed, x, y) == 0;
+    packed[0] = 0x02;
+    memset(packed + 1, 0xFF, PUF_COORDINATE_LEN);
+    failures += puf_point_decompress(ctx, packed, x, y) == 0;
+
+    pattern_size(pattern_init_commit, &bytes, &frames);
+    pattern_size(pattern_init_commit, &bytes, &frames);
+    pattern_size(pattern_proofs, &bytes, &frames);
+    pattern_size(pattern_init_compressed, &packedBytes, &packedFrames);
+    pattern_size(pattern_commit_compressed, &packedBytes, &packedFrames);
+    pattern_size(pattern_proofs_compressed, &packedBytes, &packedFrames);
+    printf("Responses per session: %d bytes in %d portions, compressed %d bytes in %d\n",
+           bytes, frames, packedBytes, packedFrames);
+
+    bytes = frames = packedBytes = packedFrames = 0;
+    pattern_size(pattern_init_commit, &bytes, &frames);
+    pattern_size(pattern_init_commit, &bytes, &frames);
+    pattern_size(pattern_proofs, &bytes, &frames);
+    pattern_size(pattern_none, &packedBytes, &packedFrames);
+    pattern_size(pattern_commit_request, &packedBytes, &packedFrames);
+    pattern_size(pattern_proofs_request, &packedBytes, &packedFrames);
+    printf("Challenges per session: %d bytes in %d portions, compressed %d bytes in %d\n",
+           bytes, frames, packedBytes, packedFrames);
+
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    puf_verifier_ctx* ctx = NULL;
+    puf_proof_buf_t*  bufs = NULL;
+    puf_proof_t*      proofs = NULL;
+    int*              results = NULL;
+    kat_t*            kats = NULL;
+    const char*       katFile = NULL;
+    int               katCount;
+    int               repeat = DEFAULT_REPEAT;
+    int               katOnly = 0;
+    int               maxBatch = DEFAULT_MAX_BATCH;
+    int               devices = DEFAULT_DEVICES;
+    int               threads = DEFAULT_THREADS;
+    double            rate, base = 0;
+    int               ret = 1;
+    int               opt;
+    puf_backend_t     backend = PUF_BACKEND_CUSTOM;
+    double            start, single, batch;
+
+    while ((opt = getopt(argc, argv, "f:r:Kn:d:b:t:h")) != -1) {
+        switch (opt) {
+        case 'f':
+            katFile = optarg;
+            break;
+        case 'r':
+            repeat = atoi(optarg);
+            break;
+        case 'K':
+            katOnly = 1;
+            break;
+        case 'n':
+            maxBatch = atoi(optarg);
+            break;
+        case 'd':
+            devices = atoi(optarg);
+            break;
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 'b':
+            if (strcmp(optarg, puf_backend_name(PUF_BACKEND_CUSTOM)) == 0) {
+                backend = PUF_BACKEND_CUSTOM;
+                break;
+            }
+            if (strcmp(optarg, puf_backend_name(PUF_BACKEND_WOLFCRYPT)) == 0) {
+                backend = PUF_BACKEND_WOLFCRYPT;
+                break;
+            }
+            usage(argv[0]);
+            return 1;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (maxBatch < 1 || devices < 1 || repeat < 1 || threads < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (maxBatch < CORRUPT_BATCH)
+        maxBatch = CORRUPT_BATCH;
+
+    wolfSSL_SetAllocators(count_malloc, count_free, count_realloc);
+    wolfSSL_Init();
+
+    katCount = load_kats(katFile, &kats);
+    if (katCount < 0)
+        goto exit;
+
+    ctx = puf_verifier_ctx_new();
+    bufs = calloc(maxBatch, sizeof(*bufs));
+    proofs = calloc(maxBatch, sizeof(*proofs));
+    results = calloc(maxBatch, sizeof(*results));
+    if (!ctx || !bufs || !proofs || !results) {
+        fprintf(stderr, "ERROR: out of memory\n");
+        goto exit;
+    }
+    puf_verifier_ctx_set_verbose(ctx, 0);
+
+    if (katCount > 0 && run_kats(ctx, kats, katCount, repeat) != 0) {
+        fprintf(stderr, "ERROR: known-answer proofs failed\n");
+        goto exit;
+    }
+    if (katOnly) {
+        ret = 0;
+        goto exit;
+    }
+
+    printf("Generating %d proofs from %d devices...\n", maxBatch, devices);
+    if (generate(bufs, proofs, maxBatch, devices) != 0)
+        goto exit;
+
+    printf("Cross-checking point backends on %d proofs...\n", maxBatch);
+    if (cross_check(ctx, bufs, proofs, maxBatch) != 0) {
+        fprintf(stderr, "ERROR: point backends disagree\n");
+        goto exit;
+    }
+    printf("Round-tripping compressed points of %d proofs...\n", maxBatch);
+    if (point_roundtrip(ctx, proofs, maxBatch) != 0) {
+        fprintf(stderr, "ERROR: compressed points not recovered\n");
+        goto exit;
+    }
+    puf_verifier_ctx_set_backend(ctx, backend);
+
+    printf("Single verification backend: %s\n", puf_backend_name(backend));
+
+    printf("%8s %14s %14s %8s\n", "batch", "single [p/s]", "batch [p/s]", "speedup");
+    for (int n = 1; n <= maxBatch; n *= 2) {
+        start = now();
+        for (int i = 0; i < n; i++) {
+            if (verify_proof(ctx, &proofs[i]) != 0) {
+                fprintf(stderr, "ERROR: proof %d rejected\n", i);
+                goto exit;
+            }
+        }
+        single = now() - start;
+
+        start = now();
+        if (verify_proof_batch(ctx, proofs, n, results) != 0) {
+            fprintf(stderr, "ERROR: batch of %d rejected\n", n);
+            goto exit;
+        }
+        batch = now() - start;
+
+        printf("%8d %14.1f %14.1f %7.2fx\n", n, n / single, n / batch, single / batch);
+    }
+
+    printf("%8s %14s %8s\n", "threads", "pool [p/s]", "scaling");
+    for (int t = 1; t <= threads; t *= 2) {
+        rate = pool_throughput(proofs, maxBatch, t);
+        if (rate < 0) {
+            fprintf(stderr, "ERROR: pool with %d threads failed\n", t);
+            goto exit;
+        }
+        if (t == 1)
+            base = rate;
+        printf("%8d %14.1f %7.2fx\n", t, rate, rate / base);
+    }
+
+    /* One bad proof in the batch, bisection has to single it out. */
+    bufs[CORRUPT_BATCH / 3].v[PUF_SCALAR_LEN - 1] ^= 1;
+    start = now();
+    ret = verify_proof_batch(ctx, proofs, CORRUPT_BATCH, results);
+    batch = now() - start;
+    bufs[CORRUPT_BATCH / 3].v[PUF_SCALAR_LEN - 1] ^= 1;
+
+    printf("Batch of %d with proof %d corrupted: %d rejected in %.3f s",
+           CORRUPT_BATCH, CORRUPT_BATCH / 3, ret, batch);
+    for (int i = 0; i < CORRUPT_BATCH; i++) {
+        if (results[i] != 0)
+            printf(" [%d]", i);
+    }
+    printf("\n");
+
+    ret = (ret == 1 && results[CORRUPT_BATCH / 3] != 0) ? 0 : 1;
+    if (ret != 0)
+        fprintf(stderr, "ERROR: corrupted proof not isolated\n");
+
+exit:
+    free(results);
+    free(proofs);
+    free(bufs);
+    free(kats);
+    puf_verifier_ctx_free(ctx);
+    wolfSSL_Cleanup();
+
+    return ret;
+}
@@ -8,6 +8,7 @@ gen_csr_and_cert() {
   local target="$1"
   local prefix="$2"
   local prefix_c="${prefix^}"
+  local extensions="${3:-req_ext}"
 
   scp ./certs/cert.conf $target:~
 
@@ -24,7 +25,7 @@ EOF
 
   echo "# Generating $prefix certificate"
   openssl pkey -pubin -inform DER -in ./artifacts/certs/$prefix-pubkey.der -out ./artifacts/certs/$prefix-pubkey.pem
-  openssl x509 -req -days 365 -in ./artifacts/certs/$prefix-csr.pem -CA ./certs/ca-cert.pem -CAkey ./certs/ca-key.pem -CAcreateserial -out ./artifacts/certs/$prefix-cert.pem -extfile ./certs/cert.conf -extensions req_ext
+  openssl x509 -req -days 365 -in ./artifacts/certs/$prefix-csr.pem -CA ./certs/ca-cert.pem -CAkey ./certs/ca-key.pem -CAcreateserial -out ./artifacts/certs/$prefix-cert.pem -extfile ./certs/cert.conf -extensions $extensions
 
   scp ./artifacts/certs/$prefix-cert.pem "$target":~
   scp ./certs/ca-cert.pem "$target":~
@@ -36,7 +37,14 @@ if [ "$SINGLE_TARGET" = "true" ]; then
     echo "Warning! Single target configuration enabled!"
 fi
 
-gen_csr_and_cert $PI_SERVER $PI_SERVER_PREFIX
+# SERVER_CERT_EXT=delegator_ext lets the server certificate issue
+# short-lived handshake keys
+if [ "$SERVER_CERT_EXT" = "delegator_ext" ]; then
+    echo "WARNING: the server certificate will be a CA (delegator_ext)."
+    echo "WARNING: its key can issue certificates under OU=Delegated handshake key."
+    echo "WARNING: peers that ignore name constraints would accept them as client certificates."
+fi
+gen_csr_and_cert $PI_SERVER $PI_SERVER_PREFIX "${SERVER_CERT_EXT:-req_ext}"
 if [ "$SINGLE_TARGET" = "true" ]; then
     gen_csr_and_cert $PI_SERVER $PI_CLIENT_PREFIX
 else
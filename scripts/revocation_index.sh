@@ -0,0 +1,34 @@
+#!/bin/bash
+
+# Adds the given PEM certificates to the revocation index read by
+# server-tls -R, creating it if needed. The index is rewritten next to the
+# old one and renamed over it, so a running server picks it up safely.
+
+set -e
+
+if [ $# -lt 2 ]; then
+  echo "usage: $0 <index> <cert.pem>..."
+  exit 1
+fi
+
+index="$1"
+shift
+
+tmp="$(mktemp "$(dirname "$index")/.revoked.XXXXXX")"
+trap 'rm -f "$tmp"' EXIT
+
+{
+  # One fingerprint per line, lowercase hex sorts like the raw bytes
+  if [ -f "$index" ]; then
+    xxd -p -c 32 "$index"
+  fi
+  for cert in "$@"; do
+    openssl x509 -in "$cert" -outform DER | sha256sum | cut -d' ' -f1
+  done
+} | LC_ALL=C sort -u | xxd -r -p > "$tmp"
+
+chmod 0644 "$tmp"
+mv "$tmp" "$index"
+trap - EXIT
+
+echo "$index: $(( $(stat -c %s "$index") / 32 )) revoked certificates"
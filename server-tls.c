@@ -24,6 +24,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+
+#ifdef NXP_PUF
+  #include <syslog.h>
+#endif
 
 /* socket includes */
 #include <sys/socket.h>
@@ -35,17 +40,30 @@
 #include <wolfssl/options.h>
 #include <wolfssl/ssl.h>
 #include <wolfssl/wolfcrypt/wc_pkcs11.h>
+#include <wolfssl/wolfcrypt/error-crypt.h>
 
 #include "include/common/log.h"
+#include "include/key_backend.h"
+#include "include/util.h"
+#include "include/keyshare_pool.h"
+#include "include/delegated_key.h"
+#include "include/cipher_tune.h"
+#include "include/pinned_keys.h"
+#include "include/peer_cache.h"
+#include "include/revocation_index.h"
 #ifdef NXP_PUF
   #include "include/common/challenge.h"
   #include "include/local_challenge.h"
   #include "include/puf_verifier.h"
+  #include "include/puf_pool.h"
+  #include "include/device_registry.h"
+  #include "include/random_pool.h"
 #endif
 #ifdef RPI_CBA
   #include <tee_client_api.h>
   #include "include/context_based_authentication.h"
   #include "include/common/challenge.h"
+  #include "include/auth_ticket.h"
 #endif
 
 #define DEFAULT_PORT 12345
@@ -54,9 +72,149 @@
 #define PREFIX      "server"
 #define CERT_FILE   "/root/" PREFIX "-cert.pem"
 #define KEY_FILE    "/root/" PREFIX "-key.pem"
+#ifdef NXP_PUF
+/* Connections are served one at a time, so a single background verifier
+ * holding a single job is all the server can keep busy */
+#define PUF_POOL_THREADS 1
+#define PUF_POOL_QUEUE   1
+
+/* Bases and commitments of devices seen before */
+#define DEVICE_REGISTRY_FILE     "/root/puf-devices.db"
+#define DEVICE_REGISTRY_CAPACITY 1024
+
+/* Pre-generated randomness for per-session challenges and nonces */
+#define RANDOM_POOL_BYTES 4096
+#endif
+
 #define SLOT_ID 0
 #define PRIV_KEY_ID  {0x01}
 
+/* Ephemeral ECDHE keys made ahead of the handshakes */
+#define KEYSHARE_POOL_KEYS 16
+
+#ifdef RPI_CBA
+#define CBA_OPTS "t:N"
+#else
+#define CBA_OPTS ""
+#endif
+
+
+#ifdef NXP_PUF
+/* SHA-256 over the DER of the authenticated client certificate */
+int peerFingerprint(WOLFSSL* ssl, byte* fingerprint)
+{
+    WOLFSSL_X509* peer;
+    int ret;
+
+    peer = wolfSSL_get_peer_certificate(ssl);
+    if (peer == NULL)
+        return -1;
+
+    ret = cert_fingerprint(peer, fingerprint);
+    wolfSSL_X509_free(peer);
+    return ret;
+}
+
+/* Audit record for a client whose PUF proof was rejected */
+void auditPufFailure(struct sockaddr_in* clientAddr, const byte* deviceId, int haveId,
+                     const char* mode)
+{
+    char addr[INET_ADDRSTRLEN] = "?";
+    char id[2 * DEVICE_FINGERPRINT_LEN + 1] = "unknown";
+
+    inet_ntop(AF_INET, &clientAddr->sin_addr, addr, sizeof(addr));
+    if (haveId) {
+        for (int i = 0; i < DEVICE_FINGERPRINT_LEN; i++)
+            sprintf(id + 2 * i, "%02x", deviceId[i]);
+    }
+
+    syslog(LOG_WARNING, "PUF verification failed (%s): client %s:%u, device %s",
+           mode, addr, ntohs(clientAddr->sin_port), id);
+}
+
+/* Waits for the proof verdict and updates the device registry with it.
+ * Returns 0 when the proof is valid. */
+int finishPufVerification(puf_job** job, device_registry* registry, const byte* deviceId,
+                          int haveId, int sendInit, int sendComm,
+                          func_call_t* initCh, func_call_t* commCh)
+{
+    int ret = puf_job_wait(*job);
+
+    puf_job_free(*job);
+    *job = NULL;
+
+    if (ret) {
+        /* Cached material may be stale, do the full exchange next time */
+        if (!sendInit)
+            device_registry_remove(registry, deviceId);
+        return ret;
+    }
+
+    if (haveId &&
+        device_registry_store(registry, deviceId,
+                              initCh->data_p[0].data, initCh->data_p[1].data,
+                              initCh->data_p[2].data, initCh->data_p[3].data,
+                              sendComm ? commCh->data_p[2].data : NULL,
+                              sendComm ? commCh->data_p[3].data : NULL)) {
+        fprintf(stderr, "WARNING: could not remember device\n");
+    }
+    return 0;
+}
+
+#ifdef PUF_COMPRESSED_POINTS
+/* Recovers the uncompressed portions the verifier and the registry work on
+ * from the compressed responses. Returns 0 when every point is valid. */
+int expandPufResponses(puf_verifier_ctx* pointCtx, int sendInit, int sendComm,
+                       func_call_t* initRsp, func_call_t* commRsp, func_call_t* proofsRsp,
+                       func_call_t* initCh, func_call_t* commCh, func_call_t* proofsCh)
+{
+    if (sendInit &&
+        (puf_point_decompress(pointCtx, initRsp->data_p[0].data,
+                              initCh->data_p[0].data, initCh->data_p[1].data) ||
+         puf_point_decompress(pointCtx, initRsp->data_p[1].data,
+                              initCh->data_p[2].data, initCh->data_p[3].data)))
+        return -1;
+
+    if (sendComm &&
+        puf_point_decompress(pointCtx, commRsp->data_p[0].data,
+                             commCh->data_p[2].data, commCh->data_p[3].data))
+        return -1;
+
+    if (puf_point_decompress(pointCtx, proofsRsp->data_p[0].data,
+                             proofsCh->data_p[0].data, proofsCh->data_p[1].data))
+        return -1;
+    memcpy(proofsCh->data_p[2].data, proofsRsp->data_p[1].data, LEN64);
+    memcpy(proofsCh->data_p[3].data, proofsRsp->data_p[2].data, LEN64);
+    return 0;
+}
+#endif
+#endif /* NXP_PUF */
+
+void usage(const char* prog, const key_backend_config_t* keyCfg)
+{
+    printf("usage: %s [options]\n", prog);
+    key_backend_usage(keyCfg);
+    printf("  -D seconds   Sign handshakes with a short-lived software key, certified\n"
+           "               by the private key and reissued every half lifetime\n");
+    printf("  -C aead      Bulk cipher: auto (time both at startup), aes or chacha\n"
+           "               (default auto)\n");
+    printf("  -K file      Accept only clients whose public key is listed in file,\n"
+           "               as SHA-256 of the SubjectPublicKeyInfo, instead of\n"
+           "               validating their chain against %s\n", CA_FILE);
+    printf("  -V entries   Remember up to entries validated client certificates,\n"
+           "               until they expire, and skip their chain validation\n");
+    printf("  -R file      Reject clients whose certificate is in the revocation\n"
+           "               index file, see scripts/revocation_index.sh\n");
+#ifdef RPI_CBA
+    printf("  -t seconds   After a successful CBA, grant the client a ticket that\n"
+           "               skips CBA on its reconnects for this long\n");
+    printf("  -N           Derive the CBA nonce from the TLS session instead of\n"
+           "               sending one, the client follows\n");
+#endif
+    printf("  -B           Benchmark handshakes only: time and close every\n"
+           "               connection right after the handshake\n");
+    printf("  -h           Show this help\n");
+}
 
 #ifdef RPI_CBA
 TEEC_Result CBAGenerateNonce(char* nonce, size_t nonce_size) {
@@ -175,7 +333,7 @@ size_t get_real_size(const unsigned char *data, size_t len) {
 }
 #endif /* RPI_CBA */
 
-int main()
+int main(int argc, char** argv)
 {
     int                sockfd = SOCKET_INVALID;
     int                connd = SOCKET_INVALID;
@@ -189,18 +347,39 @@ int main()
     const char*        reply = "Hello from WolfSSL TLS server!\n";
     char               wolfsslErrorStr[80];
 
+    key_backend_config_t keyCfg = {
+        .type = KEY_BACKEND_OPTEE,
 #ifdef RPI_CBA
-    const char* library = "/usr/lib/libckteec2.so";
+        .optee_module = "/usr/lib/libckteec2.so",
 #else
-    const char* library = "/usr/lib/libckteec.so";
+        .optee_module = "/usr/lib/libckteec.so",
 #endif /* ifdef RPI_CBA */
-    const char* tokenName = "ServerToken";
-    const char* userPin = "1234";
-    Pkcs11Dev dev;
-    Pkcs11Token token;
-    int slotId = SLOT_ID;
+        .token_name = "ServerToken",
+        .user_pin = "1234",
+        .slot_id = SLOT_ID,
+        .key_file = KEY_FILE,
+    };
+    key_backend* keys = NULL;
+    key_backend_stats_t keyStats, keyStatsBefore;
+    keyshare_pool* keyShares = NULL;
+    keyshare_pool_stats_t keyShareStats;
+    delegated_key* delegated = NULL;
+    int delegateLifetime = 0;
+    cipher_pref_t cipherPref = CIPHER_PREF_AUTO;
+    const char* pinFile = NULL;
+    pinned_keys* pins = NULL;
+    pinned_keys_stats_t pinStats;
+    int peerCacheEntries = 0;
+    peer_cache* peerCache = NULL;
+    peer_cache_stats_t peerCacheStats;
+    const char* revocationFile = NULL;
+    revocation_index* revoked = NULL;
+    revocation_index_stats_t revokedStats;
     int devId = 1;
     unsigned char      privKeyId[] = PRIV_KEY_ID;
+    int benchHandshakes = 0, handshakes = 0;
+    double handshakeStart, handshakeMs, handshakeTotalMs = 0;
+    int opt;
 
     /* declare wolfSSL objects */
     WOLFSSL_CTX* ctx = NULL;
@@ -213,6 +392,23 @@ int main()
     func_call_t commCh;
     func_call_t proofsCh;
     data_portion_t nonceP;
+    puf_pool* verifierPool = NULL;
+    puf_job* verifyJob = NULL;
+    device_registry* registry = NULL;
+    const device_record_t* device = NULL;
+    byte deviceId[DEVICE_FINGERPRINT_LEN];
+    int haveId, sendInit, sendComm;
+    random_pool* challengeRng = NULL;
+    random_pool_stats_t rngStats;
+    uint8_t sessionNonce[LEN64];
+    func_call_t *initOut, *commOut, *proofsOut;
+    func_call_t *initIn, *commIn, *proofsIn;
+#ifdef PUF_COMPRESSED_POINTS
+    /* Wire format, expanded into the challenges above once received */
+    func_call_t initReq = {0}, commReq = {0}, proofsReq = {0};
+    func_call_t initRsp = {0}, commRsp = {0}, proofsRsp = {0};
+    puf_verifier_ctx* pointCtx = NULL;
+#endif
 #endif
 
 #ifdef RPI_CBA
@@ -224,6 +420,15 @@ int main()
     /* Are needed for initFunc(). */
     const uint8_t CBASignaturePatternSize[DATA_PORTIONS] = {(uint8_t)CBA_MESSAGE_SIZE};
     const uint8_t CBANoncePatternSize[DATA_PORTIONS] = {(uint8_t)CBA_NONCE_SIZE};
+
+    int channelNonce = 0;
+    int ticketTtl = 0, ticketUsed;
+    auth_ticket_issuer* tickets = NULL;
+    auth_ticket_stats_t ticketStats;
+    uint8_t ticketOffer[AUTH_TICKET_OFFER_LEN], ticketGrant[AUTH_TICKET_GRANT_LEN];
+    func_call_t ticketIn = {0}, ticketOut = {0};
+    double authStart, authMs[2] = {0};
+    unsigned long long authCount[2] = {0};
 #endif
 
 #ifndef NXP_PUF
@@ -235,30 +440,110 @@ int main()
     fprintf(stdout, "Debug enabled!\n");
 #endif
 
+    memcpy(keyCfg.key_id, privKeyId, sizeof(privKeyId));
+    keyCfg.key_id_len = sizeof(privKeyId);
+
+    while ((opt = getopt(argc, argv, KEY_BACKEND_OPTS "BC:D:K:R:V:h" CBA_OPTS)) != -1) {
+        if (opt == 'D' && (delegateLifetime = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'C' && cipher_tune_parse(optarg, &cipherPref) == 0)
+            continue;
+        if (opt == 'K') {
+            pinFile = optarg;
+            continue;
+        }
+        if (opt == 'V' && (peerCacheEntries = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'R') {
+            revocationFile = optarg;
+            continue;
+        }
+#ifdef RPI_CBA
+        if (opt == 't' && (ticketTtl = atoi(optarg)) > 0)
+            continue;
+        if (opt == 'N') {
+            channelNonce = 1;
+            continue;
+        }
+#endif
+        if (opt == 'B') {
+            benchHandshakes = 1;
+            continue;
+        }
+        if (opt != 'C' && opt != 'D' && opt != 'V' && opt != 't' && opt != 'h' &&
+            key_backend_parse_opt(&keyCfg, opt, optarg) == 0)
+            continue;
+        usage(argv[0], &keyCfg);
+        return opt == 'h' ? 0 : 1;
+    }
+    /* Pinned keys involve no chain to validate */
+    if (pinFile && peerCacheEntries) {
+        fprintf(stderr, "ERROR: -K and -V cannot be combined\n");
+        return 1;
+    }
+#if defined(RPI_CBA) && !defined(HAVE_KEYING_MATERIAL)
+    if (channelNonce) {
+        fprintf(stderr, "ERROR: -N needs wolfSSL with HAVE_KEYING_MATERIAL\n");
+        return 1;
+    }
+#endif
+
     wolfCrypt_Init();
 
-    ret = wc_Pkcs11_Initialize(&dev, library, NULL);
-    if (ret != 0) {
-      fprintf(stderr, "Failed to initialize PKCS#11 library\n");
-      return ret;
-    }
+    /* Loads the PKCS#11 module and registers the token, unless the key is
+     * used in software */
+    keys = key_backend_new(&keyCfg, devId);
+    if (keys == NULL)
+      return -1;
+    printf("Private key backend: %s\n", key_backend_name(keyCfg.type));
+
+    /* Initialize wolfSSL */
+    wolfSSL_Init();
+
+    keyShares = keyshare_pool_new(KEYSHARE_POOL_KEYS);
 
-    ret = wc_Pkcs11Token_Init(&token, &dev, slotId, tokenName, (byte *)userPin,
-                              strlen(userPin));
-    if (ret != 0) {
-      fprintf(stderr, "Failed to initialize PKCS#11 token\n");
-      return ret;
+#ifdef NXP_PUF
+    openlog("server-tls", LOG_PID, LOG_AUTH);
+
+    /* Proofs are checked by a background thread with its own verifier */
+    verifierPool = puf_pool_new(PUF_POOL_THREADS, PUF_POOL_QUEUE);
+    if (verifierPool == NULL) {
+        fprintf(stderr, "ERROR: failed to create PUF verifier pool\n");
+        ret = -1;
+        goto exit;
     }
 
-    ret = wc_CryptoDev_RegisterDevice(devId, wc_Pkcs11_CryptoDevCb,
-                                              &token);
-    if (ret != 0) {
-      fprintf(stderr, "Failed to register PKCS#11 token\n");
-      return ret;
+    /* Without a registry every device gets the full challenge sequence */
+    registry = device_registry_open(DEVICE_REGISTRY_FILE, DEVICE_REGISTRY_CAPACITY);
+    if (registry == NULL)
+        fprintf(stderr, "WARNING: device registry unavailable, caching disabled\n");
+
+    challengeRng = random_pool_new(RANDOM_POOL_BYTES);
+    if (challengeRng == NULL) {
+        fprintf(stderr, "ERROR: failed to create challenge random pool\n");
+        ret = -1;
+        goto exit;
     }
 
-    /* Initialize wolfSSL */
-    wolfSSL_Init();
+#ifdef PUF_COMPRESSED_POINTS
+    pointCtx = puf_verifier_ctx_new();
+    if (pointCtx == NULL ||
+        initFunc(&initReq, PUF_TA_INIT_FUNC_ID | PUF_TA_COMPRESSED_POINTS,
+                 pattern_none) ||
+        initFunc(&commReq, PUF_TA_GET_COMMITMENT_FUNC_ID | PUF_TA_COMPRESSED_POINTS,
+                 pattern_commit_request) ||
+        initFunc(&proofsReq, PUF_TA_GET_ZK_PROOFS_FUNC_ID | PUF_TA_COMPRESSED_POINTS,
+                 pattern_proofs_request) ||
+        initFunc(&initRsp, 0, pattern_init_compressed) ||
+        initFunc(&commRsp, 0, pattern_commit_compressed) ||
+        initFunc(&proofsRsp, 0, pattern_proofs_compressed)) {
+        fprintf(stderr, "ERROR: failed to set up compressed PUF challenges\n");
+        ret = -1;
+        goto exit;
+    }
+    puf_verifier_ctx_set_verbose(pointCtx, 0);
+#endif
+#endif
 
     /* Create a socket that uses an internet IPv4 address,
      * Sets the socket to be stream based (TCP),
@@ -284,6 +569,12 @@ int main()
         goto exit;
     }
 
+    /* The server's order picks the AEAD */
+    if (cipher_tune_apply(ctx, cipherPref) != 0) {
+        ret = -1;
+        goto exit;
+    }
+
     /* Load server certificates into WOLFSSL_CTX */
     ret = wolfSSL_CTX_use_certificate_file(ctx, CERT_FILE, SSL_FILETYPE_PEM);
     if (ret != WOLFSSL_SUCCESS) {
@@ -293,30 +584,91 @@ int main()
         goto exit;
     }
 
-    if (wolfSSL_CTX_SetDevId(ctx, devId) != WOLFSSL_SUCCESS) {
-        fprintf(stderr, "ERROR: failed to create WOLFSSL_CTX\n");
+    /* Load server key into WOLFSSL_CTX */
+    if (key_backend_use(keys, ctx) != 0) {
         ret = -1;
         goto exit;
     }
 
-    /* Load server key into WOLFSSL_CTX */
-    if (wolfSSL_CTX_use_PrivateKey_Id(ctx, privKeyId, sizeof(privKeyId), devId) != SSL_SUCCESS) {
-        fprintf(stderr, "ERROR: failed to set id.\n");
-        ret = -1;
-        goto exit;
+    /* Without PK callbacks wolfSSL makes its ECDHE keys inline */
+    if (keyShares && keyshare_pool_attach(keyShares, ctx) != 0) {
+        keyshare_pool_free(keyShares);
+        keyShares = NULL;
     }
 
-    /* Load CA certificate into WOLFSSL_CTX for validating peer */
-    ret = wolfSSL_CTX_load_verify_locations(ctx, CA_FILE, NULL);
-    if (ret != WOLFSSL_SUCCESS) {
-        fprintf(stderr, "ERROR: failed to load %s, please check the file.\n",
-                CA_FILE);
-        goto exit;
+    /* Replaces the key and certificate loaded above with a delegated pair */
+    if (delegateLifetime) {
+        delegated = delegated_key_new(keys, CERT_FILE, delegateLifetime);
+        if (delegated == NULL || delegated_key_refresh(delegated, ctx) < 0) {
+            fprintf(stderr, "ERROR: failed to issue the delegated key\n");
+            ret = -1;
+            goto exit;
+        }
+    }
+
+    if (pinFile) {
+        /* Authenticate clients by their key alone, no CA is loaded */
+        pins = pinned_keys_load(pinFile);
+        if (pins == NULL) {
+            ret = -1;
+            goto exit;
+        }
+        printf("Accepting %zu pinned client keys\n", pinned_keys_count(pins));
+        if (pinned_keys_attach(pins, ctx,
+                WOLFSSL_VERIFY_PEER | WOLFSSL_VERIFY_FAIL_IF_NO_PEER_CERT) != 0) {
+            fprintf(stderr, "ERROR: failed to attach the pinned keys\n");
+            ret = -1;
+            goto exit;
+        }
+    }
+    else if (peerCacheEntries) {
+        /* The cache holds the CA and validates on its misses */
+        peerCache = peer_cache_new(CA_FILE, peerCacheEntries);
+        if (peerCache == NULL) {
+            ret = -1;
+            goto exit;
+        }
+        if (peer_cache_attach(peerCache, ctx,
+                WOLFSSL_VERIFY_PEER | WOLFSSL_VERIFY_FAIL_IF_NO_PEER_CERT) != 0) {
+            fprintf(stderr, "ERROR: failed to attach the client certificate cache\n");
+            ret = -1;
+            goto exit;
+        }
+    }
+    else {
+        /* Load CA certificate into WOLFSSL_CTX for validating peer */
+        ret = wolfSSL_CTX_load_verify_locations(ctx, CA_FILE, NULL);
+        if (ret != WOLFSSL_SUCCESS) {
+            fprintf(stderr, "ERROR: failed to load %s, please check the file.\n",
+                    CA_FILE);
+            goto exit;
+        }
+
+        /* enable mutual authentication */
+        wolfSSL_CTX_set_verify(ctx,
+            WOLFSSL_VERIFY_PEER | WOLFSSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
     }
 
-    /* enable mutual authentication */
-    wolfSSL_CTX_set_verify(ctx,
-        WOLFSSL_VERIFY_PEER | WOLFSSL_VERIFY_FAIL_IF_NO_PEER_CERT, NULL);
+    /* The server certificate is a CA under the same root as the clients,
+     * so its key could issue client certificates. Clients must be issued
+     * by the root directly. */
+    if (delegateLifetime)
+        wolfSSL_CTX_set_verify_depth(ctx, 0);
+
+    /* Checked ahead of whichever verification was set up above */
+    if (revocationFile) {
+        revoked = revocation_index_open(revocationFile);
+        if (revoked == NULL) {
+            ret = -1;
+            goto exit;
+        }
+        if (revocation_index_attach(revoked, ctx) != 0) {
+            fprintf(stderr, "ERROR: -R needs -K or -V, unless wolfSSL is built"
+                            " with WOLFSSL_ALWAYS_VERIFY_CB\n");
+            ret = -1;
+            goto exit;
+        }
+    }
 
     /* Initialize the server address struct with zeros */
     memset(&servAddr, 0, sizeof(servAddr));
@@ -340,6 +692,17 @@ int main()
         goto exit;
     }
 
+#ifdef RPI_CBA
+    /* The ticket key lives in memory only, restarts revoke all tickets */
+    if (ticketTtl) {
+        tickets = auth_ticket_issuer_new(ticketTtl);
+        if (tickets == NULL) {
+            ret = -1;
+            goto exit;
+        }
+    }
+#endif
+
     /* Continue to accept clients until shutdown is issued */
     while (!shutdown) {
         printf("Waiting for a connection...\n");
@@ -352,14 +715,24 @@ int main()
             goto exit;
         }
 
+        handshakeStart = now_ns() / 1e6;
+        key_backend_stats(keys, &keyStatsBefore);
+
         /* Create a WOLFSSL object */
-        ret = wc_Pkcs11Token_Open(&token, 1);
+        ret = key_backend_open_session(keys);
         if (ret != 0) {
             fprintf(stderr, "ERROR: failed to open session on token (%d)\n",
                 ret);
            goto exit;
         }
 
+        /* Rotate between connections, never during a handshake */
+        if (delegated && delegated_key_refresh(delegated, ctx) < 0) {
+            fprintf(stderr, "ERROR: failed to rotate the delegated key\n");
+            ret = -1;
+            goto exit;
+        }
+
         /* Create a WOLFSSL object */
         ssl = wolfSSL_new(ctx);
         if (ssl == NULL) {
@@ -382,6 +755,25 @@ int main()
 
         printf("Client connected successfully\n");
 
+        if (benchHandshakes) {
+            handshakeMs = now_ns() / 1e6 - handshakeStart;
+            handshakeTotalMs += handshakeMs;
+            handshakes++;
+            key_backend_stats(keys, &keyStats);
+            printf("Handshake %d: %.2f ms, %.2f ms in %s token (%llu ops), mean %.2f ms\n",
+                   handshakes, handshakeMs, (keyStats.ns - keyStatsBefore.ns) / 1e6,
+                   key_backend_name(keyCfg.type),
+                   (unsigned long long)(keyStats.ops - keyStatsBefore.ops),
+                   handshakeTotalMs / handshakes);
+
+            wolfSSL_free(ssl);
+            ssl = NULL;
+            key_backend_close_session(keys);
+            close(connd);
+            connd = SOCKET_INVALID;
+            continue;
+        }
+
         cipher = wolfSSL_get_current_cipher(ssl);
         printf("SSL cipher suite is %s\n", wolfSSL_CIPHER_get_name(cipher));
 
@@ -389,123 +781,257 @@ int main()
         // Init init challenge
         initFunc(&initCh, PUF_TA_INIT_FUNC_ID, pattern_init_commit);
 
-        // Init commitment challenge
+        // Init commitment challenge, kept fixed so commitments can be cached
         initFunc(&commCh, PUF_TA_GET_COMMITMENT_FUNC_ID, pattern_init_commit);
         memcpy(commCh.data_p[0].data, comm_cha_p1, commCh.data_p[0].len);
         memcpy(commCh.data_p[1].data, comm_cha_p2, commCh.data_p[1].len);
 
-        // Init proofs challenge
+        // Init proofs challenge, fresh for every session so that proofs
+        // cannot be replayed
         initFunc(&proofsCh, PUF_TA_GET_ZK_PROOFS_FUNC_ID, pattern_proofs);
-        memcpy(proofsCh.data_p[0].data, proofs_cha_p1, proofsCh.data_p[0].len);
-        memcpy(proofsCh.data_p[1].data, proofs_cha_p2, proofsCh.data_p[1].len);
-        memcpy(proofsCh.data_p[2].data, nonce, proofsCh.data_p[2].len);
+        if (random_pool_get(challengeRng, proofsCh.data_p[0].data, proofsCh.data_p[0].len) ||
+            random_pool_get(challengeRng, proofsCh.data_p[1].data, proofsCh.data_p[1].len) ||
+            random_pool_get(challengeRng, sessionNonce, LEN64)) {
+          fprintf(stderr, "ERROR: failed to generate session challenge!\n");
+          goto exit;
+        }
+        memcpy(proofsCh.data_p[2].data, sessionNonce, proofsCh.data_p[2].len);
+
+#ifdef PUF_COMPRESSED_POINTS
+        memcpy(commReq.data_p[0].data, commCh.data_p[0].data, LEN32);
+        memcpy(commReq.data_p[1].data, commCh.data_p[1].data, LEN32);
+        memcpy(proofsReq.data_p[0].data, proofsCh.data_p[0].data, LEN32);
+        memcpy(proofsReq.data_p[1].data, proofsCh.data_p[1].data, LEN32);
+        memcpy(proofsReq.data_p[2].data, sessionNonce, LEN64);
+        initOut = &initReq; commOut = &commReq; proofsOut = &proofsReq;
+        initIn = &initRsp; commIn = &commRsp; proofsIn = &proofsRsp;
+#else
+        initOut = initIn = &initCh;
+        commOut = commIn = &commCh;
+        proofsOut = proofsIn = &proofsCh;
+#endif
 
-        if (sendChallenge(ssl, (void *)&initCh)) {
+        /* Known devices skip the init and, once their commitment proved
+         * stable, the commitment round trip. */
+        device = NULL;
+        haveId = registry && peerFingerprint(ssl, deviceId) == 0;
+        if (haveId)
+            device = device_registry_lookup(registry, deviceId);
+        sendInit = device == NULL;
+        sendComm = sendInit || !(device->flags & DEVICE_COMMITMENT_STABLE);
+
+        if (!sendInit) {
+          LOCAL_LOG_DBG("Known device, seen %u times\n", device->seen);
+          memcpy(initCh.data_p[0].data, device->gx, LEN32);
+          memcpy(initCh.data_p[1].data, device->gy, LEN32);
+          memcpy(initCh.data_p[2].data, device->hx, LEN32);
+          memcpy(initCh.data_p[3].data, device->hy, LEN32);
+        }
+        if (!sendComm) {
+          memcpy(commCh.data_p[2].data, device->COMx, LEN32);
+          memcpy(commCh.data_p[3].data, device->COMy, LEN32);
+        }
+
+        if (sendInit && sendChallenge(ssl, initOut)) {
           fprintf(stderr, "ERROR: init sendChallenge() failed!\n");
           goto exit;
         }
 
-        if (sendChallenge(ssl, (void *)&commCh)) {
+        if (sendComm && sendChallenge(ssl, commOut)) {
           fprintf(stderr, "ERROR: commitment sendChallenge() failed!\n");
           goto exit;
         }
 
-        if (sendChallenge(ssl, (void *)&proofsCh)) {
+        if (sendChallenge(ssl, proofsOut)) {
           fprintf(stderr, "ERROR: proofs sendChallenge() failed!\n");
           goto exit;
         }
 
         /* Wait until challenges are processed on PUF */
 
-        if (recResponse(ssl, (void *)&initCh)) {
+        if (sendInit && recResponse(ssl, initIn)) {
           fprintf(stderr, "ERROR: recResponse() for init failed!\n");
           goto exit;
         }
 
-        if (recResponse(ssl, (void *)&commCh)) {
+        if (sendComm && recResponse(ssl, commIn)) {
           fprintf(stderr, "ERROR: recResponse() for commitment failed!\n");
           goto exit;
         }
 
-        if (recResponse(ssl, (void *)&proofsCh)) {
+        if (recResponse(ssl, proofsIn)) {
           fprintf(stderr, "ERROR: second recResponse() for proofs failed!\n");
           goto exit;
         }
 
+#ifdef PUF_COMPRESSED_POINTS
+        if (expandPufResponses(pointCtx, sendInit, sendComm, &initRsp, &commRsp,
+                               &proofsRsp, &initCh, &commCh, &proofsCh)) {
+          auditPufFailure(&clientAddr, deviceId, haveId, "point encoding");
+          fprintf(stderr, "Error: PUF response carries an invalid point.\n");
+          goto exit;
+        }
+#endif
+
+        /* The response overwrites the sent portions, verify against the
+         * nonce this session was issued */
         nonceP.len = LEN64;
-        nonceP.data = malloc(LEN64);
-        if (!nonceP.data) {
-          fprintf(stderr, "Error: Failed to allocate memory for nonce!\n");
+        nonceP.data = sessionNonce;
+
+        /* The portions are copied, the job owns its proof from here on */
+        verifyJob = puf_pool_submit_portions(verifierPool, &initCh, &commCh,
+                                             &proofsCh, &nonceP);
+        if (!verifyJob) {
+          fprintf(stderr, "Error: Could not queue PUF verification.\n");
           goto exit;
         }
-        memcpy(nonceP.data, nonce, LEN64);
 
-        if (verify(&initCh, &commCh, &proofsCh, &nonceP)) {
+        /* The job holds its own copy of the nonce */
+        memset(sessionNonce, 0, sizeof(sessionNonce));
+
+#ifndef PUF_DEFERRED_VERIFY
+        if (finishPufVerification(&verifyJob, registry, deviceId, haveId,
+                                  sendInit, sendComm, &initCh, &commCh)) {
+          auditPufFailure(&clientAddr, deviceId, haveId, "inline");
           fprintf(stderr, "Error: Could not verify PUF authenticity.\n");
           goto exit;
         }
+#else
+        /* Deferred: the session is provisional until the verdict arrives,
+         * nothing is sent to the client before that. */
+        fprintf(stdout, "PUF verification running in the background\n");
+#endif
 #endif /* NXP_PUF */
 
 #ifdef RPI_CBA
-        memset(CBANonce, 0, (size_t)CBA_NONCE_SIZE);
-        memset(CBASignature, 0, (size_t)CBA_SIGNATURE_BUFFER_SIZE);
+        authStart = now_ns() / 1e6;
+        ticketUsed = 0;
 
-        // Generate CBA nonce:
-        if (CBAGenerateNonce(CBANonce, (size_t)CBA_NONCE_SIZE)) {
-          fprintf(stderr, "ERROR: CBAGenerateNonce() failed!\n");
+        /* A channel-bound nonce is known as soon as the handshake is done */
+        memset(CBANonce, 0, (size_t)CBA_NONCE_SIZE);
+        if (channelNonce && CBAChannelNonce(ssl, CBANonce, (size_t)CBA_NONCE_SIZE)) {
+          fprintf(stderr, "ERROR: CBAChannelNonce() failed!\n");
           goto exit;
         }
 
-        if (initFunc(&CBARequest, CBA_PROVE_IDENTITY, CBANoncePatternSize)) {
-          fprintf(stderr, "initFunc for CBAResponce failed!\n");
+        /* Every client offers a ticket or says it has none. A client with
+         * a live ticket skips CBA. */
+        ticketIn.data_p[0].len = AUTH_TICKET_OFFER_LEN;
+        ticketIn.data_p[0].data = ticketOffer;
+        if (recFuncId(ssl, &ticketIn.func)) {
+          fprintf(stderr, "ERROR: failed to receive the ticket offer!\n");
           goto exit;
         }
-        memcpy(CBARequest.data_p[0].data, CBANonce, (size_t)CBARequest.data_p[0].len);
-
-        if (initFunc(&CBAResponce, 0, CBASignaturePatternSize)) {
-          fprintf(stderr, "initFunc for CBAResponce failed!\n");
-          goto exit;
+        if (ticketIn.func == CBA_TICKET_OFFER) {
+          if (recPortions(ssl, &ticketIn)) {
+            fprintf(stderr, "ERROR: failed to receive the ticket offer!\n");
+            goto exit;
+          }
+          ticketUsed = tickets && auth_ticket_check(tickets, ssl, ticketOffer) == 0;
         }
-        memset(CBAResponce.data_p[0].data, 0, (size_t)CBAResponce.data_p[0].len);
-
-        if (sendChallenge(ssl, &CBARequest)) {
-          fprintf(stderr, "ERROR: sendChallenge() failed!\n");
+        else if (ticketIn.func != CBA_TICKET_NONE) {
+          fprintf(stderr, "ERROR: expected a ticket offer, got 0x%08X!\n",
+                  (unsigned)ticketIn.func);
           goto exit;
         }
 
-        LOCAL_LOG_DBG("CBARequest send!");
-
-        if (recResponse(ssl, &CBAResponce)) {
-          fprintf(stderr, "ERROR: recResponse() failed!\n");
-          goto exit;
+        if (ticketUsed) {
+            ticketOut.func = CBA_TICKET_ACCEPTED;
+            ticketOut.data_p[0].len = 0;
+            ticketOut.data_p[0].data = NULL;
+            if (sendChallenge(ssl, &ticketOut)) {
+              fprintf(stderr, "ERROR: failed to accept the ticket!\n");
+              goto exit;
+            }
+            printf("Ticket accepted, CBA skipped\n");
         }
-
-        LOCAL_LOG_DBG("CBAResponse received!");
-        LOCAL_LOG_DBG("First data portion size: %d", CBAResponce.data_p[0].len);
-        LOCAL_LOG_HEXDUMP_DBG(CBAResponce.data_p[0].data, CBAResponce.data_p[0].len, "Received:");
-
-        // Will break if last byte supposed to be zero
-        CBASignatureSize = get_real_size(
-            (const unsigned char *)CBAResponce.data_p[0].data,
-            CBAResponce.data_p[0].len
-        );
-        if (CBASignatureSize == 0 || CBASignatureSize > CBAResponce.data_p[0].len) {
-          fprintf(stderr, "ERROR: wrong Context-Based Authentication signature size!\n");
-          goto exit;
+        else {
+            memset(CBASignature, 0, (size_t)CBA_SIGNATURE_BUFFER_SIZE);
+
+            // Generate CBA nonce:
+            if (!channelNonce && CBAGenerateNonce(CBANonce, (size_t)CBA_NONCE_SIZE)) {
+              fprintf(stderr, "ERROR: CBAGenerateNonce() failed!\n");
+              goto exit;
+            }
+
+            if (initFunc(&CBARequest,
+                         CBA_PROVE_IDENTITY | (tickets ? CBA_TICKET_GRANT_FOLLOWS : 0) |
+                         (channelNonce ? CBA_CHANNEL_NONCE : 0),
+                         channelNonce ? pattern_none : CBANoncePatternSize)) {
+              fprintf(stderr, "initFunc for CBAResponce failed!\n");
+              goto exit;
+            }
+            if (!channelNonce)
+              memcpy(CBARequest.data_p[0].data, CBANonce, (size_t)CBARequest.data_p[0].len);
+
+            if (initFunc(&CBAResponce, 0, CBASignaturePatternSize)) {
+              fprintf(stderr, "initFunc for CBAResponce failed!\n");
+              goto exit;
+            }
+            memset(CBAResponce.data_p[0].data, 0, (size_t)CBAResponce.data_p[0].len);
+
+            /* A derived nonce is not sent, the request is then only the
+             * answer to the ticket offer */
+            if (sendChallenge(ssl, &CBARequest)) {
+              fprintf(stderr, "ERROR: sendChallenge() failed!\n");
+              goto exit;
+            }
+
+            LOCAL_LOG_DBG("CBARequest send!");
+
+            if (recResponse(ssl, &CBAResponce)) {
+              fprintf(stderr, "ERROR: recResponse() failed!\n");
+              goto exit;
+            }
+
+            LOCAL_LOG_DBG("CBAResponse received!");
+            LOCAL_LOG_DBG("First data portion size: %d", CBAResponce.data_p[0].len);
+            LOCAL_LOG_HEXDUMP_DBG(CBAResponce.data_p[0].data, CBAResponce.data_p[0].len, "Received:");
+
+            // Will break if last byte supposed to be zero
+            CBASignatureSize = get_real_size(
+                (const unsigned char *)CBAResponce.data_p[0].data,
+                CBAResponce.data_p[0].len
+            );
+            if (CBASignatureSize == 0 || CBASignatureSize > CBAResponce.data_p[0].len) {
+              fprintf(stderr, "ERROR: wrong Context-Based Authentication signature size!\n");
+              goto exit;
+            }
+
+            LOCAL_LOG_DBG("Signature size size is %d", CBASignatureSize);
+
+            memcpy(CBASignature, CBAResponce.data_p[0].data, CBASignatureSize);
+
+            if (CBAVerifySignature(CBANonce, CBA_NONCE_SIZE, CBASignature, CBASignatureSize)) {
+              fprintf(stderr, "ERROR: CBAVerifySignature() failed!\n");
+              goto exit;
+            }
+
+            if (tickets) {
+              if (auth_ticket_issue(tickets, ssl, ticketGrant)) {
+                fprintf(stderr, "ERROR: failed to issue a ticket!\n");
+                goto exit;
+              }
+              ticketOut.func = CBA_TICKET_GRANT;
+              ticketOut.data_p[0].len = AUTH_TICKET_GRANT_LEN;
+              ticketOut.data_p[0].data = ticketGrant;
+              ret = sendChallenge(ssl, &ticketOut);
+              memset(ticketGrant, 0, sizeof(ticketGrant));
+              if (ret) {
+                fprintf(stderr, "ERROR: failed to send the ticket!\n");
+                goto exit;
+              }
+            }
         }
 
-        LOCAL_LOG_DBG("Signature size size is %d", CBASignatureSize);
-
-        memcpy(CBASignature, CBAResponce.data_p[0].data, CBASignatureSize);
-
-        if (CBAVerifySignature(CBANonce, CBA_NONCE_SIZE, CBASignature, CBASignatureSize)) {
-          fprintf(stderr, "ERROR: CBAVerifySignature() failed!\n");
-          goto exit;
-        }
+        authMs[ticketUsed] += now_ns() / 1e6 - authStart;
+        authCount[ticketUsed]++;
 
 #endif /* RPI_CBA */
 
+#if !defined(NXP_PUF) || !defined(PUF_DEFERRED_VERIFY)
         fprintf(stdout, "Authentication succeeded!\n");
+#endif
 
         /* Read the client data into our buff array */
         memset(buff, 0, sizeof(buff));
@@ -515,6 +1041,24 @@ int main()
             goto exit;
         }
 
+#if defined(NXP_PUF) && defined(PUF_DEFERRED_VERIFY)
+        /* Data may be read while the proof is checked, but it is not acted
+         * upon and no reply leaves before the verdict. */
+        if (finishPufVerification(&verifyJob, registry, deviceId, haveId,
+                                  sendInit, sendComm, &initCh, &commCh)) {
+            auditPufFailure(&clientAddr, deviceId, haveId, "deferred");
+            fprintf(stderr, "Error: Could not verify PUF authenticity, "
+                            "aborting session.\n");
+            wolfSSL_free(ssl);
+            ssl = NULL;
+            key_backend_close_session(keys);
+            close(connd);
+            connd = SOCKET_INVALID;
+            continue;
+        }
+        fprintf(stdout, "Authentication succeeded!\n");
+#endif
+
         /* Print to stdout any data the client sends */
         printf("Client: %s\n", buff);
 
@@ -543,21 +1087,41 @@ int main()
         /* Cleanup after this connection */
         wolfSSL_free(ssl);      /* Free the wolfSSL object              */
         ssl = NULL;
-        wc_Pkcs11Token_Close(&token);
+        key_backend_close_session(keys);
         close(connd);           /* Close the connection to the client   */
     }
 
     ret = 0;
-    wc_Pkcs11Token_Close(&token);
-    wc_Pkcs11Token_Final(&token);
-    wc_Pkcs11_Finalize(&dev);
 
 exit:
 #ifdef NXP_PUF
     freeFunc(&initCh);
     freeFunc(&commCh);
     freeFunc(&proofsCh);
-    free(nonceP.data);
+#ifdef PUF_COMPRESSED_POINTS
+    freeFunc(&initReq);
+    freeFunc(&commReq);
+    freeFunc(&proofsReq);
+    freeFunc(&initRsp);
+    freeFunc(&commRsp);
+    freeFunc(&proofsRsp);
+    puf_verifier_ctx_free(pointCtx);
+#endif
+    puf_job_free(verifyJob);
+    puf_pool_free(verifierPool);
+    device_registry_close(registry);
+    if (challengeRng) {
+        random_pool_stats(challengeRng, &rngStats);
+        printf("Challenge RNG: %llu requests, %llu from ring, %llu inline,"
+               " %llu us pre-fill, %llu us inline\n",
+               (unsigned long long)rngStats.requests,
+               (unsigned long long)rngStats.ring_hits,
+               (unsigned long long)rngStats.inline_fills,
+               (unsigned long long)(rngStats.prefill_ns / 1000),
+               (unsigned long long)(rngStats.inline_ns / 1000));
+        random_pool_free(challengeRng);
+    }
+    closelog();
 #endif
 
 #ifdef RPI_CBA
@@ -573,7 +1137,70 @@ exit:
         close(sockfd);          /* Close the socket listening for clients   */
     if (ctx)
         wolfSSL_CTX_free(ctx);  /* Free the wolfSSL context object          */
+    if (keyShares) {
+        keyshare_pool_stats(keyShares, &keyShareStats);
+        printf("Key shares: %llu requests, %llu from the pool, %llu underruns,"
+               " %llu other curves, lowest depth %u, %llu us generating inline\n",
+               (unsigned long long)keyShareStats.requests,
+               (unsigned long long)keyShareStats.hits,
+               (unsigned long long)keyShareStats.underruns,
+               (unsigned long long)keyShareStats.other_curves,
+               keyShareStats.min_depth,
+               (unsigned long long)(keyShareStats.inline_ns / 1000));
+        keyshare_pool_free(keyShares);
+    }
+    if (pins) {
+        pinned_keys_stats(pins, &pinStats);
+        printf("Pinned keys: %llu clients accepted, %llu rejected\n",
+               (unsigned long long)pinStats.accepted,
+               (unsigned long long)pinStats.rejected);
+        pinned_keys_free(pins);
+    }
+    if (peerCache) {
+        peer_cache_stats(peerCache, &peerCacheStats);
+        printf("Peer cache: %llu of %llu certificates from the cache (%.1f%%),"
+               " %llu expired, %llu evicted, %llu rejected\n",
+               (unsigned long long)peerCacheStats.hits,
+               (unsigned long long)peerCacheStats.lookups,
+               peerCacheStats.lookups ?
+                   100.0 * peerCacheStats.hits / peerCacheStats.lookups : 0.0,
+               (unsigned long long)peerCacheStats.expired,
+               (unsigned long long)peerCacheStats.evictions,
+               (unsigned long long)peerCacheStats.rejected);
+        peer_cache_free(peerCache);
+    }
+    if (revoked) {
+        revocation_index_stats(revoked, &revokedStats);
+        printf("Revocation index: %llu lookups, %llu revoked, %llu reloads,"
+               " %u entries\n",
+               (unsigned long long)revokedStats.lookups,
+               (unsigned long long)revokedStats.revoked,
+               (unsigned long long)revokedStats.reloads,
+               revokedStats.entries);
+        revocation_index_close(revoked);
+    }
+#ifdef RPI_CBA
+    if (tickets) {
+        auth_ticket_stats(tickets, &ticketStats);
+        printf("Auth tickets: %llu of %llu connections skipped CBA (%.1f%%),"
+               " %llu issued, %llu expired, %llu invalid\n",
+               authCount[1], authCount[0] + authCount[1],
+               authCount[0] + authCount[1] ?
+                   100.0 * authCount[1] / (authCount[0] + authCount[1]) : 0.0,
+               (unsigned long long)ticketStats.issued,
+               (unsigned long long)ticketStats.expired,
+               (unsigned long long)ticketStats.invalid);
+        if (authCount[0] && authCount[1])
+            printf("Second factor: %.1f ms with CBA, %.1f ms with a ticket,"
+                   " %.1f s saved\n",
+                   authMs[0] / authCount[0], authMs[1] / authCount[1],
+                   authCount[1] * (authMs[0] / authCount[0] - authMs[1] / authCount[1]) / 1e3);
+        auth_ticket_issuer_free(tickets);
+    }
+#endif
+    delegated_key_free(delegated);
     wolfSSL_Cleanup();          /* Cleanup the wolfSSL environment          */
+    key_backend_free(keys);
     wolfCrypt_Cleanup();
     return ret;               /* Return reporting a success               */
 }
@@ -0,0 +1,301 @@
+/* teec-sim.c
+ *
+ * Copyright (C) 2025 3mdeb Sp. z o.o.
+ *
+ * User space stand-in for libteec and the context based authentication TA,
+ * so the RPI_CBA client and server run on machines without OP-TEE. Built as
+ * libteec-sim.so, it exports the TEEC_* calls used by the CBA code and
+ * answers TA_CONTEXT_BASED_AUTHENTICATION_UUID only. Signatures are real
+ * ECDSA P-256 over SHA-256(nonce) made with wolfCrypt.
+ *
+ * Behaviour is set from the environment:
+ *   TEEC_SIM_CONTEXT     string the signing key is derived from, peers must
+ *                        share it (default "crosscon-cba")
+ *   TEEC_SIM_OPEN_US     added latency of TEEC_OpenSession()
+ *   TEEC_SIM_LATENCY_US  added latency of TEEC_InvokeCommand()
+ *   TEEC_SIM_JITTER_US   uniform random extra latency on top of it
+ *   TEEC_SIM_FAIL_RATE   share of commands failing with TEEC_ERROR_BUSY,
+ *                        0.0 to 1.0
+ *
+ * Shared memory is not supported, the CBA code only passes temporary
+ * memory references.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <tee_client_api.h>
+
+#include <wolfssl/options.h>
+#include <wolfssl/wolfcrypt/ecc.h>
+#include <wolfssl/wolfcrypt/sha256.h>
+#include <wolfssl/wolfcrypt/random.h>
+
+#include "include/context_based_authentication.h"
+#include "include/common/challenge.h"
+
+#define DEFAULT_CONTEXT "crosscon-cba"
+
+/* As returned by the TA for a bad signature */
+#define TEE_ERROR_SIGNATURE_INVALID 0xFFFF3072
+
+/* Marks contexts and sessions opened by this library */
+#define SIM_CONTEXT_FD  0x7ee5
+#define SIM_SESSION_ID  0xcba
+
+typedef struct {
+    ecc_key key;
+    WC_RNG rng;
+    int enrolled;
+    unsigned long openUs, latencyUs, jitterUs;
+    double failRate;
+    TEEC_Result error;      /* set if the setup failed */
+} sim_ta_t;
+
+static sim_ta_t ta;
+static pthread_once_t taOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t taLock = PTHREAD_MUTEX_INITIALIZER;
+
+static unsigned long env_ulong(const char* name)
+{
+    const char* value = getenv(name);
+
+    return value ? strtoul(value, NULL, 10) : 0;
+}
+
+/* The key only depends on TEEC_SIM_CONTEXT, so a client and a server
+ * started with the same value trust each other. */
+static void ta_setup(void)
+{
+    const char* context = getenv("TEEC_SIM_CONTEXT");
+    const char* failRate = getenv("TEEC_SIM_FAIL_RATE");
+    byte d[WC_SHA256_DIGEST_SIZE];
+
+    ta.openUs = env_ulong("TEEC_SIM_OPEN_US");
+    ta.latencyUs = env_ulong("TEEC_SIM_LATENCY_US");
+    ta.jitterUs = env_ulong("TEEC_SIM_JITTER_US");
+    ta.failRate = failRate ? atof(failRate) : 0.0;
+    if (!context)
+        context = DEFAULT_CONTEXT;
+
+    ta.error = TEEC_ERROR_GENERIC;
+    if (wc_InitRng(&ta.rng) != 0)
+        return;
+    if (wc_ecc_init(&ta.key) != 0)
+        return;
+
+    if (wc_Sha256Hash((const byte*)context, (word32)strlen(context), d) != 0 ||
+        wc_ecc_import_private_key_ex(d, sizeof(d), NULL, 0, &ta.key, ECC_SECP256R1) != 0 ||
+        wc_ecc_make_pub(&ta.key, NULL) != 0) {
+        fprintf(stderr, "teec-sim: failed to derive the CBA key\n");
+        return;
+    }
+    ta.error = TEEC_SUCCESS;
+}
+
+static void ta_delay(unsigned long baseUs)
+{
+    uint32_t extra = 0;
+
+    if (ta.jitterUs) {
+        pthread_mutex_lock(&taLock);
+        wc_RNG_GenerateBlock(&ta.rng, (byte*)&extra, sizeof(extra));
+        pthread_mutex_unlock(&taLock);
+        extra %= ta.jitterUs + 1;
+    }
+    if (baseUs + extra)
+        sleepUs(baseUs + extra);
+}
+
+static int ta_should_fail(void)
+{
+    uint32_t draw = 0;
+
+    if (ta.failRate <= 0.0)
+        return 0;
+
+    pthread_mutex_lock(&taLock);
+    wc_RNG_GenerateBlock(&ta.rng, (byte*)&draw, sizeof(draw));
+    pthread_mutex_unlock(&taLock);
+    return draw < ta.failRate * 4294967295.0;
+}
+
+static int param_type(TEEC_Operation* op, int index)
+{
+    return op ? TEEC_PARAM_TYPE_GET(op->paramTypes, index) : TEEC_NONE;
+}
+
+static TEEC_Result ta_get_nonce(TEEC_Operation* op)
+{
+    int ret;
+
+    if (param_type(op, 0) != TEEC_MEMREF_TEMP_OUTPUT || !op->params[0].tmpref.buffer)
+        return TEEC_ERROR_BAD_PARAMETERS;
+
+    pthread_mutex_lock(&taLock);
+    ret = wc_RNG_GenerateBlock(&ta.rng, op->params[0].tmpref.buffer,
+                               (word32)op->params[0].tmpref.size);
+    pthread_mutex_unlock(&taLock);
+    return ret == 0 ? TEEC_SUCCESS : TEEC_ERROR_GENERIC;
+}
+
+static TEEC_Result ta_prove(TEEC_Operation* op)
+{
+    byte hash[WC_SHA256_DIGEST_SIZE];
+    byte sig[ECC_MAX_SIG_SIZE];
+    word32 sigLen;
+    int ret;
+
+    if (param_type(op, 0) != TEEC_MEMREF_TEMP_INPUT ||
+        param_type(op, 1) != TEEC_MEMREF_TEMP_OUTPUT ||
+        param_type(op, 2) != TEEC_VALUE_OUTPUT)
+        return TEEC_ERROR_BAD_PARAMETERS;
+    if (!ta.enrolled)
+        return TEEC_ERROR_BAD_STATE;
+
+    if (wc_Sha256Hash(op->params[0].tmpref.buffer, (word32)op->params[0].tmpref.size, hash) != 0)
+        return TEEC_ERROR_GENERIC;
+
+    /* The transport finds the end of the signature by trimming trailing
+     * zeros, so draw another one until it does not end in one. */
+    pthread_mutex_lock(&taLock);
+    do {
+        sigLen = sizeof(sig);
+        ret = wc_ecc_sign_hash(hash, sizeof(hash), sig, &sigLen, &ta.rng, &ta.key);
+    } while (ret == 0 && sig[sigLen - 1] == 0);
+    pthread_mutex_unlock(&taLock);
+    if (ret != 0)
+        return TEEC_ERROR_GENERIC;
+
+    if (op->params[1].tmpref.size < sigLen) {
+        op->params[1].tmpref.size = sigLen;
+        return TEEC_ERROR_SHORT_BUFFER;
+    }
+    memcpy(op->params[1].tmpref.buffer, sig, sigLen);
+    op->params[1].tmpref.size = sigLen;
+    op->params[2].value.a = sigLen;
+    return TEEC_SUCCESS;
+}
+
+static TEEC_Result ta_verify(TEEC_Operation* op)
+{
+    byte hash[WC_SHA256_DIGEST_SIZE];
+    int valid = 0;
+    int ret;
+
+    if (param_type(op, 0) != TEEC_MEMREF_TEMP_INPUT ||
+        param_type(op, 1) != TEEC_MEMREF_TEMP_INPUT)
+        return TEEC_ERROR_BAD_PARAMETERS;
+
+    if (wc_Sha256Hash(op->params[0].tmpref.buffer, (word32)op->params[0].tmpref.size, hash) != 0)
+        return TEEC_ERROR_GENERIC;
+
+    pthread_mutex_lock(&taLock);
+    ret = wc_ecc_verify_hash(op->params[1].tmpref.buffer, (word32)op->params[1].tmpref.size,
+                             hash, sizeof(hash), &valid, &ta.key);
+    pthread_mutex_unlock(&taLock);
+    return (ret == 0 && valid) ? TEEC_SUCCESS : TEE_ERROR_SIGNATURE_INVALID;
+}
+
+TEEC_Result TEEC_InitializeContext(const char* name, TEEC_Context* context)
+{
+    (void)name;
+
+    if (!context)
+        return TEEC_ERROR_BAD_PARAMETERS;
+
+    pthread_once(&taOnce, ta_setup);
+    if (ta.error != TEEC_SUCCESS)
+        return ta.error;
+
+    memset(context, 0, sizeof(*context));
+    context->fd = SIM_CONTEXT_FD;
+    return TEEC_SUCCESS;
+}
+
+void TEEC_FinalizeContext(TEEC_Context* context)
+{
+    if (context)
+        context->fd = -1;
+}
+
+TEEC_Result TEEC_OpenSession(TEEC_Context* context, TEEC_Session* session,
+                             const TEEC_UUID* destination, uint32_t connectionMethod,
+                             const void* connectionData, TEEC_Operation* operation,
+                             uint32_t* returnOrigin)
+{
+    const TEEC_UUID cba = TA_CONTEXT_BASED_AUTHENTICATION_UUID;
+
+    (void)connectionMethod;
+    (void)connectionData;
+    (void)operation;
+
+    if (returnOrigin)
+        *returnOrigin = TEEC_ORIGIN_API;
+    if (!context || context->fd != SIM_CONTEXT_FD || !session || !destination)
+        return TEEC_ERROR_BAD_PARAMETERS;
+
+    if (memcmp(destination, &cba, sizeof(cba)) != 0) {
+        if (returnOrigin)
+            *returnOrigin = TEEC_ORIGIN_TEE;
+        return TEEC_ERROR_ITEM_NOT_FOUND;
+    }
+
+    ta_delay(ta.openUs);
+
+    memset(session, 0, sizeof(*session));
+    session->ctx = context;
+    session->session_id = SIM_SESSION_ID;
+    return TEEC_SUCCESS;
+}
+
+void TEEC_CloseSession(TEEC_Session* session)
+{
+    if (session)
+        session->session_id = 0;
+}
+
+TEEC_Result TEEC_InvokeCommand(TEEC_Session* session, uint32_t commandID,
+                               TEEC_Operation* operation, uint32_t* returnOrigin)
+{
+    TEEC_Result res;
+
+    if (returnOrigin)
+        *returnOrigin = TEEC_ORIGIN_API;
+    if (!session || session->session_id != SIM_SESSION_ID)
+        return TEEC_ERROR_BAD_PARAMETERS;
+
+    if (returnOrigin)
+        *returnOrigin = TEEC_ORIGIN_TRUSTED_APP;
+
+    ta_delay(ta.latencyUs);
+    if (ta_should_fail())
+        return TEEC_ERROR_BUSY;
+
+    switch (commandID) {
+    case TA_CONTEXT_BASED_AUTHENTICATION_CMD_GET_NONCE:
+        res = ta_get_nonce(operation);
+        break;
+    case TA_CONTEXT_BASED_AUTHENTICATION_CMD_ENROLL:
+        ta.enrolled = 1;
+        res = TEEC_SUCCESS;
+        break;
+    case TA_CONTEXT_BASED_AUTHENTICATION_CMD_PROVE:
+        res = ta_prove(operation);
+        break;
+    case TA_CONTEXT_BASED_AUTHENTICATION_CMD_VERIFY:
+        res = ta_verify(operation);
+        break;
+    default:
+        res = TEEC_ERROR_NOT_SUPPORTED;
+        break;
+    }
+    return res;
+}
+
+void TEEC_RequestCancellation(TEEC_Operation* operation)
+{
+    (void)operation;
+}